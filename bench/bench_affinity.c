@@ -0,0 +1,225 @@
+#define _GNU_SOURCE /* sched_getcpu() and CPU affinity on glibc */
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#endif
+
+/*
+ * Worker placement benchmark.
+ *
+ * Serves short requests over loopback with the pooled server in several placements and notes,
+ * for every request, the CPU its handler runs on. Reports requests/second, how often a worker
+ * ran on another CPU than for its previous request, and how often it ran on another NUMA node
+ * than for its first one - the node its thread-local buffers were first touched on, so every
+ * such request reads and writes remote memory.
+ *
+ * Placements:
+ *   floating  TEAPOT_ACCEPT_WORKERS, the scheduler moves the workers around
+ *   pinned    TEAPOT_ACCEPT_WORKERS with pin_workers
+ *   sharded   TEAPOT_ACCEPT_SHARDED with pin_workers: one SO_REUSEPORT listener per worker,
+ *             steered with SO_INCOMING_CPU
+ *
+ * The CPU and node columns need Linux (and show "-" elsewhere); on a single node the node
+ * column stays at zero and the CPU column carries the difference.
+ *
+ * Usage: bench_affinity [ms per case]   (default 500)
+ */
+
+#define PORT 18480
+#define CLIENTS_PER_WORKER 2
+#define MAX_CPUS 1024
+
+static int cpu_node[MAX_CPUS];
+static int node_count;
+
+static size_t requests;
+static size_t moved;    /* a worker on another CPU than for its previous request */
+static size_t off_node; /* a worker on another node than for its first request */
+static size_t clients_stop;
+
+static TP_THREAD_LOCAL int home_node = -1;
+static TP_THREAD_LOCAL int last_cpu = -1;
+
+static int current_cpu(void)
+{
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+/* cpu_node[] from /sys/devices/system/node/node<N>/cpulist, everything on node 0 without it */
+static void read_node_map(void)
+{
+    node_count = 1;
+    for (int node = 0; node < 64; ++node)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *f = fopen(path, "r");
+        if (f == NULL)
+            continue;
+        char list[1024];
+        if (fgets(list, sizeof(list), f) != NULL)
+        {
+            /* "0-3,8-11" */
+            for (char *p = list; *p >= '0' && *p <= '9';)
+            {
+                long first = strtol(p, &p, 10);
+                long last = first;
+                if (*p == '-')
+                    last = strtol(p + 1, &p, 10);
+                for (long cpu = first; cpu <= last && cpu < MAX_CPUS; ++cpu)
+                    cpu_node[cpu] = node;
+                if (*p == ',')
+                    ++p;
+            }
+            if (node + 1 > node_count)
+                node_count = node + 1;
+        }
+        fclose(f);
+    }
+}
+
+static teapot_response h_tea(const teapot_request *req)
+{
+    (void)req;
+    int cpu = current_cpu();
+    if (cpu >= 0 && cpu < MAX_CPUS)
+    {
+        if (home_node < 0)
+            home_node = cpu_node[cpu];
+        if (last_cpu >= 0 && cpu != last_cpu)
+            tp_atomic_add(&moved, 1);
+        if (cpu_node[cpu] != home_node)
+            tp_atomic_add(&off_node, 1);
+        last_cpu = cpu;
+    }
+    tp_atomic_add(&requests, 1);
+
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    tp_sb_append_cstr(&resp.body, "tea");
+    return resp;
+}
+
+static void sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    poll(NULL, 0, ms);
+#endif
+}
+
+TP_THREAD_FN(client, arg)
+{
+    (void)arg;
+    static const char request[] = "GET /tea HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n";
+    while (tp_atomic_load(&clients_stop) == 0)
+    {
+        stb_teapot_socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(s, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            teapot_close(s);
+            sleep_ms(5); /* not listening yet */
+            continue;
+        }
+        send(s, request, (int)sizeof(request) - 1, 0);
+        char response[256];
+        while (recv(s, response, (int)sizeof(response), 0) > 0)
+        {
+        }
+        teapot_close(s);
+    }
+    TP_THREAD_RETURN;
+}
+
+typedef struct
+{
+    teapot_server *server;
+    teapot_pool_options options;
+} serve_arg;
+
+TP_THREAD_FN(serve, arg)
+{
+    serve_arg *sa = (serve_arg *)arg;
+    teapot_serve_pooled_ex(sa->server, &sa->options);
+    TP_THREAD_RETURN;
+}
+
+static void run(const char *name, teapot_accept_strategy accept, int pin, int workers, int budget_ms)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/tea", h_tea},
+    };
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.port = PORT;
+    server.routes = routes;
+    server.route_count = 1;
+
+    serve_arg sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.server = &server;
+    sa.options.workers = workers;
+    sa.options.accept = accept;
+    sa.options.pin_workers = pin;
+
+    requests = moved = off_node = clients_stop = 0;
+    tp_thread serving;
+    tp_thread_start(&serving, serve, &sa);
+
+    int client_count = workers * CLIENTS_PER_WORKER;
+    tp_thread *clients = (tp_thread *)malloc((size_t)client_count * sizeof(tp_thread));
+    for (int i = 0; i < client_count; ++i)
+        tp_thread_start(&clients[i], client, NULL);
+    sleep_ms(budget_ms);
+    tp_atomic_add(&clients_stop, 1);
+    for (int i = 0; i < client_count; ++i)
+        tp_thread_join(clients[i]);
+    free(clients);
+    teapot_server_stop(&server);
+    tp_thread_join(serving);
+    teapot_server_free(&server);
+
+    size_t n = tp_atomic_load(&requests);
+    double per_second = (double)n / ((double)budget_ms / 1000.0);
+    if (current_cpu() < 0 || n == 0)
+    {
+        printf("%-10s %12.0f %10s %10s\n", name, per_second, "-", "-");
+        return;
+    }
+    printf("%-10s %12.0f %9.2f%% %9.2f%%\n", name, per_second, 100.0 * (double)moved / (double)n,
+           100.0 * (double)off_node / (double)n);
+}
+
+int main(int argc, char **argv)
+{
+    int budget_ms = (argc > 1) ? atoi(argv[1]) : 500;
+    if (budget_ms <= 0)
+        budget_ms = 500;
+
+    read_node_map();
+    int workers = teapot_cpu_count();
+    printf("Worker placement benchmark, %d workers, %d NUMA node(s), %d ms per case\n\n", workers, node_count,
+           budget_ms);
+    printf("%-10s %12s %10s %10s\n", "placement", "requests/s", "moved", "off-node");
+
+    run("floating", TEAPOT_ACCEPT_WORKERS, 0, workers, budget_ms);
+    run("pinned", TEAPOT_ACCEPT_WORKERS, 1, workers, budget_ms);
+    run("sharded", TEAPOT_ACCEPT_SHARDED, 1, workers, budget_ms);
+    return 0;
+}
@@ -0,0 +1,213 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Connection hand-off contention benchmark.
+ *
+ * Producers push fake sockets and consumers pop them until every item went through, as the
+ * dispatcher and the workers of teapot_serve_pooled() do, and reports items/second and the
+ * wall-clock cost per item for each producer/consumer mix.
+ *
+ * Queues:
+ *   locked  circular buffer under a mutex, with a semaphore post per push and a wait per pop,
+ *           the shape of the job queue the pooled example used before the ring
+ *   ring    tp_socket_ring: lock-free cells, consumers only park once they stayed idle
+ *
+ * Both hold QUEUE_CAPACITY sockets; a producer finding its queue full yields and retries.
+ *
+ * Usage: bench_handoff [items per case]   (default 200000)
+ */
+
+#define QUEUE_CAPACITY 1024
+#define MAX_THREADS 8
+
+typedef enum
+{
+    QUEUE_LOCKED,
+    QUEUE_RING
+} queue_kind;
+
+static const char *queue_names[] = {"locked", "ring"};
+
+typedef struct
+{
+    stb_teapot_socket_t items[QUEUE_CAPACITY];
+    size_t head;
+    size_t count;
+    int closed;
+    tp_mutex lock;
+    tp_parking available; /* one post per pushed item, and one per consumer on close */
+} locked_queue;
+
+static int locked_queue_push(locked_queue *q, stb_teapot_socket_t socket)
+{
+    tp_mutex_lock(&q->lock);
+    if (q->count == QUEUE_CAPACITY)
+    {
+        tp_mutex_unlock(&q->lock);
+        return -1;
+    }
+    q->items[(q->head + q->count++) % QUEUE_CAPACITY] = socket;
+    tp_mutex_unlock(&q->lock);
+    tp_parking_post(&q->available, 1);
+    return 0;
+}
+
+static stb_teapot_socket_t locked_queue_pop(locked_queue *q)
+{
+    tp_parking_wait(&q->available);
+    tp_mutex_lock(&q->lock);
+    stb_teapot_socket_t socket = (stb_teapot_socket_t)-1;
+    if (q->count > 0)
+    {
+        socket = q->items[q->head];
+        q->head = (q->head + 1) % QUEUE_CAPACITY;
+        --q->count;
+    }
+    tp_mutex_unlock(&q->lock);
+    return socket;
+}
+
+typedef struct
+{
+    queue_kind kind;
+    size_t items;
+    size_t producers;
+    locked_queue locked;
+    tp_socket_ring ring;
+    size_t popped;
+    size_t sum;
+} bench_run;
+
+typedef struct
+{
+    bench_run *run;
+    size_t first;
+} producer_arg;
+
+TP_THREAD_FN(producer, arg)
+{
+    producer_arg *pa = (producer_arg *)arg;
+    bench_run *run = pa->run;
+    for (size_t i = pa->first; i < run->items; i += run->producers)
+    {
+        stb_teapot_socket_t socket = (stb_teapot_socket_t)i;
+        while ((run->kind == QUEUE_RING ? tp_socket_ring_push(&run->ring, socket)
+                                        : locked_queue_push(&run->locked, socket)) < 0)
+            tp_thread_yield();
+    }
+    TP_THREAD_RETURN;
+}
+
+TP_THREAD_FN(consumer, arg)
+{
+    bench_run *run = (bench_run *)arg;
+    size_t popped = 0;
+    size_t sum = 0;
+    stb_teapot_socket_t socket;
+    while (socket_ok(socket = run->kind == QUEUE_RING ? tp_socket_ring_pop(&run->ring)
+                                                      : locked_queue_pop(&run->locked)))
+    {
+        ++popped;
+        sum += (size_t)socket;
+    }
+    tp_atomic_add(&run->popped, popped);
+    tp_atomic_add(&run->sum, sum);
+    TP_THREAD_RETURN;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int run_case(queue_kind kind, size_t producers, size_t consumers, size_t items)
+{
+    static bench_run run;
+    memset(&run, 0, sizeof(run));
+    run.kind = kind;
+    run.items = items;
+    run.producers = producers;
+    if (kind == QUEUE_RING)
+    {
+        tp_socket_ring_init(&run.ring, QUEUE_CAPACITY);
+    }
+    else
+    {
+        tp_mutex_init(&run.locked.lock);
+        tp_parking_init(&run.locked.available);
+    }
+
+    tp_thread consumer_threads[MAX_THREADS];
+    tp_thread producer_threads[MAX_THREADS];
+    producer_arg args[MAX_THREADS];
+    double t0 = now_ns();
+    for (size_t i = 0; i < consumers; ++i)
+        tp_thread_start(&consumer_threads[i], consumer, &run);
+    for (size_t i = 0; i < producers; ++i)
+    {
+        args[i].run = &run;
+        args[i].first = i;
+        tp_thread_start(&producer_threads[i], producer, &args[i]);
+    }
+    for (size_t i = 0; i < producers; ++i)
+        tp_thread_join(producer_threads[i]);
+    if (kind == QUEUE_RING)
+    {
+        tp_socket_ring_close(&run.ring, consumers);
+    }
+    else
+    {
+        tp_mutex_lock(&run.locked.lock);
+        run.locked.closed = 1;
+        tp_mutex_unlock(&run.locked.lock);
+        tp_parking_post(&run.locked.available, consumers);
+    }
+    for (size_t i = 0; i < consumers; ++i)
+        tp_thread_join(consumer_threads[i]);
+    double elapsed = now_ns() - t0;
+
+    if (kind == QUEUE_RING)
+    {
+        tp_socket_ring_destroy(&run.ring);
+    }
+    else
+    {
+        tp_parking_destroy(&run.locked.available);
+        tp_mutex_destroy(&run.locked.lock);
+    }
+
+    char mix[32];
+    snprintf(mix, sizeof(mix), "%zu -> %zu", producers, consumers);
+    printf("%-8s %-8s %12.0f %10.1f\n", queue_names[kind], mix, (double)items / (elapsed / 1e9),
+           elapsed / (double)items);
+    return run.popped == items && run.sum == items * (items - 1) / 2 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    long requested = (argc > 1) ? atol(argv[1]) : 200000;
+    size_t items = requested > 0 ? (size_t)requested : 200000;
+
+    static const size_t mixes[][2] = {{1, 1}, {1, 2}, {1, 4}, {1, 8}, {4, 4}, {8, 8}};
+
+    printf("Connection hand-off benchmark, %zu items per case, %d CPUs\n\n", items, teapot_cpu_count());
+    printf("%-8s %-8s %12s %10s\n", "queue", "P -> C", "items/s", "ns/item");
+
+    int ret = 0;
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); ++m)
+        for (int kind = QUEUE_LOCKED; kind <= QUEUE_RING; ++kind)
+            if (run_case((queue_kind)kind, mixes[m][0], mixes[m][1], items) < 0)
+            {
+                printf("lost items!\n");
+                ret = 1;
+            }
+    return ret;
+}
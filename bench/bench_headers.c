@@ -0,0 +1,151 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Header storage microbenchmark.
+ *
+ * Parses a typical browser header section into tp_headers (one tp_header_line per header) and
+ * into a tp_header_block (one blob plus a packed entry table), then reports parse+free cost and
+ * the cost of looking up present and absent names in each, with the allocator calls per operation
+ * counted by a tp_counting_allocator.
+ *
+ * Usage: bench_headers [ms per case]   (default 200)
+ */
+
+#define BATCH 256 // operations per timed sample
+
+static char raw_headers[] =
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Cookie: session=0123456789abcdef; theme=dark; consent=yes\r\n";
+
+static const char *lookups[] = {"accept-encoding", "cookie", "user-agent", "if-none-match", "authorization"};
+#define LOOKUP_COUNT (sizeof(lookups) / sizeof(lookups[0]))
+
+static double samples_ns[1 << 16];
+static volatile size_t sink;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef enum
+{
+    CASE_PARSE_LINES,
+    CASE_PARSE_BLOCK,
+    CASE_LOOKUP_LINES,
+    CASE_LOOKUP_BLOCK
+} bench_kind;
+
+static const char *case_names[] = {"parse+free tp_headers", "parse+free block", "lookup tp_headers", "lookup block"};
+
+static tp_headers parsed_lines;
+static tp_header_block parsed_block;
+
+static void op(bench_kind kind, size_t i)
+{
+    switch (kind)
+    {
+    case CASE_PARSE_LINES:
+    {
+        tp_headers h = {0};
+        tp_extract_header_keyval(&h, raw_headers, sizeof(raw_headers) - 1);
+        sink += h.count;
+        tp_headers_free(&h);
+        break;
+    }
+    case CASE_PARSE_BLOCK:
+    {
+        tp_header_block block;
+        sink += tp_header_block_parse(&block, NULL, raw_headers, sizeof(raw_headers) - 1);
+        tp_header_block_free(&block);
+        break;
+    }
+    case CASE_LOOKUP_LINES:
+        sink += (size_t)tp_headers_get(&parsed_lines, lookups[i % LOOKUP_COUNT]);
+        break;
+    case CASE_LOOKUP_BLOCK:
+        sink += tp_header_block_get(&parsed_block, lookups[i % LOOKUP_COUNT]).count;
+        break;
+    }
+}
+
+static void run(bench_kind kind, double budget_ns)
+{
+    size_t samples = 0;
+    size_t ops = 0;
+    const size_t max_samples = sizeof(samples_ns) / sizeof(samples_ns[0]);
+
+    double start = now_ns();
+    double elapsed = 0.0;
+    while (elapsed < budget_ns && samples < max_samples)
+    {
+        double t0 = now_ns();
+        for (size_t i = 0; i < BATCH; ++i)
+            op(kind, ops + i);
+        double t1 = now_ns();
+        samples_ns[samples++] = (t1 - t0) / BATCH;
+        ops += BATCH;
+        elapsed = t1 - start;
+    }
+
+    tp_counting_allocator counter;
+    tp_counting_allocator_init(&counter, NULL);
+    tp_allocator_use(&counter.allocator);
+    op(kind, 0);
+    tp_allocator_use(NULL);
+
+    qsort(samples_ns, samples, sizeof(double), compare_doubles);
+    printf("%-22s %12.0f %8.1f %8.1f %8.1f %7zu %8zu\n", case_names[kind], (double)ops / (elapsed / 1e9),
+           samples_ns[samples / 2], samples_ns[samples * 9 / 10], samples_ns[samples * 99 / 100],
+           counter.allocs + counter.reallocs, counter.bytes_peak);
+}
+
+int main(int argc, char **argv)
+{
+    double budget_ms = (argc > 1) ? atof(argv[1]) : 200.0;
+    if (budget_ms <= 0.0)
+        budget_ms = 200.0;
+
+    tp_extract_header_keyval(&parsed_lines, raw_headers, sizeof(raw_headers) - 1);
+    tp_header_block_parse(&parsed_block, NULL, raw_headers, sizeof(raw_headers) - 1);
+
+    printf("Header storage benchmark, %zu headers, %.0f ms per case, %d-op samples\n\n",
+           parsed_block.count, budget_ms, BATCH);
+    printf("%-22s %12s %8s %8s %8s %7s %8s\n", "case", "ops/s", "p50 ns", "p90 ns", "p99 ns", "allocs", "peak B");
+
+    for (int kind = CASE_PARSE_LINES; kind <= CASE_LOOKUP_BLOCK; ++kind)
+        run((bench_kind)kind, budget_ms * 1e6);
+
+    tp_headers_free(&parsed_lines);
+    tp_header_block_free(&parsed_block);
+    return 0;
+}
@@ -0,0 +1,446 @@
+#define STB_TEAPOT_IMPLEMENTATION /* bench_router_cpp.cpp may have included it already */
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Router microbenchmark.
+ *
+ * For route sets of 10, 100, 1k and 10k routes (static, parameterized and mixed), replays a
+ * fixed stream of request paths through each lookup engine and reports lookups/second and
+ * ns/lookup percentiles. The paths follow a Zipf-like distribution over the routes (a few hot
+ * endpoints, a long tail) with 5% misses, like typical API traffic.
+ *
+ * Engines:
+ *   linear  teapot_find_handler_linear(), the original strcmp scan (exact paths only)
+ *   radix   teapot_router_resolve() on the built router
+ *   static  teapot_static_routes_find() on a perfect-hash table of the static routes, falling
+ *           back to the radix router like teapot_find_handler() (nob.c generates these tables
+ *           at build time, the benchmark hashes its route sets at startup)
+ *   dfa     the same routes as '~' patterns (':param' segments become '*'), so every lookup runs
+ *           the pattern DFA; skipped once a set needs more than TP_ROUTER_MAX_DFA_STATES states
+ *   cpp     teapot::router<...>::dispatch, only in bench_router_cpp (this file built as C++),
+ *           and only for the static sets it instantiates at compile time
+ *
+ * Usage: bench_router [ms per case]   (default 200)
+ */
+
+#define PATH_COUNT 4096 // request paths replayed in a loop
+#define BATCH 64        // lookups per timed sample
+
+typedef enum
+{
+    SET_STATIC,
+    SET_PARAM,
+    SET_MIXED
+} route_set_kind;
+
+static const char *set_names[] = {"static", "param", "mixed"};
+
+static teapot_response h_bench(const teapot_request *req)
+{
+    (void)req;
+    teapot_response resp = {0};
+    return resp;
+}
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Route i of a set: resource names spread over a few API versions, like a real route table */
+static int route_is_param(route_set_kind kind, size_t i)
+{
+    return kind == SET_PARAM || (kind == SET_MIXED && i % 2 == 1);
+}
+
+static void route_pattern(route_set_kind kind, size_t i, char *out, size_t out_size)
+{
+    if (route_is_param(kind, i))
+        snprintf(out, out_size, "/api/v%zu/res%zu/:id/items/:item", i % 3 + 1, i);
+    else
+        snprintf(out, out_size, "/api/v%zu/res%zu/items", i % 3 + 1, i);
+}
+
+/* The same route as a pattern for the DFA */
+static void route_glob(route_set_kind kind, size_t i, char *out, size_t out_size)
+{
+    if (route_is_param(kind, i))
+        snprintf(out, out_size, "~/api/v%zu/res%zu/*/items/*", i % 3 + 1, i);
+    else
+        snprintf(out, out_size, "~/api/v%zu/res%zu/items", i % 3 + 1, i);
+}
+
+static void request_path(route_set_kind kind, size_t i, char *out, size_t out_size)
+{
+    if (route_is_param(kind, i))
+        snprintf(out, out_size, "/api/v%zu/res%zu/%llu/items/%llu", i % 3 + 1, i,
+                 (unsigned long long)(rng_next() % 100000), (unsigned long long)(rng_next() % 100));
+    else
+        snprintf(out, out_size, "/api/v%zu/res%zu/items", i % 3 + 1, i);
+}
+
+/* Zipf(s = 1) rank over n routes via the inverse of the harmonic CDF */
+static size_t zipf_pick(const double *cdf, size_t n)
+{
+    double u = (double)(rng_next() >> 11) / 9007199254740992.0;
+    size_t lo = 0;
+    size_t hi = n - 1;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+typedef struct
+{
+    teapot_server server; // routes only, router left unbuilt for the linear scan
+    teapot_router router;
+    teapot_route *routes;
+    char *route_text;
+    teapot_static_route *static_entries;
+    int32_t *displacements;
+    teapot_static_routes static_table;
+    teapot_router patterns;
+    teapot_route *pattern_routes;
+    char *pattern_text;
+    int patterns_built;
+    teapot_dispatch_fn cpp_dispatch; // NULL unless built as C++ with this set instantiated
+    teapot_request requests[PATH_COUNT];
+    double samples_ns[1 << 16];
+} bench_case;
+
+static bench_case bc;
+
+static size_t *sort_bucket_sizes;
+
+static int compare_buckets_by_size(const void *a, const void *b)
+{
+    size_t x = sort_bucket_sizes[*(const size_t *)a];
+    size_t y = sort_bucket_sizes[*(const size_t *)b];
+    return (x < y) - (x > y);
+}
+
+/* Hash and displace over the static routes, as nob.c's generate_route_table() does:
+   biggest buckets first, each with the first seed sending its keys to free slots */
+static void build_static_table(void)
+{
+    size_t n = 0;
+    bc.static_entries = (teapot_static_route *)calloc(bc.server.route_count, sizeof(teapot_static_route));
+    for (size_t i = 0; i < bc.server.route_count; ++i)
+    {
+        if (strchr(bc.routes[i].path, ':') != NULL)
+            continue;
+        bc.static_entries[n].method = bc.routes[i].method;
+        bc.static_entries[n].path = bc.routes[i].path;
+        bc.static_entries[n].path_len = strlen(bc.routes[i].path);
+        bc.static_entries[n].handler = bc.routes[i].handler;
+        ++n;
+    }
+    memset(&bc.static_table, 0, sizeof(bc.static_table));
+    bc.displacements = NULL;
+    if (n == 0)
+        return;
+
+    teapot_static_route *keys = (teapot_static_route *)malloc(n * sizeof(teapot_static_route));
+    memcpy(keys, bc.static_entries, n * sizeof(teapot_static_route));
+    uint32_t *bucket_of = (uint32_t *)malloc(n * sizeof(uint32_t));
+    size_t *bucket_sizes = (size_t *)calloc(n, sizeof(size_t));
+    size_t *order = (size_t *)malloc(n * sizeof(size_t));
+    size_t *slots = (size_t *)malloc(n * sizeof(size_t));
+    char *taken = (char *)calloc(n, 1);
+    bc.displacements = (int32_t *)calloc(n, sizeof(int32_t));
+
+    for (size_t k = 0; k < n; ++k)
+    {
+        bucket_of[k] = tp_route_hash(0, keys[k].method, keys[k].path, keys[k].path_len) % (uint32_t)n;
+        ++bucket_sizes[bucket_of[k]];
+    }
+    for (size_t b = 0; b < n; ++b)
+        order[b] = b;
+    sort_bucket_sizes = bucket_sizes;
+    qsort(order, n, sizeof(size_t), compare_buckets_by_size);
+
+    size_t free_slot = 0;
+    for (size_t o = 0; o < n && bucket_sizes[order[o]] > 0; ++o)
+    {
+        uint32_t b = (uint32_t)order[o];
+        if (bucket_sizes[b] == 1)
+        {
+            while (taken[free_slot])
+                ++free_slot;
+            for (size_t k = 0; k < n; ++k)
+                if (bucket_of[k] == b)
+                    slots[k] = free_slot;
+            taken[free_slot] = 1;
+            bc.displacements[b] = -(int32_t)free_slot - 1;
+            continue;
+        }
+        for (uint32_t seed = 1;; ++seed)
+        {
+            size_t placed = 0;
+            size_t k = 0;
+            for (; k < n; ++k)
+            {
+                if (bucket_of[k] != b)
+                    continue;
+                slots[k] = tp_route_hash(seed, keys[k].method, keys[k].path, keys[k].path_len) % (uint32_t)n;
+                if (taken[slots[k]])
+                    break;
+                taken[slots[k]] = 1;
+                ++placed;
+            }
+            if (placed == bucket_sizes[b])
+            {
+                bc.displacements[b] = (int32_t)seed;
+                break;
+            }
+            for (size_t j = 0; j < k; ++j)
+                if (bucket_of[j] == b)
+                    taken[slots[j]] = 0;
+        }
+    }
+
+    for (size_t k = 0; k < n; ++k)
+        bc.static_entries[slots[k]] = keys[k];
+    bc.static_table.displacements = bc.displacements;
+    bc.static_table.entries = bc.static_entries;
+    bc.static_table.count = n;
+
+    free(keys);
+    free(bucket_of);
+    free(bucket_sizes);
+    free(order);
+    free(slots);
+    free(taken);
+}
+
+static void setup(route_set_kind kind, size_t route_count)
+{
+    bc.routes = (teapot_route *)calloc(route_count, sizeof(teapot_route));
+    bc.route_text = (char *)calloc(route_count, 64);
+    for (size_t i = 0; i < route_count; ++i)
+    {
+        char *text = bc.route_text + i * 64;
+        route_pattern(kind, i, text, 64);
+        bc.routes[i].method = TEAPOT_GET;
+        bc.routes[i].path = text;
+        bc.routes[i].handler = h_bench;
+    }
+
+    memset(&bc.server, 0, sizeof(bc.server));
+    bc.server.routes = bc.routes;
+    bc.server.route_count = route_count;
+    memset(&bc.router, 0, sizeof(bc.router));
+    teapot_router_build(&bc.router, bc.routes, route_count);
+    build_static_table();
+
+    bc.pattern_routes = (teapot_route *)calloc(route_count, sizeof(teapot_route));
+    bc.pattern_text = (char *)calloc(route_count, 64);
+    for (size_t i = 0; i < route_count; ++i)
+    {
+        char *text = bc.pattern_text + i * 64;
+        route_glob(kind, i, text, 64);
+        bc.pattern_routes[i] = bc.routes[i];
+        bc.pattern_routes[i].path = text;
+    }
+    memset(&bc.patterns, 0, sizeof(bc.patterns));
+    bc.patterns_built = teapot_router_build(&bc.patterns, bc.pattern_routes, route_count) == 0;
+
+    bc.cpp_dispatch = NULL;
+#ifdef __cplusplus
+    if (kind == SET_STATIC)
+        bc.cpp_dispatch = cpp_router_for(route_count);
+#endif
+
+    double *cdf = (double *)malloc(route_count * sizeof(double));
+    double total = 0.0;
+    for (size_t i = 0; i < route_count; ++i)
+    {
+        total += 1.0 / (double)(i + 1);
+        cdf[i] = total;
+    }
+    for (size_t i = 0; i < route_count; ++i)
+        cdf[i] /= total;
+
+    /* shuffle ranks so hot routes are not always the first ones inserted */
+    size_t *rank_to_route = (size_t *)malloc(route_count * sizeof(size_t));
+    for (size_t i = 0; i < route_count; ++i)
+        rank_to_route[i] = i;
+    for (size_t i = route_count; i > 1; --i)
+    {
+        size_t j = (size_t)(rng_next() % i);
+        size_t t = rank_to_route[i - 1];
+        rank_to_route[i - 1] = rank_to_route[j];
+        rank_to_route[j] = t;
+    }
+
+    char path[128];
+    for (size_t i = 0; i < PATH_COUNT; ++i)
+    {
+        if (rng_next() % 100 < 5)
+            snprintf(path, sizeof(path), "/api/v9/missing%zu", i);
+        else
+            request_path(kind, rank_to_route[zipf_pick(cdf, route_count)], path, sizeof(path));
+
+        teapot_request *req = &bc.requests[i];
+        memset(req, 0, sizeof(*req));
+        req->method = TEAPOT_GET;
+        tp_sb_append_cstr(&req->path, path);
+        tp_sb_append_null(&req->path);
+    }
+
+    free(rank_to_route);
+    free(cdf);
+}
+
+static void teardown(void)
+{
+    for (size_t i = 0; i < PATH_COUNT; ++i)
+        tp_sb_free(bc.requests[i].path);
+    teapot_router_free(&bc.router);
+    teapot_router_free(&bc.patterns);
+    free(bc.routes);
+    free(bc.route_text);
+    free(bc.static_entries);
+    free(bc.displacements);
+    free(bc.pattern_routes);
+    free(bc.pattern_text);
+}
+
+typedef enum
+{
+    ENGINE_LINEAR,
+    ENGINE_RADIX,
+    ENGINE_STATIC,
+    ENGINE_DFA,
+    ENGINE_CPP
+} engine_kind;
+
+static const char *engine_names[] = {"linear", "radix", "static", "dfa", "cpp"};
+
+static int engine_available(engine_kind engine)
+{
+    if (engine == ENGINE_DFA)
+        return bc.patterns_built;
+    if (engine == ENGINE_CPP)
+        return bc.cpp_dispatch != NULL;
+    return 1;
+}
+
+static int lookup(engine_kind engine, teapot_request *req)
+{
+    const char *path = req->path.items;
+    size_t path_len = req->path.count - 1;
+    switch (engine)
+    {
+    case ENGINE_LINEAR:
+        return teapot_find_handler_linear(&bc.server, req) != NULL;
+    case ENGINE_STATIC:
+        if (teapot_static_routes_find(&bc.static_table, req->method, path, path_len) != NULL)
+            return 1;
+        break;
+    case ENGINE_DFA:
+        return teapot_router_resolve(&bc.patterns, req->method, path, path_len, req->params, &req->param_count)
+                   .handler != NULL;
+    case ENGINE_CPP:
+    {
+        teapot_response resp;
+        return bc.cpp_dispatch(req, &resp);
+    }
+    case ENGINE_RADIX:
+        break;
+    }
+
+    return teapot_router_resolve(&bc.router, req->method, path, path_len, req->params, &req->param_count)
+               .handler != NULL;
+}
+
+static void run(route_set_kind kind, size_t route_count, engine_kind engine, double budget_ns)
+{
+    size_t samples = 0;
+    size_t lookups = 0;
+    size_t hits = 0;
+    size_t next = 0;
+    const size_t max_samples = sizeof(bc.samples_ns) / sizeof(bc.samples_ns[0]);
+
+    double start = now_ns();
+    double elapsed = 0.0;
+    while (elapsed < budget_ns && samples < max_samples)
+    {
+        double t0 = now_ns();
+        for (size_t i = 0; i < BATCH; ++i)
+        {
+            hits += (size_t)lookup(engine, &bc.requests[next]);
+            next = (next + 1) % PATH_COUNT;
+        }
+        double t1 = now_ns();
+        bc.samples_ns[samples++] = (t1 - t0) / BATCH;
+        lookups += BATCH;
+        elapsed = t1 - start;
+    }
+
+    qsort(bc.samples_ns, samples, sizeof(double), compare_doubles);
+    printf("%-7s %6zu  %-6s %12.0f %8.1f %8.1f %8.1f %8.1f %6.1f%%\n",
+           set_names[kind], route_count, engine_names[engine], (double)lookups / (elapsed / 1e9),
+           bc.samples_ns[samples / 2], bc.samples_ns[samples * 9 / 10], bc.samples_ns[samples * 99 / 100],
+           bc.samples_ns[samples - 1], 100.0 * (double)hits / (double)lookups);
+}
+
+int main(int argc, char **argv)
+{
+    double budget_ms = (argc > 1) ? atof(argv[1]) : 200.0;
+    if (budget_ms <= 0.0)
+        budget_ms = 200.0;
+
+    static const size_t sizes[] = {10, 100, 1000, 10000};
+
+    printf("Router benchmark, %.0f ms per case, %d-lookup samples\n\n", budget_ms, BATCH);
+    printf("%-7s %6s  %-6s %12s %8s %8s %8s %8s %7s\n",
+           "set", "routes", "engine", "lookups/s", "p50 ns", "p90 ns", "p99 ns", "max ns", "hits");
+
+    for (int kind = SET_STATIC; kind <= SET_MIXED; ++kind)
+    {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        {
+            setup((route_set_kind)kind, sizes[s]);
+            for (int engine = ENGINE_LINEAR; engine <= ENGINE_CPP; ++engine)
+                if (engine_available((engine_kind)engine))
+                    run((route_set_kind)kind, sizes[s], (engine_kind)engine, budget_ms * 1e6);
+            teardown();
+        }
+        printf("\n");
+    }
+
+    printf("linear matches exact paths only, so its hit rate drops on parameterized sets.\n");
+    printf("dfa is left out of sets needing more than %d DFA states.\n", TP_ROUTER_MAX_DFA_STATES);
+    return 0;
+}
@@ -0,0 +1,90 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <utility>
+
+/*
+ * The router benchmark built as C++, adding the compile-time router (teapot::router<...>) as
+ * the "cpp" engine. Its routes are template arguments, so only the static sets of 10 and 100
+ * routes are instantiated here, with the same paths bench_router.c builds at run time.
+ *
+ * Usage: bench_router_cpp [ms per case]   (default 200)
+ */
+
+// "/api/v<i % 3 + 1>/res<i>/items", the static route i of bench_router.c
+template <size_t I>
+struct bench_path
+{
+    struct text
+    {
+        char data[48];
+        size_t size;
+    };
+
+    static constexpr void append(text &t, const char *s)
+    {
+        while (*s != '\0')
+        {
+            t.data[t.size++] = *s++;
+        }
+    }
+
+    static constexpr void append_decimal(text &t, size_t n)
+    {
+        char digits[20] = {};
+        size_t count = 0;
+        do
+        {
+            digits[count++] = (char)('0' + n % 10);
+            n /= 10;
+        } while (n > 0);
+        while (count > 0)
+        {
+            t.data[t.size++] = digits[--count];
+        }
+    }
+
+    static constexpr text make()
+    {
+        text t{};
+        append(t, "/api/v");
+        append_decimal(t, I % 3 + 1);
+        append(t, "/res");
+        append_decimal(t, I);
+        append(t, "/items");
+        return t;
+    }
+
+    static constexpr text built = make();
+    static constexpr const char *value = built.data;
+    static constexpr size_t size = built.size;
+};
+
+static teapot_response cpp_bench_handler(const teapot_request *)
+{
+    teapot_response resp = {0};
+    return resp;
+}
+
+template <size_t... Is>
+static teapot_dispatch_fn cpp_router(std::index_sequence<Is...>)
+{
+    using app = teapot::router<teapot::detail::route_impl<TEAPOT_GET, bench_path<Is>, cpp_bench_handler>...>;
+    return app::dispatch;
+}
+
+// Dispatch of the static set of 'route_count' routes, NULL if it isn't instantiated
+static teapot_dispatch_fn cpp_router_for(size_t route_count)
+{
+    switch (route_count)
+    {
+    case 10:
+        return cpp_router(std::make_index_sequence<10>());
+    case 100:
+        return cpp_router(std::make_index_sequence<100>());
+    default:
+        return nullptr;
+    }
+}
+
+#include "bench_router.c"
@@ -5,37 +5,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _WIN32
-/* Winsock must be included before windows.h to avoid conflicts */
-#include <winsock2.h>
-#include <windows.h>
-#include <wincon.h>
-
-/* Fallbacks if the toolchain doesn't expose these (MinGW variants sometimes differ). */
-#ifndef CTRL_C_EVENT
-#define CTRL_C_EVENT 0
-#endif
-#ifndef CTRL_BREAK_EVENT
-#define CTRL_BREAK_EVENT 1
-#endif
-#ifndef CTRL_CLOSE_EVENT
-#define CTRL_CLOSE_EVENT 2
-#endif
-
-/* Ensure SetConsoleCtrlHandler prototype is available. If headers don't provide it, declare it. */
-#ifndef _MSC_VER /* MSVC will already have it */
-#ifndef SetConsoleCtrlHandler
-BOOL WINAPI SetConsoleCtrlHandler(BOOL(WINAPI *HandlerRoutine)(DWORD), BOOL Add);
-#endif
-#endif
-
-#else
-#include <signal.h>
-#include <pthread.h>
-#include <poll.h>
-#include <unistd.h>
-#endif
-
 /* ---------------- simple handlers ---------------- */
 teapot_response hello_handler(const teapot_request *req)
 {
@@ -93,197 +62,6 @@ teapot_response echo_handler(const teapot_request *req)
     return resp;
 }
 
-/* ---------------- job queue (cross-platform) ---------------- */
-typedef struct job_s
-{
-    stb_teapot_socket_t client;
-    struct job_s *next;
-} job_t;
-
-typedef struct
-{
-    job_t *head;
-    job_t *tail;
-    int shutdown;
-#ifdef _WIN32
-    CRITICAL_SECTION mutex;
-    CONDITION_VARIABLE cond_var;
-#else
-    pthread_mutex_t m;
-    pthread_cond_t cv;
-#endif
-} job_queue_t;
-
-static job_queue_t g_queue;
-
-static void job_queue_init(job_queue_t *q)
-{
-    q->head = q->tail = NULL;
-    q->shutdown = 0;
-#ifdef _WIN32
-    InitializeCriticalSection(&q->mutex);
-    InitializeConditionVariable(&q->cond_var);
-#else
-    pthread_mutex_init(&q->m, NULL);
-    pthread_cond_init(&q->cv, NULL);
-#endif
-}
-
-static void job_queue_push(job_queue_t *q, stb_teapot_socket_t client)
-{
-    job_t *j = (job_t *)malloc(sizeof(job_t));
-    if (!j)
-    {
-        return;
-    }
-
-    j->client = client;
-    j->next = NULL;
-#ifdef _WIN32
-    EnterCriticalSection(&q->mutex);
-    if (q->tail)
-    {
-        q->tail->next = j;
-    }
-    else
-    {
-        q->head = j;
-    }
-    q->tail = j;
-    LeaveCriticalSection(&q->mutex);
-    WakeConditionVariable(&q->cond_var);
-#else
-    pthread_mutex_lock(&q->m);
-    if (q->tail)
-    {
-        q->tail->next = j;
-    }
-    else
-    {
-        q->head = j;
-    }
-    q->tail = j;
-    pthread_cond_signal(&q->cv);
-    pthread_mutex_unlock(&q->m);
-#endif
-}
-
-static int job_queue_pop(job_queue_t *q, stb_teapot_socket_t *out_client)
-{
-#ifdef _WIN32
-    EnterCriticalSection(&q->mutex);
-    while (!q->head && !q->shutdown)
-        SleepConditionVariableCS(&q->cond_var, &q->mutex, INFINITE);
-    if (q->shutdown && !q->head)
-    {
-        LeaveCriticalSection(&q->mutex);
-        return 0;
-    }
-    job_t *j = q->head;
-    q->head = j->next;
-    if (!q->head)
-    {
-        q->tail = NULL;
-    }
-    LeaveCriticalSection(&q->mutex);
-#else
-    pthread_mutex_lock(&q->m);
-    while (!q->head && !q->shutdown)
-        pthread_cond_wait(&q->cv, &q->m);
-    if (q->shutdown && !q->head)
-    {
-        pthread_mutex_unlock(&q->m);
-        return 0;
-    }
-    job_t *j = q->head;
-    q->head = j->next;
-    if (!q->head)
-        q->tail = NULL;
-    pthread_mutex_unlock(&q->m);
-#endif
-    *out_client = j->client;
-    free(j);
-    return 1;
-}
-
-static void job_queue_shutdown(job_queue_t *q)
-{
-#ifdef _WIN32
-    EnterCriticalSection(&q->mutex);
-    q->shutdown = 1;
-    LeaveCriticalSection(&q->mutex);
-    WakeAllConditionVariable(&q->cond_var);
-#else
-    pthread_mutex_lock(&q->m);
-    q->shutdown = 1;
-    pthread_cond_broadcast(&q->cv);
-    pthread_mutex_unlock(&q->m);
-#endif
-}
-
-/* ---------------- worker ---------------- */
-typedef struct
-{
-    teapot_server *server;
-} worker_arg_t;
-
-#ifdef _WIN32
-static DWORD WINAPI worker_thread_fn(LPVOID arg)
-{
-    printf("Worker thread started: %lu\n", GetCurrentThreadId());
-
-    worker_arg_t *w = (worker_arg_t *)arg;
-    stb_teapot_socket_t client;
-    while (job_queue_pop(&g_queue, &client))
-    {
-        if ((int)client < 0)
-        {
-            continue;
-        }
-        teapot_handle_client_connection(w->server, client);
-    }
-    return 0;
-}
-#else
-static void *worker_thread_fn(void *arg)
-{
-    printf("Worker thread started: %lu\n", (unsigned long)pthread_self());
-
-    worker_arg_t *w = (worker_arg_t *)arg;
-    stb_teapot_socket_t client;
-    while (job_queue_pop(&g_queue, &client))
-    {
-        if ((int)client < 0)
-            continue;
-        teapot_handle_client_connection(w->server, client);
-    }
-    return NULL;
-}
-#endif
-
-/* ---------------- graceful shutdown ---------------- */
-static volatile int g_terminate = 0;
-
-#ifdef _WIN32
-static BOOL WINAPI console_handler(DWORD ctrlType)
-{
-    if (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT || ctrlType == CTRL_CLOSE_EVENT)
-    {
-        g_terminate = 1;
-        job_queue_shutdown(&g_queue);
-        return TRUE;
-    }
-    return FALSE;
-}
-#else
-static void sigint_handler(int sig)
-{
-    (void)sig;
-    g_terminate = 1;
-    job_queue_shutdown(&g_queue);
-}
-#endif
-
 /* ---------------- main ---------------- */
 int main(void)
 {
@@ -293,107 +71,31 @@ int main(void)
         {TEAPOT_POST, "/echo", echo_handler},
     };
 
+    /* shed load instead of growing without bound under upload storms */
+    static teapot_memory_budget budget = {
+        .global_limit = 64 * 1024 * 1024,
+        .connection_limit = 1024 * 1024,
+    };
+
     teapot_server server = {
         .port = 8080,
         .routes = routes,
         .route_count = sizeof(routes) / sizeof(routes[0]),
+        .allocator = &tp_thread_cache_allocator, /* per-worker free lists instead of malloc per request */
+        .budget = &budget,
     };
 
-    stb_teapot_socket_t listen_sock;
-    if (teapot_listener_open(&server, &listen_sock) < 0)
-    {
-        fprintf(stderr, "failed to open listener\n");
-        return 1;
-    }
-
-    printf("thread-pool cross-platform server listening on %d\n", server.port);
-
-    job_queue_init(&g_queue);
-
-    const int WORKER_COUNT = 4;
-#ifdef _WIN32
-    /* allocate worker handles */
-    HANDLE *workers = (HANDLE *)malloc((size_t)WORKER_COUNT * sizeof(HANDLE));
-    worker_arg_t warg = {.server = &server};
-    for (int i = 0; i < WORKER_COUNT; ++i)
-    {
-        workers[i] = CreateThread(NULL, 0, worker_thread_fn, &warg, 0, NULL);
-        if (!workers[i])
-        {
-            fprintf(stderr, "CreateThread failed\n");
-        }
-    }
-    SetConsoleCtrlHandler(console_handler, TRUE);
-#else
-    pthread_t *workers = (pthread_t *)malloc((size_t)WORKER_COUNT * sizeof(pthread_t));
-    worker_arg_t warg = {.server = &server};
-    for (int i = 0; i < WORKER_COUNT; ++i)
-    {
-        pthread_create(&workers[i], NULL, worker_thread_fn, &warg);
-    }
-    signal(SIGINT, sigint_handler);
-#endif
-
-    /* accept loop using poll/WSAPoll */
-    while (!g_terminate)
-    {
-#ifdef _WIN32
-        WSAPOLLFD pfd;
-        pfd.fd = (SOCKET)listen_sock;
-        pfd.events = POLLIN;
-        int rv = WSAPoll(&pfd, 1, 500); /* timeout ms */
-        if (rv < 0)
-        {
-            break;
-        }
-
-        if (rv == 0)
-        {
-            continue;
-        }
-
-        if (pfd.revents & POLLIN)
-        {
-            stb_teapot_socket_t client = teapot_listener_accept(listen_sock);
-            if ((int)client >= 0)
-                job_queue_push(&g_queue, client);
-        }
-#else
-        struct pollfd pfd = {.fd = (int)listen_sock, .events = POLLIN};
-        int rv = poll(&pfd, 1, 500);
-        if (rv < 0)
-            break;
-        if (rv == 0)
-            continue;
-        if (pfd.revents & POLLIN)
-        {
-            stb_teapot_socket_t client = teapot_listener_accept(listen_sock);
-            if ((int)client >= 0)
-                job_queue_push(&g_queue, client);
-        }
-#endif
-    }
+    printf("thread-pool server listening on %d (%d workers, Ctrl+C to stop)\n", server.port, teapot_cpu_count());
 
-    /* shutdown and join workers */
-    job_queue_shutdown(&g_queue);
-#ifdef _WIN32
-    for (int i = 0; i < WORKER_COUNT; ++i)
+    /* one worker per CPU; connections are handed to idle workers without allocating */
+    if (teapot_serve_pooled(&server, 0) < 0)
     {
-        if (workers[i])
-        {
-            WaitForSingleObject(workers[i], INFINITE);
-            CloseHandle(workers[i]);
-        }
+        fprintf(stderr, "failed to start the server\n");
+        return 1;
     }
-    free(workers);
-#else
-    for (int i = 0; i < WORKER_COUNT; ++i)
-        pthread_join(workers[i], NULL);
-    free(workers);
-    teapot_close((stb_teapot_socket_t)listen_sock);
-#endif
 
-    teapot_close((stb_teapot_socket_t)listen_sock);
-    printf("server stopped\n");
+    teapot_server_free(&server);
+    tp_thread_cache_trim();
+    printf("server stopped (peak memory %zu bytes, %zu requests shed)\n", budget.peak, budget.rejected);
     return 0;
-}
\ No newline at end of file
+}
@@ -11,11 +11,10 @@
 #include <signal.h>
 #endif
 
-typedef struct
-{
-    stb_teapot_socket_t client_socket;
-    teapot_server server;
-} threaded_server;
+#define MAX_CONNECTIONS 1024
+
+/* per-connection state lives in preallocated slots: accepting a connection doesn't malloc */
+static teapot_conn_table g_conns;
 
 teapot_response hello_handler(const teapot_request *req)
 {
@@ -78,31 +77,23 @@ teapot_response echo_handler(const teapot_request *req)
     return resp;
 }
 
-/* Worker entry: receives a teapot_socket_t* (heap-allocated), handles client and frees it. */
+/* Worker entry: receives the connection's slot, handles the client and gives the slot back. */
 #ifdef _WIN32
 static DWORD WINAPI client_thread_func(LPVOID arg)
 {
     printf("Started thread %lu\n", GetCurrentThreadId());
 
-    threaded_server *pc = (threaded_server *)arg;
-    if (pc)
-    {
-        teapot_handle_client_connection(&pc->server, pc->client_socket); /* pass server pointer if needed */
-        teapot_close(pc->client_socket);
-        free(pc);
-    }
+    teapot_conn *conn = (teapot_conn *)arg;
+    teapot_handle_client_connection(conn->server, conn->socket); /* closes the socket */
+    teapot_conn_release(&g_conns, conn->handle);
     return 0;
 }
 #else
 static void *client_thread_func(void *arg)
 {
-    threaded_server *pc = (threaded_server *)arg;
-    if (pc)
-    {
-        teapot_handle_client_connection(&pc->server, pc->client_socket); /* pass server pointer if needed */
-        teapot_close(pc->client_socket);
-        free(pc);
-    }
+    teapot_conn *conn = (teapot_conn *)arg;
+    teapot_handle_client_connection(conn->server, conn->socket); /* closes the socket */
+    teapot_conn_release(&g_conns, conn->handle);
     return NULL;
 }
 #endif
@@ -128,6 +119,12 @@ int main(void)
         return 1;
     }
 
+    if (teapot_conn_table_init(&g_conns, MAX_CONNECTIONS) < 0)
+    {
+        fprintf(stderr, "failed to allocate the connection table\n");
+        return 1;
+    }
+
     printf("threaded server listening on %d\n", server.port);
 
     while (1)
@@ -138,17 +135,16 @@ int main(void)
             continue;
         }
 
-        /* allocate socket on heap for thread arg (avoid race on stack) */
-        threaded_server *parg = malloc(sizeof(threaded_server));
-        if (!parg)
+        /* the thread gets a slot of its own (avoid race on stack); when all are taken, shed the connection */
+        teapot_conn *conn = teapot_conn_acquire(&g_conns, &server, client);
+        if (!conn)
         {
             teapot_close((stb_teapot_socket_t)client);
             continue;
         }
-        *parg = (threaded_server){.server = server, .client_socket = client};
 
 #ifdef _WIN32
-        HANDLE h = CreateThread(NULL, 0, client_thread_func, parg, 0, NULL);
+        HANDLE h = CreateThread(NULL, 0, client_thread_func, conn, 0, NULL);
         if (h)
         {
             CloseHandle(h); /* let thread run detached */
@@ -156,23 +152,24 @@ int main(void)
         else
         {
             teapot_close((stb_teapot_socket_t)client);
-            free(parg);
+            teapot_conn_release(&g_conns, conn->handle);
         }
 #else
         pthread_t thr;
         pthread_attr_t attr;
         pthread_attr_init(&attr);
         pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-        if (pthread_create(&thr, &attr, client_thread_func, parg) != 0)
+        if (pthread_create(&thr, &attr, client_thread_func, conn) != 0)
         {
             teapot_close((stb_teapot_socket_t)client);
-            free(parg);
+            teapot_conn_release(&g_conns, conn->handle);
         }
         pthread_attr_destroy(&attr);
 #endif
     }
 
     /* unreachable in this simple example */
+    teapot_conn_table_free(&g_conns);
     teapot_close((stb_teapot_socket_t)listen_sock);
     return 0;
 }
\ No newline at end of file
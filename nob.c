@@ -3,13 +3,16 @@
 
 #ifdef _WIN32
 #define CC "gcc.exe"
+#define CXX "g++.exe"
 #else
 #define CC "gcc"
+#define CXX "g++"
 #endif
 
 #define BUILD_DIR "./build/"
 #define TEST_DIR "./tests/"
 #define EXAMPLE_DIR "./examples/"
+#define BENCH_DIR "./bench/"
 
 #define COMPILE_FLAGS "-O2", "-g",                                                                           \
                       "-Wall", "-Wextra", "-Wpedantic", "-Werror", "-Wconversion", "-Wimplicit-fallthrough", \
@@ -21,6 +24,18 @@
                       "-fstack-protector-strong",                                                            \
                       "-std=c17"
 
+// Same warnings for C++ sources, minus the C-only ones. Missing field initializers are allowed
+// so that C-style `{0}` initialization in the header stays warning-free.
+#define CXX_COMPILE_FLAGS "-O2", "-g",                                                                  \
+                          "-Wall", "-Wextra", "-Wpedantic", "-Werror", "-Wconversion", "-Wimplicit-fallthrough", \
+                          "-Wshadow", "-Wpointer-arith", "-Wcast-qual", "-Wno-missing-field-initializers",       \
+                          "-D_FORTIFY_SOURCE=2",                                                        \
+                          "-D_GLIBCXX_ASSERTIONS",                                                      \
+                          "-fexceptions",                                                               \
+                          "-fstack-clash-protection",                                                   \
+                          "-fstack-protector-strong",                                                   \
+                          "-std=c++17"
+
 #ifdef _WIN32
 #define LINK_FLAGS "-O2", "-lws2_32"
 #else
@@ -39,14 +54,30 @@ static int compile_exe(
     Nob_Cmd cmd = {0};
     Nob_File_Paths dep_files = {0};
 
+    bool cplusplus = src_count > 0 && nob_sv_end_with(nob_sv_from_cstr(source_files[0]), ".cpp");
+
+    if (cplusplus)
+    {
+        nob_cmd_append(&cmd, CXX);
+    }
+    else
+    {
 #ifdef _WIN32
-    nob_cmd_append(&cmd, CC);
+        nob_cmd_append(&cmd, CC);
 #else
-    nob_cc(&cmd);
+        nob_cc(&cmd);
 #endif
+    }
 
     nob_cc_flags(&cmd);
-    nob_cmd_append(&cmd, COMPILE_FLAGS);
+    if (cplusplus)
+    {
+        nob_cmd_append(&cmd, CXX_COMPILE_FLAGS);
+    }
+    else
+    {
+        nob_cmd_append(&cmd, COMPILE_FLAGS);
+    }
 
     nob_cc_output(&cmd, output_file);
 
@@ -83,10 +114,367 @@ defer:
     return 0;
 }
 
+// =====================================================
+// Static route table generator
+// =====================================================
+// Reads a route spec with one "METHOD PATH HANDLER" per line ('#' starts a comment) and emits a
+// C source with a minimal perfect hash (hash and displace) over (method, path) for the static
+// routes, plus a teapot_route array with every route for the regular router:
+//
+//     const teapot_static_routes <prefix>_static_routes;
+//     const teapot_route <prefix>_routes[];
+//     const size_t <prefix>_route_count;
+//
+// Routes with ':param' or '*' segments only go to the teapot_route array.
+
+typedef struct
+{
+    Nob_String_View method;
+    Nob_String_View path;
+    Nob_String_View handler;
+    uint32_t bucket_hash;
+} Route_Spec;
+
+typedef struct
+{
+    Route_Spec *items;
+    size_t count;
+    size_t capacity;
+} Route_Specs;
+
+// Must stay in sync with tp_route_hash() in stb_teapot.h
+static uint32_t route_fnv1a(uint32_t h, const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t route_hash(uint32_t seed, Nob_String_View method, Nob_String_View path)
+{
+    uint32_t h = 2166136261u ^ seed;
+    h = route_fnv1a(h, method.data, method.count);
+    h = route_fnv1a(h, " ", 1);
+    h = route_fnv1a(h, path.data, path.count);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static bool route_method_known(Nob_String_View method)
+{
+    const char *methods[] = {"GET", "POST", "PUT", "DELETE", "PATCH", "HEAD", "OPTIONS"};
+    for (size_t i = 0; i < NOB_ARRAY_LEN(methods); i++)
+    {
+        if (nob_sv_eq(method, nob_sv_from_cstr(methods[i])))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool route_is_dynamic(Nob_String_View path)
+{
+    if (path.count > 0 && path.data[0] == '~')
+    {
+        return true; // pattern route, see teapot_router
+    }
+    for (size_t i = 1; i < path.count; i++)
+    {
+        if (path.data[i - 1] == '/' && (path.data[i] == ':' || path.data[i] == '*'))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static size_t *sort_buckets_sizes = NULL;
+
+static int compare_buckets_by_size(const void *a, const void *b)
+{
+    size_t sa = sort_buckets_sizes[*(const size_t *)a];
+    size_t sb = sort_buckets_sizes[*(const size_t *)b];
+    return (sa < sb) - (sa > sb);
+}
+
+// Hash and displace: place the biggest buckets first, searching a seed that sends all of
+// their keys to free slots, then drop single-key buckets directly into the remaining slots.
+static bool build_perfect_hash(Route_Specs *statics, int32_t *displacements, size_t *slots)
+{
+    size_t n = statics->count;
+    size_t *bucket_sizes = calloc(n, sizeof(size_t));
+    size_t *bucket_start = calloc(n + 1, sizeof(size_t));
+    size_t *keys = calloc(n, sizeof(size_t)); // key indices grouped by bucket
+    size_t *order = calloc(n, sizeof(size_t)); // buckets, biggest first
+    bool *taken = calloc(n, sizeof(bool));
+    bool ok = true;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        statics->items[i].bucket_hash = route_hash(0, statics->items[i].method, statics->items[i].path) % (uint32_t)n;
+        bucket_sizes[statics->items[i].bucket_hash]++;
+    }
+
+    for (size_t b = 0; b < n; b++)
+    {
+        bucket_start[b + 1] = bucket_start[b] + bucket_sizes[b];
+        order[b] = b;
+        displacements[b] = 0;
+    }
+
+    size_t *fill = calloc(n, sizeof(size_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t b = statics->items[i].bucket_hash;
+        keys[bucket_start[b] + fill[b]++] = i;
+    }
+    free(fill);
+
+    sort_buckets_sizes = bucket_sizes;
+    qsort(order, n, sizeof(size_t), compare_buckets_by_size);
+
+    size_t free_slot = 0;
+    for (size_t o = 0; o < n && ok && bucket_sizes[order[o]] > 0; o++)
+    {
+        size_t b = order[o];
+        size_t *bucket_keys = &keys[bucket_start[b]];
+
+        if (bucket_sizes[b] == 1)
+        {
+            while (taken[free_slot])
+            {
+                free_slot++;
+            }
+            taken[free_slot] = true;
+            slots[bucket_keys[0]] = free_slot;
+            displacements[b] = -(int32_t)free_slot - 1;
+            continue;
+        }
+
+        bool placed = false;
+        for (uint32_t seed = 1; seed < (1u << 24) && !placed; seed++)
+        {
+            size_t k = 0;
+            for (; k < bucket_sizes[b]; k++)
+            {
+                Route_Spec *r = &statics->items[bucket_keys[k]];
+                size_t slot = route_hash(seed, r->method, r->path) % (uint32_t)n;
+                if (taken[slot])
+                {
+                    break;
+                }
+                // reserve while checking, so two keys of this bucket can't share a slot
+                taken[slot] = true;
+                slots[bucket_keys[k]] = slot;
+            }
+
+            placed = (k == bucket_sizes[b]);
+            if (placed)
+            {
+                displacements[b] = (int32_t)seed;
+            }
+            else
+            {
+                while (k > 0)
+                {
+                    taken[slots[bucket_keys[--k]]] = false;
+                }
+            }
+        }
+
+        if (!placed)
+        {
+            nob_log(NOB_ERROR, "could not find a perfect hash seed for bucket %zu", b);
+            ok = false;
+        }
+    }
+
+    free(bucket_sizes);
+    free(bucket_start);
+    free(keys);
+    free(order);
+    free(taken);
+    return ok;
+}
+
+static int generate_route_table(const char *spec_path, const char *output_path, const char *prefix)
+{
+    int ret = 0;
+    Nob_String_Builder spec = {0};
+    Nob_String_Builder out = {0};
+    Route_Specs routes = {0};
+    Route_Specs statics = {0};
+    int32_t *displacements = NULL;
+    size_t *slots = NULL;
+
+    const char *inputs[] = {spec_path, __FILE__};
+    if (!nob_needs_rebuild(output_path, inputs, NOB_ARRAY_LEN(inputs)))
+    {
+        nob_log(NOB_INFO, "%s up to date", output_path);
+        goto defer;
+    }
+
+    if (!nob_read_entire_file(spec_path, &spec))
+    {
+        ret = 1;
+        goto defer;
+    }
+
+    Nob_String_View content = nob_sb_to_sv(spec);
+    for (size_t line_no = 1; content.count > 0; line_no++)
+    {
+        Nob_String_View line = nob_sv_chop_by_delim(&content, '\n');
+        Nob_String_View comment = line;
+        line = nob_sv_trim(nob_sv_chop_by_delim(&comment, '#'));
+        if (line.count == 0)
+        {
+            continue;
+        }
+
+        Route_Spec r = {0};
+        r.method = nob_sv_trim(nob_sv_chop_by_delim(&line, ' '));
+        line = nob_sv_trim(line);
+        r.path = nob_sv_trim(nob_sv_chop_by_delim(&line, ' '));
+        r.handler = nob_sv_trim(line);
+
+        if (!route_method_known(r.method) || r.path.count == 0 || r.path.data[0] != '/' || r.handler.count == 0)
+        {
+            nob_log(NOB_ERROR, "%s:%zu: expected \"METHOD /path handler\"", spec_path, line_no);
+            ret = 1;
+            goto defer;
+        }
+
+        for (size_t i = 0; i < routes.count; i++)
+        {
+            if (nob_sv_eq(routes.items[i].method, r.method) && nob_sv_eq(routes.items[i].path, r.path))
+            {
+                nob_log(NOB_ERROR, "%s:%zu: duplicate route " SV_Fmt " " SV_Fmt, spec_path, line_no,
+                        SV_Arg(r.method), SV_Arg(r.path));
+                ret = 1;
+                goto defer;
+            }
+        }
+
+        nob_da_append(&routes, r);
+        if (!route_is_dynamic(r.path))
+        {
+            nob_da_append(&statics, r);
+        }
+    }
+
+    size_t n = statics.count;
+    displacements = calloc(n + 1, sizeof(int32_t));
+    slots = calloc(n + 1, sizeof(size_t));
+
+    if (n > 0 && !build_perfect_hash(&statics, displacements, slots))
+    {
+        ret = 1;
+        goto defer;
+    }
+
+    nob_sb_appendf(&out, "// Generated by nob.c from %s. Do not edit.\n", spec_path);
+    nob_sb_appendf(&out, "#include \"../stb_teapot.h\"\n\n");
+
+    for (size_t i = 0; i < routes.count; i++)
+    {
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; j++)
+        {
+            seen = nob_sv_eq(routes.items[i].handler, routes.items[j].handler);
+        }
+        if (!seen)
+        {
+            nob_sb_appendf(&out, "teapot_response " SV_Fmt "(const teapot_request *req);\n", SV_Arg(routes.items[i].handler));
+        }
+    }
+
+    if (n > 0)
+    {
+        nob_sb_appendf(&out, "\nstatic const teapot_static_route %s_static_entries[%zu] = {\n", prefix, n);
+        for (size_t slot = 0; slot < n; slot++)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                if (slots[i] != slot)
+                {
+                    continue;
+                }
+                Route_Spec *r = &statics.items[i];
+                nob_sb_appendf(&out, "    {TEAPOT_" SV_Fmt ", \"" SV_Fmt "\", %zu, " SV_Fmt "},\n",
+                               SV_Arg(r->method), SV_Arg(r->path), r->path.count, SV_Arg(r->handler));
+            }
+        }
+        nob_sb_appendf(&out, "};\n\n");
+
+        nob_sb_appendf(&out, "static const int32_t %s_static_displacements[%zu] = {", prefix, n);
+        for (size_t b = 0; b < n; b++)
+        {
+            nob_sb_appendf(&out, "%s%d", b % 16 == 0 ? "\n    " : " ", displacements[b]);
+            if (b + 1 < n)
+            {
+                nob_sb_appendf(&out, ",");
+            }
+        }
+        nob_sb_appendf(&out, "\n};\n\n");
+        nob_sb_appendf(&out, "const teapot_static_routes %s_static_routes = {%s_static_displacements, %s_static_entries, %zu};\n",
+                       prefix, prefix, prefix, n);
+    }
+    else
+    {
+        nob_sb_appendf(&out, "\nconst teapot_static_routes %s_static_routes = {0};\n", prefix);
+    }
+
+    nob_sb_appendf(&out, "\nconst teapot_route %s_routes[] = {\n", prefix);
+    for (size_t i = 0; i < routes.count; i++)
+    {
+        Route_Spec *r = &routes.items[i];
+        nob_sb_appendf(&out, "    {TEAPOT_" SV_Fmt ", \"" SV_Fmt "\", " SV_Fmt "},\n",
+                       SV_Arg(r->method), SV_Arg(r->path), SV_Arg(r->handler));
+    }
+    nob_sb_appendf(&out, "};\n\n");
+    nob_sb_appendf(&out, "const size_t %s_route_count = %zu;\n", prefix, routes.count);
+
+    if (!nob_write_entire_file(output_path, out.items, out.count))
+    {
+        ret = 1;
+        goto defer;
+    }
+    nob_log(NOB_INFO, "generated %s (%zu routes, %zu static)", output_path, routes.count, n);
+
+defer:
+    free(displacements);
+    free(slots);
+    nob_da_free(routes);
+    nob_da_free(statics);
+    nob_sb_free(spec);
+    nob_sb_free(out);
+    return ret;
+}
+
 const char *tests_and_examples[] = {
     TEST_DIR "low_level_test_stb_teapot.c",
     TEST_DIR "header_parse.c",
     TEST_DIR "unit_test_headers.c",
+    TEST_DIR "unit_test_router.c",
+    TEST_DIR "unit_test_static_routes.c",
+    TEST_DIR "unit_test_cpp_router.cpp",
+    TEST_DIR "unit_test_arena.c",
+    TEST_DIR "unit_test_io_buffer.c",
+    TEST_DIR "unit_test_conn_table.c",
+    TEST_DIR "unit_test_allocator.c",
+    TEST_DIR "unit_test_budget.c",
+    TEST_DIR "unit_test_split.c",
+    TEST_DIR "unit_test_format.c",
+    TEST_DIR "unit_test_region.c",
+    TEST_DIR "unit_test_pool.c",
     EXAMPLE_DIR "threaded_server.c",
     EXAMPLE_DIR "thread_pool_server_crossplat.c",
 };
@@ -106,17 +494,23 @@ static int compile_all_exe(const char **exes, size_t test_count)
         const char *exe_name = nob_path_name(exe_source);
         sprintf(temp, "%s", exe_name);
 
-        char *exe = strtok(temp, ".c");
+        char *ext = strrchr(temp, '.');
+        if (ext)
+        {
+            *ext = '\0';
+        }
 
-        nob_sb_appendf(&sb, BUILD_DIR "%s", exe);
+        nob_sb_appendf(&sb, BUILD_DIR "%s", temp);
 
 #ifdef _WIN32
         nob_sb_append_cstr(&sb, ".exe");
 #endif
         nob_sb_append_null(&sb);
 
-        const char **deps = (const char *[]){
+        const char *deps[] = {
             "stb_teapot.h",
+            TEST_DIR "serve.h",
+            BUILD_DIR "test_routes.c",
         };
 
         if (0 != compile_exe(&exe_source, 1, deps, NOB_ARRAY_LEN(deps), sb.items))
@@ -132,9 +526,43 @@ defer:
     return ret;
 }
 
+// Built with everything else so they don't rot, run with `./nob bench`
+static const char *benches[] = {
+    BENCH_DIR "bench_router.c",
+    BENCH_DIR "bench_router_cpp.cpp",
+    BENCH_DIR "bench_headers.c",
+    BENCH_DIR "bench_handoff.c",
+    BENCH_DIR "bench_affinity.c",
+};
+
+static int run_benches(void)
+{
+    for (size_t i = 0; i < NOB_ARRAY_LEN(benches); i++)
+    {
+        char exe[260] = {0};
+        snprintf(exe, sizeof(exe), BUILD_DIR "%s", nob_path_name(benches[i]));
+        char *ext = strrchr(exe, '.');
+        if (ext)
+        {
+            *ext = '\0';
+        }
+
+        Nob_Cmd cmd = {0};
+        nob_cmd_append(&cmd, exe);
+        bool ok = nob_cmd_run_sync_and_reset(&cmd);
+        nob_cmd_free(cmd);
+        if (!ok)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     int ret = 0;
+    bool bench = false;
     NOB_GO_REBUILD_URSELF(argc, argv);
 
     if (!nob_mkdir_if_not_exists(BUILD_DIR))
@@ -156,9 +584,27 @@ int main(int argc, char **argv)
             nob_delete_file(BUILD_DIR);
             goto defer;
         }
+
+        if (0 == strcmp(cmd_arg, "bench"))
+        {
+            bench = true;
+        }
+    }
+
+    if (0 != generate_route_table(TEST_DIR "routes.txt", BUILD_DIR "test_routes.c", "test"))
+    {
+        ret = 1;
+        goto defer;
+    }
+
+    if (0 != compile_all_exe(tests_and_examples, NOB_ARRAY_LEN(tests_and_examples)) ||
+        0 != compile_all_exe(benches, NOB_ARRAY_LEN(benches)))
+    {
+        ret = 1;
+        goto defer;
     }
 
-    if (0 != compile_all_exe(tests_and_examples, NOB_ARRAY_LEN(tests_and_examples)))
+    if (bench && 0 != run_benches())
     {
         ret = 1;
         goto defer;
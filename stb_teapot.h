@@ -49,6 +49,7 @@ extern "C"
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <pthread.h>
 typedef int stb_teapot_socket_t;
 int socket_ok(stb_teapot_socket_t s);
 
@@ -70,63 +71,174 @@ int socket_ok(stb_teapot_socket_t s);
 #define TP_ASSERT assert
 #endif /* TP_ASSERT */
 
+// TP_NO_HEAP: nothing is allocated outside the memory handed to a teapot_region. Without a
+// current allocator every allocation fails.
 #ifndef TP_REALLOC
+#ifdef TP_NO_HEAP
+#define TP_REALLOC(ptr, size) ((void)(ptr), (void)(size), (void *)NULL)
+#else
 #include <stdlib.h>
 #define TP_REALLOC realloc
+#endif
 #endif /* TP_REALLOC */
 
 #ifndef TP_FREE
+#ifdef TP_NO_HEAP
+#define TP_FREE(ptr) ((void)(ptr))
+#else
 #include <stdlib.h>
 #define TP_FREE free
+#endif
 #endif /* TP_FREE */
 
+#if defined(__cplusplus)
+#define TP_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define TP_THREAD_LOCAL __declspec(thread)
+#else
+#define TP_THREAD_LOCAL _Thread_local
+#endif
+
+    // =====================================================
+    // 🧮 Allocators
+    // =====================================================
+    // TP_REALLOC/TP_FREE pick the allocator at compile time. A tp_allocator picks it at run time and
+    // carries a context. The library allocates through tp_realloc()/tp_free(), which use the calling
+    // thread's current allocator (TP_REALLOC/TP_FREE when none is set). A server installs its own
+    // (teapot_server::allocator) while it builds, frees and serves connections. Memory must be freed
+    // under the allocator that allocated it.
+    // The process-wide caches (I/O buffer pool, connection tables) always use TP_REALLOC/TP_FREE,
+    // except under TP_NO_HEAP where they take the current allocator too.
+    typedef struct tp_allocator
+    {
+        void *ctx;
+        void *(*realloc_fn)(void *ctx, void *ptr, size_t size); // ptr may be NULL
+        void (*free_fn)(void *ctx, void *ptr);                   // ptr may be NULL
+    } tp_allocator;
+
+    void *tp_realloc(void *ptr, size_t size);
+    void tp_free(void *ptr);
+    // Make 'allocator' (NULL: TP_REALLOC/TP_FREE) current on this thread. Returns the previous one.
+    const tp_allocator *tp_allocator_use(const tp_allocator *allocator);
+
+    // TP_REALLOC/TP_FREE
+    extern const tp_allocator tp_default_allocator;
+
+    // Blocks of 32 bytes to 64K come from per-thread, per-size-class free lists. Growing a block
+    // within its class is free. Larger blocks go straight to TP_REALLOC/TP_FREE.
+    extern const tp_allocator tp_thread_cache_allocator;
+    // Free the calling thread's cached blocks, e.g. before a worker thread exits
+    void tp_thread_cache_trim(void);
+
+#ifndef TP_THREAD_CACHE_DEPTH
+#define TP_THREAD_CACHE_DEPTH 64 // free blocks kept per thread and size class
+#endif
+
+    // Counts the calls and bytes going to 'parent'. Not thread-safe: meant for tests and benchmarks.
+    typedef struct
+    {
+        tp_allocator allocator; // the allocator to install, its ctx points back here
+        const tp_allocator *parent;
+        size_t allocs; // realloc calls with a NULL ptr
+        size_t reallocs;
+        size_t frees;
+        size_t bytes_live;
+        size_t bytes_peak;
+        size_t bytes_total; // sum of all requested sizes
+    } tp_counting_allocator;
+
+    // 'parent' NULL means tp_default_allocator
+    void tp_counting_allocator_init(tp_counting_allocator *counter, const tp_allocator *parent);
+
+#ifdef TP_NO_HEAP
+#define TP_CACHE_REALLOC tp_realloc
+#define TP_CACHE_FREE tp_free
+#else
+#define TP_CACHE_REALLOC TP_REALLOC
+#define TP_CACHE_FREE TP_FREE
+#endif
+
+    // Under TP_NO_HEAP a region running out is no reason to abort: arrays, string builders and
+    // arenas that can't grow stay as they were and the failure is counted on the calling thread
+    // instead, for the server to answer the request with 503 and for builds to return -1.
+    // Elsewhere a failed growth asserts.
+    void tp_out_of_memory_note(void);
+    // Failed growths on this thread so far: compare two readings to tell if some code ran out
+    size_t tp_out_of_memory_count(void);
+#ifdef TP_NO_HEAP
+#define TP_GREW(p) ((p) != NULL || (tp_out_of_memory_note(), 0))
+#else
+#define TP_GREW(p) (TP_ASSERT((p) != NULL && "Buy more RAM lol"), 1)
+#endif
+
 // =====================================================
 // 🧩 Dynamic Array Macros (inspired by Nob)
 // =====================================================
-#define tp_da_free(da) TP_FREE((da).items)
+// Borrowed arrays: an array whose 'items' is set while its 'capacity' is 0 doesn't own its items
+// (they live in a tp_arena, or in an inline buffer next to the array) and whoever set them keeps
+// them alive. tp_da_free() leaves such items alone, and the first growth copies them into memory
+// the array owns without freeing them. An array that owns its items always has a capacity.
+#define tp_da_free(da) ((da).capacity ? tp_free((da).items) : (void)0)
 #define tp_da_len(da) ((da).count)
 #define tp_da_capacity(da) ((da).capacity)
 
+// A failed growth (see TP_GREW) leaves the array untouched: writers check tp_da_has_room() after it
 #define tp_da_reserve(da, expected_capacity)                                                                            \
     do                                                                                                                  \
     {                                                                                                                   \
         if ((expected_capacity) > (da)->capacity)                                                                       \
         {                                                                                                               \
-            if ((da)->capacity == 0)                                                                                    \
+            const void *tp_borrowed_ = ((da)->capacity == 0) ? (const void *)(da)->items : NULL;                        \
+            size_t tp_capacity_ = (da)->capacity ? (da)->capacity : TP_DA_INIT_CAP;                                     \
+            while ((expected_capacity) > tp_capacity_)                                                                  \
             {                                                                                                           \
-                (da)->capacity = TP_DA_INIT_CAP;                                                                        \
+                tp_capacity_ *= 2;                                                                                      \
             }                                                                                                           \
-            while ((expected_capacity) > (da)->capacity)                                                                \
+            void *tp_grown_ = tp_realloc(tp_borrowed_ ? NULL : (da)->items, tp_capacity_ * sizeof(*(da)->items));      \
+            if (TP_GREW(tp_grown_))                                                                                     \
             {                                                                                                           \
-                (da)->capacity *= 2;                                                                                    \
+                (da)->items = TP_DECLTYPE_CAST((da)->items) tp_grown_;                                                  \
+                (da)->capacity = tp_capacity_;                                                                          \
+                if (tp_borrowed_ != NULL && (da)->count > 0)                                                            \
+                {                                                                                                       \
+                    memcpy((da)->items, tp_borrowed_, (da)->count * sizeof(*(da)->items));                              \
+                }                                                                                                       \
             }                                                                                                           \
-            (da)->items = TP_DECLTYPE_CAST((da)->items) TP_REALLOC((da)->items, (da)->capacity * sizeof(*(da)->items)); \
-            TP_ASSERT((da)->items != NULL && "Buy more RAM lol");                                                       \
         }                                                                                                               \
     } while (0)
+#define tp_da_has_room(da, n) ((n) <= (da)->capacity)
 
 // Append an item to a dynamic array
-#define tp_da_append(da, item)                \
-    do                                        \
-    {                                         \
-        tp_da_reserve((da), (da)->count + 1); \
-        (da)->items[(da)->count++] = (item);  \
+#define tp_da_append(da, item)                              \
+    do                                                      \
+    {                                                       \
+        tp_da_reserve((da), (da)->count + 1);               \
+        if (tp_da_has_room((da), (da)->count + 1))          \
+        {                                                   \
+            (da)->items[(da)->count++] = (item);            \
+        }                                                   \
     } while (0)
 
 // Append several items to a dynamic array
-#define tp_da_append_many(da, new_items, new_items_count)                                         \
-    do                                                                                            \
-    {                                                                                             \
-        tp_da_reserve((da), (da)->count + (new_items_count));                                     \
-        memcpy((da)->items + (da)->count, (new_items), (new_items_count) * sizeof(*(da)->items)); \
-        (da)->count += (new_items_count);                                                         \
+#define tp_da_append_many(da, new_items, new_items_count)                                             \
+    do                                                                                                \
+    {                                                                                                 \
+        tp_da_reserve((da), (da)->count + (new_items_count));                                         \
+        if (tp_da_has_room((da), (da)->count + (new_items_count)))                                    \
+        {                                                                                             \
+            memcpy((da)->items + (da)->count, (new_items), (new_items_count) * sizeof(*(da)->items)); \
+            (da)->count += (new_items_count);                                                         \
+        }                                                                                             \
     } while (0)
 
-#define tp_da_resize(da, new_size)     \
-    do                                 \
-    {                                  \
-        tp_da_reserve((da), new_size); \
-        (da)->count = (new_size);      \
+#define tp_da_resize(da, new_size)                 \
+    do                                             \
+    {                                              \
+        tp_da_reserve((da), new_size);             \
+        if (tp_da_has_room((da), (new_size)))      \
+        {                                          \
+            (da)->count = (new_size);              \
+        }                                          \
     } while (0)
 
 #define tp_da_last(da) (da)->items[(TP_ASSERT((da)->count > 0), (da)->count - 1)]
@@ -152,13 +264,123 @@ int socket_ok(stb_teapot_socket_t s);
         size_t capacity;
     } tp_string_array;
 
+    // A non-owning view into a string. Not NULL-terminated.
+    typedef struct
+    {
+        const char *items;
+        size_t count;
+    } tp_str_view;
+
+    // Splits a buffer on any of the bytes in a delimiter set, skipping empty tokens like strtok(),
+    // but yields views into the buffer: nothing is written, nothing is allocated and all the state
+    // lives in the iterator, so any number of threads can split at once. A single delimiter byte
+    // is searched with memchr().
+    //
+    //     tp_splitter it;
+    //     tp_str_view token;
+    //     tp_splitter_init(&it, value, value_len, ", ");
+    //     while (tp_splitter_next(&it, &token)) { ... }
+    typedef struct
+    {
+        const char *cur;
+        const char *end;
+        char single; // the delimiter when there is only one
+        int is_single;
+        uint8_t set[32]; // bitmap of the delimiter bytes otherwise
+    } tp_splitter;
+
+    void tp_splitter_init(tp_splitter *it, const char *src, size_t src_len, const char *delims);
+    // Next non-empty token. Returns 0 once the buffer is exhausted.
+    int tp_splitter_next(tp_splitter *it, tp_str_view *token);
+
+    // Copy every token of 'src' into 'sa' (which must be freed with tp_sa_free)
+    void tp_chop_by_delim_into_array(tp_string_array *sa, const char *src, size_t src_len, const char *delim);
+
+    // =====================================================
+    // 🧱 Arena Allocator
+    // =====================================================
+    // Bump allocator for memory that lives as long as a request. Nothing is freed one by one:
+    // tp_arena_reset() drops everything at once but keeps the first block, so a connection
+    // serving many requests allocates it once.
+#ifndef TP_ARENA_BLOCK_SIZE
+#define TP_ARENA_BLOCK_SIZE (16 * 1024)
+#endif
+
+    typedef struct tp_arena_block
+    {
+        struct tp_arena_block *next;
+        size_t size; // usable bytes after the (aligned) block header
+        size_t used;
+    } tp_arena_block;
+
+    typedef struct
+    {
+        tp_arena_block *first;
+        tp_arena_block *current;
+    } tp_arena;
+
+    // 16-byte aligned, uninitialized memory. Never returns NULL, but under TP_NO_HEAP once the region is exhausted.
+    void *tp_arena_alloc(tp_arena *arena, size_t size);
+    // NUL-terminated copy of 'len' bytes of 's' (NULL as above)
+    char *tp_arena_strndup(tp_arena *arena, const char *s, size_t len);
+    // Forget every allocation. Overflow blocks are released, the first block is kept.
+    void tp_arena_reset(tp_arena *arena);
+    void tp_arena_free(tp_arena *arena);
+
+    // =====================================================
+    // 📦 I/O Buffer Pool
+    // =====================================================
+    // Receive buffers in 4K, 16K and 64K size classes, recycled through per-thread free lists.
+    // A connection borrows one only while it has input to read, so idle keep-alive connections
+    // hold no buffer at all.
+#ifndef TP_IO_BUFFER_CACHE
+#ifdef TP_NO_HEAP
+#define TP_IO_BUFFER_CACHE 0 // buffers go straight back to the region they came from
+#else
+#define TP_IO_BUFFER_CACHE 16 // free buffers kept per thread and size class
+#endif
+#endif
+
+    enum
+    {
+        TP_IO_BUFFER_4K,
+        TP_IO_BUFFER_16K,
+        TP_IO_BUFFER_64K,
+        TP_IO_BUFFER_CLASS_COUNT
+    };
+
+    typedef struct tp_io_buffer
+    {
+        struct tp_io_buffer *next; // free list link
+        char *data;
+        size_t capacity; // one byte more is allocated, so data can always be NUL-terminated
+        size_t len;      // bytes received and not consumed yet
+        int size_class;
+    } tp_io_buffer;
+
+    // Smallest buffer holding 'min_capacity' bytes, or NULL if that is more than the largest class
+    // (or, under TP_NO_HEAP, if the region is exhausted)
+    tp_io_buffer *tp_io_buffer_acquire(size_t min_capacity);
+    // Move the content of 'buf' to a buffer of the next class. Returns NULL (and keeps 'buf') at the top.
+    tp_io_buffer *tp_io_buffer_grow(tp_io_buffer *buf);
+    void tp_io_buffer_release(tp_io_buffer *buf);
+    // Free the calling thread's cached buffers, e.g. before a worker thread exits
+    void tp_io_buffer_pool_trim(void);
+
 #define tp_sa_append_str(sa, str, str_len)                                \
     do                                                                    \
     {                                                                     \
-        char *s = TP_DECLTYPE_CAST(char *) TP_REALLOC(NULL, str_len + 1); \
-        memcpy(s, str, str_len);                                          \
-        s[str_len] = '\0';                                                \
-        tp_da_append(sa, s);                                              \
+        tp_da_reserve((sa), (sa)->count + 1);                             \
+        if (tp_da_has_room((sa), (sa)->count + 1))                        \
+        {                                                                 \
+            char *s = (char *)tp_realloc(NULL, (str_len) + 1);            \
+            if (TP_GREW(s))                                               \
+            {                                                             \
+                memcpy(s, str, str_len);                                  \
+                s[str_len] = '\0';                                        \
+                (sa)->items[(sa)->count++] = s;                           \
+            }                                                             \
+        }                                                                 \
     } while (0)
 
 #define tp_sa_free(sa)                          \
@@ -166,9 +388,9 @@ int socket_ok(stb_teapot_socket_t s);
     {                                           \
         for (size_t i = 0; i < (sa).count; i++) \
         {                                       \
-            TP_FREE((sa).items[i]);             \
+            tp_free((sa).items[i]);             \
         }                                       \
-        TP_FREE((sa).items);                    \
+        tp_free((sa).items);                    \
     } while (0)
 
 // Append a sized buffer to a string builder
@@ -187,10 +409,21 @@ int socket_ok(stb_teapot_socket_t s);
 // use it a NULL-terminated C string
 #define tp_sb_append_null(sb) tp_da_append_many(sb, "", 1)
 
+    // Formats straight into the builder's spare capacity; vsnprintf only runs a second time
+    // when the output does not fit.
     int tp_sb_appendf(tp_string_builder *sb, const char *fmt, ...);
 
+    // Integer formatting without printf. tp_format_u64() writes the decimal digits of 'value'
+    // to 'dst' (at least TP_U64_DIGITS_MAX bytes, not NULL-terminated) and returns their count.
+#define TP_U64_DIGITS_MAX 20
+    size_t tp_format_u64(char *dst, uint64_t value);
+    void tp_sb_append_u64(tp_string_builder *sb, uint64_t value);
+    void tp_sb_append_i64(tp_string_builder *sb, int64_t value);
+    // Lowercase, no "0x" prefix, no leading zeros (as used by chunk sizes)
+    void tp_sb_append_hex(tp_string_builder *sb, uint64_t value);
+
 // Free the memory allocated by a string builder
-#define tp_sb_free(sb) TP_FREE((sb).items)
+#define tp_sb_free(sb) tp_da_free(sb)
 
     // =====================================================
     // 🌐 HTTP Core Types
@@ -199,20 +432,86 @@ int socket_ok(stb_teapot_socket_t s);
     {
         TEAPOT_GET,
         TEAPOT_POST,
+        TEAPOT_PUT,
+        TEAPOT_DELETE,
+        TEAPOT_PATCH,
+        TEAPOT_HEAD,
+        TEAPOT_OPTIONS,
         TEAPOT_UNKNOWN
     } teapot_method;
 
+// Bit of a method in a method bitmap
+#define TEAPOT_METHOD_BIT(m) (1u << (unsigned)(m))
+
+    // Most header names and values fit inline: parsing them allocates nothing. A short one lives
+    // in the line itself, its builder pointing there with capacity 0, so the tp_da_*/tp_sb_*
+    // macros see a borrowed array: freeing is a no-op and growing copies it out. A struct copy
+    // borrows the original's storage; moving lines in memory needs tp_header_line_rebase().
+#ifndef TP_HEADER_INLINE
+#define TP_HEADER_INLINE 32
+#endif
+
     typedef struct
     {
         tp_string_builder name;
         tp_string_builder value;
+        char inline_name[TP_HEADER_INLINE];
+        char inline_value[TP_HEADER_INLINE];
     } tp_header_line;
 
+    // Headers the server itself looks at get a slot filled while parsing, so reading them
+    // doesn't scan every header line
+    typedef enum
+    {
+        TP_HEADER_HOST,
+        TP_HEADER_CONNECTION,
+        TP_HEADER_CONTENT_TYPE,
+        TP_HEADER_CONTENT_LENGTH,
+        TP_HEADER_KNOWN_COUNT
+    } tp_known_header;
+
+    // Compact, read-only form of a header section: every name and value in one byte blob, indexed
+    // by a packed table of 16-byte entries (four per cache line). A lookup compares hashes down the
+    // table and touches the blob only on a hash hit. The table and the blob share one allocation.
+    typedef struct
+    {
+        uint32_t name_off;  // into tp_header_block::data, NUL-terminated
+        uint32_t value_off; // into tp_header_block::data, NUL-terminated
+        uint16_t name_len;
+        uint16_t value_len;
+        uint32_t hash; // case-insensitive hash of the name
+    } tp_header_entry;
+
+    typedef struct
+    {
+        tp_header_entry *entries; // start of the allocation, the blob follows the entries
+        char *data;
+        size_t count;
+        uint32_t known[TP_HEADER_KNOWN_COUNT]; // index + 1 of the first entry with that name, 0 if absent
+        int owned;                             // allocated with tp_realloc() rather than from an arena
+    } tp_header_block;
+
+    // Parse "Name: value" lines into 'block', from 'arena' if given. Invalid lines are skipped, as
+    // in tp_extract_header_keyval(). Returns the number of headers.
+    size_t tp_header_block_parse(tp_header_block *block, tp_arena *arena, const char *raw_header, size_t header_size);
+    void tp_header_block_free(tp_header_block *block);
+
+    tp_str_view tp_header_block_name(const tp_header_block *block, size_t index);
+    tp_str_view tp_header_block_value(const tp_header_block *block, size_t index);
+    // Value of the first header called 'name' (case-insensitive). items is NULL if absent.
+    tp_str_view tp_header_block_get(const tp_header_block *block, const char *name);
+    tp_str_view tp_header_block_known(const tp_header_block *block, tp_known_header id);
+
+    // A parsed request fills 'block' and 'items' is a view of it, one line per entry borrowing
+    // its strings: lookups go through the block. Headers parsed by tp_extract_header_keyval()
+    // have no block and are looked up line by line.
     typedef struct
     {
         tp_header_line *items;
         size_t count;
         size_t capacity;
+        uint32_t known[TP_HEADER_KNOWN_COUNT]; // index + 1 of the first line with that name, 0 if absent
+        tp_header_block block;
     } tp_headers;
 
     typedef enum
@@ -222,6 +521,18 @@ int socket_ok(stb_teapot_socket_t s);
         TP_HEADER_MATCH = 2
     } tp_header_result;
 
+    // Maximum number of ":param" / "*" captures in a single route
+#ifndef TP_MAX_ROUTE_PARAMS
+#define TP_MAX_ROUTE_PARAMS 8
+#endif
+
+    // A captured route parameter. Both views point into the route pattern and the request path.
+    typedef struct
+    {
+        tp_str_view name;
+        tp_str_view value;
+    } tp_route_param;
+
     typedef struct
     {
         teapot_method method;
@@ -229,21 +540,60 @@ int socket_ok(stb_teapot_socket_t s);
         tp_string_builder body;
         tp_headers headers;
         size_t body_length;
+        tp_route_param params[TP_MAX_ROUTE_PARAMS];
+        size_t param_count;
+        int keep_alive; // the client wants the connection kept open after this request
+        tp_arena *arena; // backs path, body and headers; reset once the response is sent. May be NULL
     } teapot_request;
 
     typedef struct
     {
         int status;
-        // TODO add headers
+        tp_string_builder headers; // extra "Name: value\r\n" lines, sent after the default headers
         tp_string_builder body;
     } teapot_response;
 
+    // Response buffers owned by a connection. While a connection is being served,
+    // teapot_response_init() hands its (empty, but already grown) buffers to the new response and
+    // the connection takes them back once the response is sent, so keep-alive requests don't
+    // start again from capacity 0. Buffers grown past TP_RESPONSE_BUFFER_HIGH_WATER are shrunk
+    // back to TP_RESPONSE_BUFFER_SHRINK_TO when they come back.
+#ifndef TP_RESPONSE_BUFFER_HIGH_WATER
+#define TP_RESPONSE_BUFFER_HIGH_WATER (64 * 1024)
+#endif
+#ifndef TP_RESPONSE_BUFFER_SHRINK_TO
+#define TP_RESPONSE_BUFFER_SHRINK_TO (4 * 1024)
+#endif
+
+    typedef struct
+    {
+        tp_string_builder headers;
+        tp_string_builder body;
+    } tp_response_buffers;
+
+    // Move the calling thread's current connection buffers (if any) into 'res'
+    void tp_response_buffers_take(teapot_response *res);
+    // Give the buffers of a sent response back to 'buffers' (or free them if it is already full)
+    void tp_response_buffers_recycle(tp_response_buffers *buffers, teapot_response *res);
+    void tp_response_buffers_free(tp_response_buffers *buffers);
+
     inline void teapot_response_init(teapot_response *res, int status)
     {
         res->status = status;
-        res->body.items = NULL;
-        res->body.count = 0;
-        res->body.capacity = 0;
+        tp_response_buffers_take(res);
+    }
+
+    inline void teapot_response_add_header(teapot_response *res, const char *name, const char *value)
+    {
+        if (res == NULL || name == NULL || value == NULL)
+        {
+            return;
+        }
+
+        tp_sb_append_cstr(&res->headers, name);
+        tp_sb_append_buf(&res->headers, ": ", 2);
+        tp_sb_append_cstr(&res->headers, value);
+        tp_sb_append_buf(&res->headers, "\r\n", 2);
     }
 
     inline void teapot_response_write(teapot_response *res, const void *data, size_t len)
@@ -258,6 +608,10 @@ int socket_ok(stb_teapot_socket_t s);
 
     inline void teapot_response_free(teapot_response *res)
     {
+        tp_sb_free(res->headers);
+        res->headers.items = NULL;
+        res->headers.count = 0;
+        res->headers.capacity = 0;
         tp_sb_free(res->body);
         res->body.items = NULL;
         res->body.count = 0;
@@ -273,15 +627,23 @@ int socket_ok(stb_teapot_socket_t s);
             tp_sb_free(h->items[i].name);
             tp_sb_free(h->items[i].value);
         }
-        TP_FREE(h->items);
+        if (h->capacity != 0)
+        {
+            tp_free(h->items);
+        }
         h->items = NULL;
         h->count = 0;
         h->capacity = 0;
+        memset(h->known, 0, sizeof(h->known));
+        tp_header_block_free(&h->block);
     }
 
     /* Find a header value (case-insensitive). Returns pointer to the value string-builder, or NULL if not found */
     const tp_string_builder *tp_headers_get(const tp_headers *h, const char *name);
 
+    /* Value of a known header from its slot, or NULL if the request didn't send it */
+    const tp_string_builder *tp_headers_known(const tp_headers *h, tp_known_header id);
+
     /* Return 1 if header 'name' exists and its value equals 'expected_value', otherwise 0 */
     int tp_headers_match(const tp_headers *h, const char *name, const char *expected_value);
 
@@ -300,13 +662,421 @@ int socket_ok(stb_teapot_socket_t s);
         teapot_handler handler;
     } teapot_route;
 
+    // Node of the compressed radix tree used by the router. Nodes refer to each other by index
+    // into the router's node array and their labels point into the route path strings, so the
+    // route array must outlive the router.
+    typedef struct
+    {
+        tp_str_view label; // static text for static nodes, parameter name for ':param' and '*' nodes
+        uint32_t first_child;
+        uint32_t next_sibling;
+        uint32_t param_child;
+        uint32_t catchall_child;
+        uint8_t kind;
+        const struct teapot_router *mount; // sub-router owning everything below this prefix, or NULL
+        uint32_t methods;      // TEAPOT_METHOD_BIT() of every method with a handler on this path
+        uint32_t allow_offset; // precomputed "Allow: ...\r\n" line in teapot_router::allow_lines
+        uint32_t allow_len;
+        teapot_handler handlers[TEAPOT_UNKNOWN];
+    } tp_router_node;
+
+    typedef struct
+    {
+        tp_router_node *items;
+        size_t count;
+        size_t capacity;
+    } tp_router_nodes;
+
+    typedef struct
+    {
+        uint32_t *items;
+        size_t count;
+        size_t capacity;
+    } tp_router_u32s;
+
+    // Combined DFA of every pattern route of a router. Bytes are mapped to equivalence classes
+    // first, so each state only needs one transition per class.
+    typedef struct
+    {
+        uint8_t byte_class[256];
+        uint32_t class_count;
+        tp_router_u32s next;   // next.items[state * class_count + class], TP_ROUTER_NIL once dead
+        tp_router_u32s accept; // per state: accepting node in teapot_router::nodes, or TP_ROUTER_NIL
+    } tp_router_dfa;
+
+    // Route lookup index built once from a teapot_route array.
+    //
+    // Route paths support:
+    //   - static segments:          "/users/new"
+    //   - named parameters:         "/users/:id/posts/:post"   (matches one non-empty segment)
+    //   - a trailing catch-all:     "/static/*" or "/static/*file" (matches the rest of the path)
+    // Static segments win over parameters, which win over catch-alls. Lookups cost O(path length).
+    //
+    // Routes are grouped per path node with a bitmap of their methods, so a lookup is one path
+    // match plus one bit test. A path that exists for other methods yields 405 with a prebuilt
+    // Allow header, and OPTIONS is answered automatically unless a route handles it.
+    //
+    // Sub-routers built on their own can be mounted at a static prefix with teapot_router_mount().
+    // The prefix is matched once, then the rest of the path is looked up in the sub-router's index.
+    //
+    // Paths starting with '~' are patterns, e.g. "~/v[0-9]+/items/*.json":
+    //   - '?' any byte but '/', '*' any run of bytes but '/', '**' any run of bytes
+    //   - '[a-z_]' a byte set, '[^/.]' or '[!/.]' its complement (never '/')
+    //   - '+' repeats the previous byte or set, '\\' escapes the next byte
+    // All patterns are compiled into one DFA at build time and only tried when the radix tree
+    // has no route for the method, so they cost one pass over the path and capture nothing.
+    // Among patterns, the first matching route wins.
+    typedef struct teapot_router
+    {
+        tp_router_nodes nodes;
+        tp_string_builder allow_lines; // Allow header lines shared by nodes with the same method set
+        tp_router_dfa patterns;
+    } teapot_router;
+
+    // A sub-router mounted at 'prefix' (e.g. "/api/v1") of a server's router
+    typedef struct
+    {
+        const char *prefix;
+        const teapot_router *router;
+    } teapot_mount;
+
+    // Result of a route lookup
+    typedef struct
+    {
+        teapot_handler handler; // NULL if no route matches (method, path)
+        uint32_t allowed;       // methods bitmap of the matched path, 0 if no route has this path
+        tp_str_view allow;      // "Allow: ...\r\n" line for the matched path (OPTIONS included)
+    } teapot_route_match;
+
+    // Entry of a route table generated at build time by nob.c (see generate_route_table()).
+    typedef struct
+    {
+        teapot_method method;
+        const char *path;
+        size_t path_len;
+        teapot_handler handler;
+    } teapot_static_route;
+
+    // Minimal perfect hash over (method, path) for a fixed set of static routes.
+    // Bucket b = tp_route_hash(0, ...) % count; displacements[b] < 0 encodes the slot directly
+    // as -(slot + 1), otherwise the slot is tp_route_hash(displacements[b], ...) % count.
+    typedef struct
+    {
+        const int32_t *displacements;
+        const teapot_static_route *entries;
+        size_t count;
+    } teapot_static_routes;
+
+    // Route table of one virtual host, selected by the request's Host header.
+    // 'host' is an exact name ("api.example.com"), a wildcard for every subdomain of a name
+    // ("*.example.com", the longest matching suffix wins) or "*" for the default host.
+    typedef struct
+    {
+        const char *host;
+        const teapot_route *routes;
+        size_t route_count;
+        teapot_router router; // built from 'routes' by teapot_server_build()
+    } teapot_vhost;
+
+    typedef struct
+    {
+        uint32_t hash;
+        uint32_t vhost; // index in teapot_server::vhosts, TP_ROUTER_NIL for a free slot
+    } tp_vhost_slot;
+
+    // Open-addressing hash index over normalized host names
+    typedef struct
+    {
+        tp_vhost_slot *slots;
+        size_t mask;               // slot count - 1, slot count is a power of two
+        uint32_t default_vhost;    // index of the "*" host, or TP_ROUTER_NIL
+    } tp_vhost_index;
+
+    // Rewrite or redirect rule, applied before routing.
+    //   from:   exact path ("/old") or prefix ending in '*' ("/legacy/*" matches "/legacy/" and below)
+    //   to:     new path, or for redirects the Location (may be absolute). A trailing '*' appends
+    //           what the '*' of 'from' matched. The query string is always kept.
+    //   status: 0 rewrites the request path in place, 301/302/307/308 answers with a redirect
+    // An exact rule beats a prefix rule, a longer prefix beats a shorter one, otherwise the first
+    // rule wins. Rules are applied once, the rewritten path is not matched again.
+    typedef struct
+    {
+        const char *from;
+        const char *to;
+        int status;
+    } teapot_rewrite_rule;
+
+    typedef struct
+    {
+        int status;
+        uint32_t to_offset;  // in teapot_rewriter::text: "Location: <to>" for redirects, "<to>" otherwise
+        uint32_t to_len;
+        uint8_t append_rest; // 'to' ended in '*'
+    } tp_rewrite_entry;
+
+    typedef struct
+    {
+        tp_rewrite_entry *items;
+        size_t count;
+        size_t capacity;
+    } tp_rewrite_entries;
+
+    // Rule set compiled into a radix trie over the static part of every 'from': matching walks
+    // the path once, whatever the number of rules.
+    typedef struct
+    {
+        teapot_router trie;
+        tp_router_u32s exact;  // per trie node: entry matching the node's path exactly, or TP_ROUTER_NIL
+        tp_router_u32s prefix; // per trie node: entry matching the node's path and below, or TP_ROUTER_NIL
+        tp_rewrite_entries entries;
+        tp_string_builder text; // prebuilt targets and Location header lines
+    } teapot_rewriter;
+
+    // Memory charged to connections: receive buffers plus everything allocated while serving a
+    // request (parsed request, handler allocations, response). A budget may be shared by several
+    // servers. When it runs out, connections stop reading (backpressure) and, if it doesn't come
+    // back within TP_BUDGET_WAIT_MS, get a 503. A request that can't fit in the per-connection
+    // limit gets a 413 before its body is read.
+    // What a handler allocates is charged, and holds the other connections back, but its
+    // allocations don't fail: a response whose request took the connection past a limit is
+    // replaced with a 503 after the handler returns.
+    typedef struct
+    {
+        size_t global_limit;     // bytes across every connection, 0 for no limit
+        size_t connection_limit; // bytes per connection, 0 for no limit
+        size_t used;             // bytes charged right now, read it with teapot_memory_used()
+        size_t peak;
+        size_t rejected;         // requests refused with 503 or 413
+    } teapot_memory_budget;
+
+    size_t teapot_memory_used(const teapot_memory_budget *budget);
+
+    // Optional hook tried before any route table. Returns non-zero if it filled 'out', which it
+    // gets without buffers: it may build into it or assign it a handler's response.
+    // The C++ compile-time router (teapot::router<...>::dispatch) plugs in here.
+    typedef int (*teapot_dispatch_fn)(const teapot_request *req, teapot_response *out);
+
     typedef struct
     {
         int port;
         const teapot_route *routes;
         size_t route_count;
+        teapot_router router;                       // built from 'routes' and 'mounts' by teapot_server_build()
+        const teapot_mount *mounts;                 // optional sub-routers, see teapot_router_mount()
+        size_t mount_count;
+        const teapot_static_routes *static_routes; // optional, checked before 'router' unless a named vhost matches
+        teapot_dispatch_fn dispatch;               // optional, tried before everything else
+        teapot_vhost *vhosts;                      // optional, requests for other hosts use 'router'
+        size_t vhost_count;
+        tp_vhost_index vhost_index;                // built by teapot_server_build()
+        const teapot_rewrite_rule *rewrites;       // optional, applied before everything else
+        size_t rewrite_count;
+        teapot_rewriter rewriter;                  // built from 'rewrites' by teapot_server_build()
+        int keep_alive;                            // serve several requests per connection (HTTP/1.1 persistent connections)
+        const tp_allocator *allocator;             // optional, current while the server builds, frees and serves
+        teapot_memory_budget *budget;              // optional, charged by every connection of the server
+        struct teapot_region *region;              // optional (required under TP_NO_HEAP), see teapot_region
+        size_t stop;                               // set by teapot_server_stop(), read atomically
     } teapot_server;
 
+    // =====================================================
+    // 🔗 Connection Table
+    // =====================================================
+    // Connection structs preallocated in cache-line-aligned slabs and recycled LIFO, so accepting
+    // and closing a connection never calls the allocator and a reused slot is likely still in
+    // cache. Slots are named by handles that carry a generation: once a slot is released, the
+    // handles to it stop resolving, so timers and async completions can hold them safely.
+#ifndef TP_CONN_SLAB_SIZE
+#define TP_CONN_SLAB_SIZE 64 // connections per slab
+#endif
+
+#define TP_CACHE_LINE 64
+
+#ifdef _WIN32
+    typedef SRWLOCK tp_mutex;
+#else
+    typedef pthread_mutex_t tp_mutex;
+#endif
+
+    void tp_mutex_init(tp_mutex *m);
+    void tp_mutex_lock(tp_mutex *m);
+    void tp_mutex_unlock(tp_mutex *m);
+    void tp_mutex_destroy(tp_mutex *m);
+
+    // (generation << 32) | (slot index + 1). Zero is never a valid handle.
+    typedef uint64_t teapot_conn_handle;
+
+    typedef struct teapot_conn
+    {
+        stb_teapot_socket_t socket;
+        teapot_server *server;
+        struct teapot_conn *next; // free for the owner while the slot is in use, e.g. as a queue link
+        void *user;
+        teapot_conn_handle handle; // generation is odd while the slot is in use
+        uint32_t next_free;        // free list link: slot index + 1, 0 ends the list
+    } teapot_conn;
+
+    // One slot per cache line (or more): connections served by different threads never share one
+    typedef union
+    {
+        teapot_conn conn;
+        char pad[(sizeof(teapot_conn) + TP_CACHE_LINE - 1) / TP_CACHE_LINE * TP_CACHE_LINE];
+    } tp_conn_slot;
+
+    typedef struct
+    {
+        void *memory;       // as allocated
+        tp_conn_slot *slots; // TP_CACHE_LINE aligned, TP_CONN_SLAB_SIZE entries
+    } tp_conn_slab;
+
+    typedef struct
+    {
+        tp_conn_slab *slabs;
+        size_t slab_count;
+        size_t capacity;    // slots in all slabs
+        size_t live;        // slots in use
+        uint32_t free_head; // slot index + 1 of the most recently released slot, 0 if full
+        tp_mutex lock;
+    } teapot_conn_table;
+
+    // Preallocate room for 'max_conns' connections. Returns 0 on success, -1 if max_conns is 0
+    // or too large. Under TP_NO_HEAP, call it with a region's allocator current.
+    int teapot_conn_table_init(teapot_conn_table *table, size_t max_conns);
+    void teapot_conn_table_free(teapot_conn_table *table);
+
+    // Take a slot for 'socket'. Returns NULL when the table is full.
+    teapot_conn *teapot_conn_acquire(teapot_conn_table *table, teapot_server *server, stb_teapot_socket_t socket);
+    // Slot named by 'handle', or NULL if it has been released since.
+    teapot_conn *teapot_conn_get(teapot_conn_table *table, teapot_conn_handle handle);
+    // Give the slot back. The socket is not closed. Returns -1 if the handle is stale.
+    int teapot_conn_release(teapot_conn_table *table, teapot_conn_handle handle);
+
+    // =====================================================
+    // 🧱 Fixed Memory Region
+    // =====================================================
+    // Serves every allocation from one caller-provided block of memory: blocks are carved from it
+    // in power-of-two size classes (TP_REGION_MIN bytes and up) and recycled through per-class
+    // free lists, so the footprint is exactly the block handed in and nothing ever calls
+    // TP_REALLOC. When no block fits, the allocation fails instead of growing.
+    //
+    // A server with a region (teapot_server::region) allocates from it and answers 503, without
+    // allocating, to any request arriving while less than TP_REGION_REQUEST_RESERVE bytes are
+    // available. Compile with TP_NO_HEAP to make it the only memory the library touches; a
+    // request the region still runs out on is then answered with 503 as well.
+    //
+    //     static unsigned char memory[4 << 20];
+    //     teapot_region region;
+    //     teapot_region_init(&region, memory, sizeof(memory));
+    //     server.region = &region;
+#define TP_REGION_MIN 32
+#ifndef TP_REGION_CLASSES
+#define TP_REGION_CLASSES 20 // 32 bytes .. 16M
+#endif
+#ifndef TP_REGION_REQUEST_RESERVE
+#define TP_REGION_REQUEST_RESERVE (128 * 1024) // free bytes a request needs to be admitted
+#endif
+
+    typedef struct teapot_region
+    {
+        tp_allocator allocator; // the allocator to install, its ctx points back here
+        char *base;             // start of the memory, 16-byte aligned
+        size_t size;            // usable bytes from 'base'
+        size_t carved;          // bytes handed to size classes so far, never given back
+        void *free_lists[TP_REGION_CLASSES];
+        size_t free_counts[TP_REGION_CLASSES]; // blocks on each free list
+        size_t used; // bytes in live blocks (rounded up to their class)
+        size_t peak;
+        size_t failures; // allocations refused
+        tp_mutex lock;
+    } teapot_region;
+
+    // Returns 0 on success, -1 if 'size' can't hold a single block
+    int teapot_region_init(teapot_region *region, void *memory, size_t size);
+    void teapot_region_destroy(teapot_region *region);
+    // Bytes a request can count on: the memory not carved into blocks yet, plus the free blocks
+    // big enough for a receive buffer. Smaller free blocks still serve small allocations, but a
+    // region full of them can't take a request, so they are left out.
+    size_t teapot_region_available(teapot_region *region);
+
+    // =====================================================
+    // 🧵 Worker Pool
+    // =====================================================
+    // teapot_serve_pooled() runs a server on a pool of worker threads until teapot_server_stop(),
+    // then lets the workers finish the requests they are serving and joins them. Connections
+    // waiting for a request are dropped within TP_POOL_POLL_MS, so silent clients can't hold the
+    // shutdown up.
+    //
+    // With TEAPOT_ACCEPT_DISPATCHER the calling thread accepts and hands each connection to a
+    // worker through a bounded lock-free ring: nothing is allocated or locked per connection, and
+    // only workers that stayed idle for a while park and need a wake-up (an eventfd on Linux, a
+    // semaphore elsewhere). Connections beyond 'max_connections' get a 503. With
+    // TEAPOT_ACCEPT_WORKERS every worker accepts on the listener itself and serves what it
+    // accepted, so there is no hand-off at all, but a slow connection holds up its worker's
+    // accepts.
+    //
+    // TEAPOT_ACCEPT_WORK_STEALING gives every worker a deque of its own. Idle workers take turns
+    // waiting on the listener and accept a burst into their deque, then serve it newest first
+    // while idle workers steal the oldest connections from random victims. Connections stay with
+    // the worker that accepted them unless another one would otherwise sit idle, so a few slow
+    // connections don't leave the other cores waiting.
+    //
+    // TEAPOT_ACCEPT_SHARDED gives every worker a listener of its own on the same port
+    // (SO_REUSEPORT, Linux only; elsewhere it behaves as TEAPOT_ACCEPT_WORKERS) and the kernel
+    // spreads the connections over them. With 'pin_workers' as well, each listener asks for the
+    // connections whose packets its worker's CPU processed (SO_INCOMING_CPU), so the packets, the
+    // socket and the thread share a core. A busy worker's share of the connections waits for it.
+    //
+    // 'pin_workers' binds worker i to the i-th CPU the process may run on, before it allocates
+    // anything: its thread-local buffer pools and the connections it serves are then first
+    // touched, and so placed by the OS, on that CPU's NUMA node. The pool doesn't use a
+    // teapot_conn_table, so there are no per-worker connection slabs to place. A worker that can't be pinned
+    // (no affinity API, see teapot_pin_current_thread(), or a CPU taken away meanwhile) runs unpinned and its shard takes any
+    // connection; teapot_serve_pooled_ex() then returns 1 instead of 0 once stopped.
+#ifndef TP_POOL_MAX_CONNECTIONS
+#define TP_POOL_MAX_CONNECTIONS 1024 // default teapot_pool_options::max_connections
+#endif
+#ifndef TP_POOL_POLL_MS
+#define TP_POOL_POLL_MS 250 // how often accepting threads and waiting connections check for teapot_server_stop()
+#endif
+#ifndef TP_POOL_SPIN
+#define TP_POOL_SPIN 32 // empty polls (each yielding the CPU) before an idle worker parks
+#endif
+#ifndef TP_POOL_DEQUE_SIZE
+#define TP_POOL_DEQUE_SIZE 64 // connections a work-stealing worker holds, a power of two
+#endif
+#ifndef TP_POOL_ACCEPT_BATCH
+#define TP_POOL_ACCEPT_BATCH 16 // connections accepted in one go by a work-stealing worker
+#endif
+
+    typedef enum
+    {
+        TEAPOT_ACCEPT_DISPATCHER,
+        TEAPOT_ACCEPT_WORKERS,
+        TEAPOT_ACCEPT_WORK_STEALING,
+        TEAPOT_ACCEPT_SHARDED,
+    } teapot_accept_strategy;
+
+    typedef struct
+    {
+        int workers;                   // 0 for one per online CPU
+        teapot_accept_strategy accept;
+        size_t max_connections;        // accepted and not done yet (dispatcher), 0 for TP_POOL_MAX_CONNECTIONS
+        int stop_on_signals;           // SIGINT/SIGTERM (console Ctrl+C on Windows) stop the server
+        int pin_workers;               // one CPU per worker, see above
+    } teapot_pool_options;
+
+    // Dispatcher, stopped by SIGINT/SIGTERM. 'n_workers' 0 for one per online CPU.
+    // Returns 0 once stopped (1 if 'pin_workers' failed for some worker), -1 if the listener or
+    // the workers could not be started.
+    int teapot_serve_pooled(teapot_server *server, int n_workers);
+    int teapot_serve_pooled_ex(teapot_server *server, const teapot_pool_options *options);
+    // Ask a running teapot_serve_pooled() to return. Safe from a signal handler or any thread.
+    void teapot_server_stop(teapot_server *server);
+    int teapot_cpu_count(void);
+    // Keep the calling thread on 'cpu'. Returns -1 where the platform can't, and on Linux unless
+    // _GNU_SOURCE or _DEFAULT_SOURCE is in effect (a strict -std=c17 build defines neither).
+    int teapot_pin_current_thread(int cpu);
+
     // =====================================================
     // 🧠 API
     // =====================================================
@@ -317,11 +1087,71 @@ int socket_ok(stb_teapot_socket_t s);
     int teapot_send_response(stb_teapot_socket_t client, const teapot_response *resp);
     int teapot_handle_client_connection(teapot_server *server, stb_teapot_socket_t client);
 
+    // Build the route index of the server and of its virtual hosts. Called by teapot_listener_open()
+    // if not done already. Returns 0 on success, -1 if a route path or host name is invalid.
+    int teapot_server_build(teapot_server *server);
+    void teapot_server_free(teapot_server *server);
+
+    int teapot_router_build(teapot_router *router, const teapot_route *routes, size_t route_count);
+    void teapot_router_free(teapot_router *router);
+
+    // Delegate every path below the static 'prefix' to 'child'. Both 'prefix' and 'child' must
+    // outlive 'parent'; 'child' may be rebuilt in place. Paths the child doesn't know fall back to
+    // the parent's own routes. Returns 0 on success, -1 on an invalid prefix or if already mounted.
+    int teapot_router_mount(teapot_router *parent, const char *prefix, const teapot_router *child);
+
+    // Find the handler for 'method' and 'path' (path_len bytes, no query string). Captured
+    // parameters are written to 'params' (TP_MAX_ROUTE_PARAMS entries) as views into 'path'.
+    teapot_handler teapot_router_match(const teapot_router *router, teapot_method method,
+                                       const char *path, size_t path_len,
+                                       tp_route_param *params, size_t *param_count);
+
+    // Same as teapot_router_match(), but also reports the methods allowed on a matching path.
+    teapot_route_match teapot_router_resolve(const teapot_router *router, teapot_method method,
+                                             const char *path, size_t path_len,
+                                             tp_route_param *params, size_t *param_count);
+
+    // Compile 'rules' (which must outlive 'rw'). Returns 0 on success, -1 if a rule is invalid.
+    int teapot_rewriter_build(teapot_rewriter *rw, const teapot_rewrite_rule *rules, size_t rule_count);
+    void teapot_rewriter_free(teapot_rewriter *rw);
+
+    // Apply the matching rule to 'req'. Path rewrites happen in place in req->path. Returns 1 if
+    // the rule is a redirect and 'resp' (initialized by the caller) holds it, 0 otherwise.
+    int teapot_rewrite(const teapot_rewriter *rw, teapot_request *req, teapot_response *resp);
+
+    // Memory for a handler that lives until the response has been sent, from the request's arena.
+    // Returns NULL if the request has no arena.
+    void *teapot_request_alloc(const teapot_request *req, size_t size);
+
+    // Value of the route parameter 'name' captured for this request. Empty view if not captured.
+    tp_str_view teapot_request_param(const teapot_request *req, const char *name);
+
+    // "GET", "POST", ... or NULL for TEAPOT_UNKNOWN
+    const char *teapot_method_str(teapot_method method);
+
+    // Reason phrase of an HTTP status code ("OK", "Not Found", ...)
+    const char *teapot_status_str(int status);
+
+    // Hash of "<METHOD> <path>" used by generated static route tables. nob.c carries a copy
+    // of this function; both must stay in sync.
+    uint32_t tp_route_hash(uint32_t seed, teapot_method method, const char *path, size_t path_len);
+
+    // Look up a handler in a generated route table. Returns NULL if (method, path) is not in the table.
+    teapot_handler teapot_static_routes_find(const teapot_static_routes *table, teapot_method method,
+                                             const char *path, size_t path_len);
+
 #ifdef STB_TEAPOT_IMPLEMENTATION
 
 #include <stdarg.h>
-/* portable case-insensitive compare helper */
-#include <ctype.h>
+
+#ifndef __cplusplus
+    /* C99 inline functions need one external definition for calls the compiler doesn't inline */
+    extern inline void teapot_response_init(teapot_response *res, int status);
+    extern inline void teapot_response_add_header(teapot_response *res, const char *name, const char *value);
+    extern inline void teapot_response_write(teapot_response *res, const void *data, size_t len);
+    extern inline void teapot_response_free(teapot_response *res);
+    extern inline void tp_headers_free(tp_headers *h);
+#endif
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -333,12 +1163,92 @@ int socket_ok(stb_teapot_socket_t s);
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#if (defined(_GNU_SOURCE) || defined(_DEFAULT_SOURCE)) && defined(SYS_sched_setaffinity)
+#define TP_HAS_AFFINITY // syscall() is only declared with these feature-test macros
+#endif
+#ifdef SO_REUSEPORT
+#define TP_HAS_REUSEPORT // the kernel balances connections over listeners sharing a port
+#endif
+#endif
     int socket_ok(stb_teapot_socket_t s)
     {
         return s >= 0;
     }
 #endif
 
+    // -----------------------------------------------------
+    // 🔤 Character Classification (locale independent)
+    // -----------------------------------------------------
+    // Byte classes used by the parser instead of <ctype.h>, so that parsing does not
+    // depend on the current C locale. Classes follow RFC 9110 section 5.
+#define TP_CHAR_TOKEN 0x01       /* tchar: allowed in header names and methods */
+#define TP_CHAR_OWS 0x02         /* optional whitespace: SP / HTAB */
+#define TP_CHAR_FIELD_VALUE 0x04 /* allowed in header values: VCHAR / obs-text / SP / HTAB */
+#define TP_CHAR_DIGIT 0x08       /* 0-9 */
+
+#define TP_CHAR_IS(c, cls) ((tp_char_class_table[(unsigned char)(c)] & (cls)) != 0)
+#define TP_TOLOWER(c) (tp_lower_table[(unsigned char)(c)])
+
+    static const unsigned char tp_char_class_table[256] = {
+        /* 0x00 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        /* 0x10 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        /* 0x20 */ 0x06, 0x05, 0x04, 0x05, 0x05, 0x05, 0x05, 0x05, 0x04, 0x04, 0x05, 0x05, 0x04, 0x05, 0x05, 0x04,
+        /* 0x30 */ 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0x40 */ 0x04, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+        /* 0x50 */ 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x04, 0x04, 0x04, 0x05, 0x05,
+        /* 0x60 */ 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+        /* 0x70 */ 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x04, 0x05, 0x04, 0x05, 0x00,
+        /* 0x80 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0x90 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0xA0 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0xB0 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0xC0 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0xD0 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0xE0 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+        /* 0xF0 */ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+    };
+
+    static const unsigned char tp_lower_table[256] = {
+        /* 0x00 */ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+        /* 0x10 */ 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+        /* 0x20 */ 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+        /* 0x30 */ 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+        /* 0x40 */ 0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F,
+        /* 0x50 */ 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x5B, 0x5C, 0x5D, 0x5E, 0x5F,
+        /* 0x60 */ 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F,
+        /* 0x70 */ 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7C, 0x7D, 0x7E, 0x7F,
+        /* 0x80 */ 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F,
+        /* 0x90 */ 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9F,
+        /* 0xA0 */ 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF,
+        /* 0xB0 */ 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF,
+        /* 0xC0 */ 0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF,
+        /* 0xD0 */ 0xD0, 0xD1, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF,
+        /* 0xE0 */ 0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xEB, 0xEC, 0xED, 0xEE, 0xEF,
+        /* 0xF0 */ 0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF,
+    };
+
+    /* case-insensitive comparison of exactly 'len' bytes */
+    static int tp_strnicmp(const char *a, const char *b, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            int d = TP_TOLOWER(a[i]) - TP_TOLOWER(b[i]);
+            if (d != 0)
+            {
+                return d;
+            }
+        }
+        return 0;
+    }
+
     static int tp_stricmp(const char *a, const char *b)
     {
         if (a == b)
@@ -358,8 +1268,8 @@ int socket_ok(stb_teapot_socket_t s);
 
         while (*a && *b)
         {
-            int ca = tolower((unsigned char)*a);
-            int cb = tolower((unsigned char)*b);
+            int ca = TP_TOLOWER(*a);
+            int cb = TP_TOLOWER(*b);
 
             if (ca != cb)
             {
@@ -369,628 +1279,5349 @@ int socket_ok(stb_teapot_socket_t s);
             ++a;
             ++b;
         }
-        return tolower((unsigned char)*a) - tolower((unsigned char)*b);
-    }
-
-    /* helper: find header line by name (returns NULL if not found) */
-    static const tp_header_line *tp_headers_find(const tp_headers *h, const char *name)
-    {
-        if (h == NULL || name == NULL)
-            return NULL;
-        for (size_t i = 0; i < h->count; ++i)
-        {
-            const char *hn = h->items[i].name.items ? h->items[i].name.items : "";
-            if (tp_stricmp(hn, name) == 0)
-                return &h->items[i];
-        }
-        return NULL;
-    }
-
-    /* Return 1 if header 'name' exists and its value equals 'expected_value', otherwise 0 */
-    int tp_headers_match(const tp_headers *h, const char *name, const char *expected_value)
-    {
-        if (h == NULL || name == NULL || expected_value == NULL)
-            return 0;
-        const tp_string_builder *val = tp_headers_get(h, name);
-        if (val == NULL || val->items == NULL)
-            return 0;
-        return strcmp(val->items, expected_value) == 0 ? 1 : 0;
+        return TP_TOLOWER(*a) - TP_TOLOWER(*b);
     }
 
-#if 0
-    static const char *teapot_status_to_str(int status)
+    const char *teapot_status_str(int status)
     {
         switch (status)
         {
         case 200:
             return "OK";
+        case 201:
+            return "Created";
+        case 204:
+            return "No Content";
+        case 301:
+            return "Moved Permanently";
+        case 302:
+            return "Found";
+        case 304:
+            return "Not Modified";
+        case 307:
+            return "Temporary Redirect";
+        case 308:
+            return "Permanent Redirect";
         case 400:
             return "Bad Request";
         case 404:
             return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 413:
+            return "Content Too Large";
         case 415:
             return "Unsupported Media Type";
+        case 500:
+            return "Internal Server Error";
+        case 501:
+            return "Not Implemented";
+        case 503:
+            return "Service Unavailable";
         default:
             return "Unknown";
         }
     }
-#endif
 
-    int tp_sb_appendf(tp_string_builder *sb, const char *fmt, ...)
-    {
-        va_list args;
+    // -----------------------------------------------------
+    // 🧮 Allocators
+    // -----------------------------------------------------
+    static TP_THREAD_LOCAL const tp_allocator *tp_current_allocator;
 
-        va_start(args, fmt);
-        int n = vsnprintf(NULL, 0, fmt, args);
-        va_end(args);
+    void *tp_realloc(void *ptr, size_t size)
+    {
+        const tp_allocator *allocator = tp_current_allocator;
+        if (allocator == NULL)
+        {
+            return TP_REALLOC(ptr, size);
+        }
+        return allocator->realloc_fn(allocator->ctx, ptr, size);
+    }
 
-        // NOTE: the new_capacity needs to be +1 because of the null terminator.
-        // However, further below we increase sb->count by n, not n + 1.
-        // This is because we don't want the sb to include the null terminator. The user can always sb_append_null() if they want it
-        tp_da_reserve(sb, sb->count + (size_t)(n + 1));
-        char *dest = sb->items + sb->count;
-        va_start(args, fmt);
-        vsnprintf(dest, (size_t)(n + 1), fmt, args);
-        va_end(args);
+    void tp_free(void *ptr)
+    {
+        const tp_allocator *allocator = tp_current_allocator;
+        if (allocator == NULL)
+        {
+            TP_FREE(ptr);
+            return;
+        }
+        allocator->free_fn(allocator->ctx, ptr);
+    }
 
-        sb->count += (size_t)n;
+    const tp_allocator *tp_allocator_use(const tp_allocator *allocator)
+    {
+        const tp_allocator *previous = tp_current_allocator;
+        tp_current_allocator = allocator;
+        return previous;
+    }
 
-        return n;
+    static TP_THREAD_LOCAL size_t tp_out_of_memory;
+
+    void tp_out_of_memory_note(void)
+    {
+        ++tp_out_of_memory;
     }
 
-    // TODO: See if we can do without this function entirely
-    void tp_chop_by_delim_into_array(tp_string_array *sa, char *src, size_t src_len, const char *delim)
+    size_t tp_out_of_memory_count(void)
     {
-        if (!sa || !src || !delim)
-        {
-            return;
-        }
+        return tp_out_of_memory;
+    }
 
-        tp_string_builder sb = {0};
-        tp_sb_append_buf(&sb, src, src_len);
+    static void *tp_default_realloc(void *ctx, void *ptr, size_t size)
+    {
+        (void)ctx;
+        return TP_REALLOC(ptr, size);
+    }
 
-        *sa = (tp_string_array){0};
+    static void tp_default_free(void *ctx, void *ptr)
+    {
+        (void)ctx;
+        TP_FREE(ptr);
+    }
 
-        char *token = strtok(sb.items, delim);
-        if (token)
-        {
-            do
-            {
-                tp_sa_append_str(sa, token, strlen(token));
-            } while ((token = strtok(NULL, delim)));
-        }
+    const tp_allocator tp_default_allocator = {NULL, tp_default_realloc, tp_default_free};
 
-        tp_sb_free(sb);
+    /* Relaxed atomic counters shared between threads */
+    static size_t tp_atomic_add(size_t *p, size_t v)
+    {
+#if defined(_MSC_VER) && defined(_WIN64)
+        return (size_t)InterlockedExchangeAdd64((volatile LONG64 *)p, (LONG64)v) + v;
+#elif defined(_MSC_VER)
+        return (size_t)InterlockedExchangeAdd((volatile LONG *)p, (LONG)v) + v;
+#else
+        return __atomic_add_fetch(p, v, __ATOMIC_RELAXED);
+#endif
     }
 
-#if 0
-    /* helpers for header parsing (static, internal) */
-    static size_t tp_trim_trailing_ws(const char *s, size_t len)
+    static size_t tp_atomic_sub(size_t *p, size_t v)
     {
-        // trim trailing whitespace
-        while (len > 0 && isspace((unsigned char)s[len - 1]))
+        return tp_atomic_add(p, (size_t)0 - v);
+    }
+
+    static size_t tp_atomic_load(const size_t *p)
+    {
+#if defined(_MSC_VER)
+        return *(const volatile size_t *)p;
+#else
+        return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+    }
+
+    /* Ordered variants for lock-free hand-offs (Interlocked* are full barriers already) */
+    static size_t tp_atomic_load_acquire(const size_t *p)
+    {
+#if defined(_MSC_VER)
+        size_t v = *(const volatile size_t *)p;
+        _ReadWriteBarrier();
+        return v;
+#else
+        return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    static void tp_atomic_store_release(size_t *p, size_t v)
+    {
+#if defined(_MSC_VER)
+        _ReadWriteBarrier();
+        *(volatile size_t *)p = v;
+#else
+        __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+    }
+
+    /* A full barrier, like Interlocked*. On failure '*expected' is updated to the current value */
+    static int tp_atomic_cas(size_t *p, size_t *expected, size_t desired)
+    {
+#if defined(_MSC_VER) && defined(_WIN64)
+        size_t seen = (size_t)InterlockedCompareExchange64((volatile LONG64 *)p, (LONG64)desired, (LONG64)*expected);
+#elif defined(_MSC_VER)
+        size_t seen = (size_t)InterlockedCompareExchange((volatile LONG *)p, (LONG)desired, (LONG)*expected);
+#else
+        size_t seen = *expected;
+        if (__atomic_compare_exchange_n(p, &seen, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
         {
-            --len;
+            return 1;
         }
-        return len;
+#endif
+        int swapped = seen == *expected;
+        *expected = seen;
+        return swapped;
     }
 
+    static void tp_atomic_fence(void)
+    {
+#if defined(_MSC_VER)
+        MemoryBarrier();
+#else
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
 #endif
+    }
 
-    static size_t tp_trim_leading_ws(const char *s, size_t len)
+    /* Blocks from the custom allocators carry a header in front of the user's memory */
+#define TP_ALLOC_HEADER 16
+
+    typedef union
     {
-        size_t start = 0;
-        while (start < len && isspace((unsigned char)s[start]))
+        struct
         {
-            ++start;
+            size_t size;     // requested size
+            uint32_t klass;  // size class, TP_THREAD_CACHE_CLASSES for large blocks
+        } info;
+        void *next;          // free list link while cached
+        char pad[TP_ALLOC_HEADER];
+    } tp_alloc_header;
+
+#define TP_THREAD_CACHE_MIN 32
+#define TP_THREAD_CACHE_CLASSES 12 // 32 bytes .. 64K
+
+    typedef struct
+    {
+        void *head; // tp_alloc_header of the most recently freed block
+        size_t count;
+    } tp_thread_cache_list;
+
+    static TP_THREAD_LOCAL tp_thread_cache_list tp_thread_cache_lists[TP_THREAD_CACHE_CLASSES];
+
+    static uint32_t tp_thread_cache_class(size_t size)
+    {
+        uint32_t klass = 0;
+        size_t class_size = TP_THREAD_CACHE_MIN;
+        while (class_size < size && klass < TP_THREAD_CACHE_CLASSES)
+        {
+            class_size *= 2;
+            ++klass;
         }
-        return start;
+        return klass;
     }
 
-    static size_t tp_trim_ws(const char *s, size_t len)
+    static void tp_thread_cache_put(tp_alloc_header *header)
     {
-        size_t start = tp_trim_leading_ws(s, len);
-        size_t end = len;
-        while (end > start && isspace((unsigned char)s[end - 1]))
+        if (header->info.klass >= TP_THREAD_CACHE_CLASSES ||
+            tp_thread_cache_lists[header->info.klass].count >= TP_THREAD_CACHE_DEPTH)
         {
-            --end;
+            TP_FREE(header);
+            return;
         }
-        return end - start;
+        tp_thread_cache_list *list = &tp_thread_cache_lists[header->info.klass];
+        header->next = list->head;
+        list->head = header;
+        ++list->count;
     }
 
-    // TODO: handle folded headers (lines starting with SP/HT are continuations of previous header)
-    // TODO: handle multiple headers with same name (append to existing value with comma separation)
-    // TODO: handle invalid headers gracefully
-    // TODO: handle overly long headers gracefully
-    // TODO: handle invalid characters gracefully
-    // TODO: handle non-ASCII characters gracefully
-    // TODO: handle different line endings (\r\n, \n, \r) gracefully
-    // TODO: handle empty header names gracefully
-    // TODO: handle empty header values gracefully
-    // TODO: handle headers with no value (e.g., "X-Flag:") gracefully
-    static int tp_parse_and_append_header_line(tp_headers *headers_parsed, const char *line, size_t linelen)
-    {
-        if (!headers_parsed || !line || linelen == 0)
+    static void *tp_thread_cache_realloc(void *ctx, void *ptr, size_t size)
+    {
+        (void)ctx;
+        tp_alloc_header *old = ptr ? (tp_alloc_header *)((char *)ptr - TP_ALLOC_HEADER) : NULL;
+        if (size == 0)
         {
-            return 0;
+            if (old != NULL)
+            {
+                tp_thread_cache_put(old);
+            }
+            return NULL;
         }
 
-        const char *colon = (const char *)memchr(line, ':', linelen);
-        if (!colon)
+        uint32_t klass = tp_thread_cache_class(size);
+        if (old != NULL && old->info.klass == klass && klass < TP_THREAD_CACHE_CLASSES)
         {
-            return 0;
+            old->info.size = size;
+            return ptr;
         }
 
-        const char *name_start = line;
-        size_t name_len = (size_t)(colon - name_start);
-        name_len = tp_trim_ws(name_start, name_len);
-
-        /* value: skip ':' and leading whitespace, then trim trailing whitespace */
-        const char *vstart = colon + 1;
-        const char *line_end = line + linelen;
-        while (vstart < line_end && isspace((unsigned char)*vstart))
+        tp_alloc_header *header = NULL;
+        if (klass < TP_THREAD_CACHE_CLASSES && tp_thread_cache_lists[klass].head != NULL)
         {
-            ++vstart;
+            tp_thread_cache_list *list = &tp_thread_cache_lists[klass];
+            header = (tp_alloc_header *)list->head;
+            list->head = header->next;
+            --list->count;
         }
-        size_t vlen = (vstart < line_end) ? (size_t)(line_end - vstart) : 0;
-        vlen = tp_trim_ws(vstart, vlen);
-
-        /* clamp to configured maxima */
-#ifndef TP_MAX_HEADER_NAME_LEN
-#define TP_MAX_HEADER_NAME_LEN 256
-#endif
-#ifndef TP_MAX_HEADER_VALUE_LEN
-#define TP_MAX_HEADER_VALUE_LEN 4096
-#endif
-        if (name_len > (size_t)TP_MAX_HEADER_NAME_LEN)
+        else if (klass < TP_THREAD_CACHE_CLASSES)
         {
-            name_len = (size_t)TP_MAX_HEADER_NAME_LEN;
+            header = (tp_alloc_header *)TP_REALLOC(NULL, TP_ALLOC_HEADER + ((size_t)TP_THREAD_CACHE_MIN << klass));
         }
-
-        if (vlen > (size_t)TP_MAX_HEADER_VALUE_LEN)
+        else if (old != NULL && old->info.klass == klass)
         {
-            vlen = (size_t)TP_MAX_HEADER_VALUE_LEN;
+            /* large to large: let the system allocator move it */
+            header = (tp_alloc_header *)TP_REALLOC(old, TP_ALLOC_HEADER + size);
+            if (header != NULL)
+            {
+                header->info.size = size;
+                return (char *)header + TP_ALLOC_HEADER;
+            }
+            return NULL;
         }
-
-        tp_header_line header_line = {0};
-        if (name_len)
+        else
         {
-            tp_sb_append_buf(&header_line.name, name_start, name_len);
-            tp_sb_append_null(&header_line.name);
+            header = (tp_alloc_header *)TP_REALLOC(NULL, TP_ALLOC_HEADER + size);
         }
-        if (vlen)
+        if (header == NULL)
         {
-            tp_sb_append_buf(&header_line.value, vstart, vlen);
-            tp_sb_append_null(&header_line.value);
+            return NULL;
         }
-        tp_da_append(headers_parsed, header_line);
-        return 1;
+
+        header->info.size = size;
+        header->info.klass = klass;
+        char *data = (char *)header + TP_ALLOC_HEADER;
+        if (old != NULL)
+        {
+            memcpy(data, ptr, old->info.size < size ? old->info.size : size);
+            tp_thread_cache_put(old);
+        }
+        return data;
     }
 
-    void tp_extract_header_keyval(tp_headers *headers_parsed, char *raw_header, size_t header_size)
+    static void tp_thread_cache_free(void *ctx, void *ptr)
     {
-        if (headers_parsed == NULL || raw_header == NULL || header_size == 0)
+        (void)ctx;
+        if (ptr != NULL)
         {
-            return;
+            tp_thread_cache_put((tp_alloc_header *)((char *)ptr - TP_ALLOC_HEADER));
         }
+    }
 
-        /* optional global clamp if defined */
-#ifdef TP_MAX_HEADER_TOTAL
-        if (header_size > (size_t)TP_MAX_HEADER_TOTAL)
-            header_size = (size_t)TP_MAX_HEADER_TOTAL;
-#endif
+    const tp_allocator tp_thread_cache_allocator = {NULL, tp_thread_cache_realloc, tp_thread_cache_free};
 
-        /* scan line by line and use helper to parse each non-empty line */
-        size_t i = 0;
-        while (i < header_size)
+    void tp_thread_cache_trim(void)
+    {
+        for (int c = 0; c < TP_THREAD_CACHE_CLASSES; ++c)
         {
-            size_t line_start = i;
-            size_t line_end = line_start;
-
-            // find end of line
-            while ((line_end < header_size) && (raw_header[line_end] != '\r') && (raw_header[line_end] != '\n'))
-            {
-                ++line_end;
-            }
-
-            // extract line
-            size_t linelen = (line_end > line_start) ? (size_t)(line_end - line_start) : 0;
-            if (linelen > 0)
-            {
-                tp_parse_and_append_header_line(headers_parsed, raw_header + line_start, linelen);
-            }
-
-            /* advance past CR/LF */
-            i = line_end;
-            if (i < header_size && raw_header[i] == '\r')
-            {
-                ++i;
-            }
-
-            if (i < header_size && raw_header[i] == '\n')
+            tp_thread_cache_list *list = &tp_thread_cache_lists[c];
+            while (list->head != NULL)
             {
-                ++i;
+                tp_alloc_header *header = (tp_alloc_header *)list->head;
+                list->head = header->next;
+                TP_FREE(header);
             }
+            list->count = 0;
         }
     }
 
-    const tp_string_builder *tp_headers_get(const tp_headers *h, const char *name)
+    static void *tp_counting_realloc(void *ctx, void *ptr, size_t size)
     {
-        const tp_header_line *hl = tp_headers_find(h, name);
-        return hl ? &hl->value : NULL;
-    }
+        tp_counting_allocator *counter = (tp_counting_allocator *)ctx;
+        const tp_allocator *parent = counter->parent;
+        tp_alloc_header *old = ptr ? (tp_alloc_header *)((char *)ptr - TP_ALLOC_HEADER) : NULL;
+        size_t old_size = old ? old->info.size : 0;
 
-    tp_header_result tp_headers_check(const tp_headers *h, const char *name, const char *expected_value, tp_header_line *o_header_line)
-    {
-        if (expected_value == NULL)
+        if (size == 0)
         {
-            const tp_header_line *hl = tp_headers_find(h, name);
-            if (!hl)
+            if (old != NULL)
             {
-                return TP_HEADER_NOT_FOUND;
-            }
-
-            if (o_header_line)
-            {
-                *o_header_line = *hl;
+                ++counter->frees;
+                counter->bytes_live -= old_size;
+                parent->free_fn(parent->ctx, old);
             }
-
-            return TP_HEADER_FOUND;
+            return NULL;
         }
 
-        const tp_header_line *hl = tp_headers_find(h, name);
-        if (!hl)
+        tp_alloc_header *header = (tp_alloc_header *)parent->realloc_fn(parent->ctx, old, TP_ALLOC_HEADER + size);
+        if (header == NULL)
         {
-            return TP_HEADER_NOT_FOUND;
+            return NULL;
+        }
+        if (old == NULL)
+        {
+            ++counter->allocs;
+        }
+        else
+        {
+            ++counter->reallocs;
+        }
+        header->info.size = size;
+        counter->bytes_live = counter->bytes_live - old_size + size;
+        counter->bytes_total += size;
+        if (counter->bytes_live > counter->bytes_peak)
+        {
+            counter->bytes_peak = counter->bytes_live;
         }
+        return (char *)header + TP_ALLOC_HEADER;
+    }
 
-        if (o_header_line)
+    static void tp_counting_free(void *ctx, void *ptr)
+    {
+        if (ptr == NULL)
         {
-            *o_header_line = *hl;
+            return;
         }
+        tp_counting_allocator *counter = (tp_counting_allocator *)ctx;
+        tp_alloc_header *header = (tp_alloc_header *)((char *)ptr - TP_ALLOC_HEADER);
+        ++counter->frees;
+        counter->bytes_live -= header->info.size;
+        counter->parent->free_fn(counter->parent->ctx, header);
+    }
 
-        const char *val = hl->value.items ? hl->value.items : "";
-        return (strcmp(val, expected_value) == 0) ? TP_HEADER_MATCH : TP_HEADER_FOUND;
+    void tp_counting_allocator_init(tp_counting_allocator *counter, const tp_allocator *parent)
+    {
+        memset(counter, 0, sizeof(*counter));
+        counter->parent = parent ? parent : &tp_default_allocator;
+        counter->allocator.ctx = counter;
+        counter->allocator.realloc_fn = tp_counting_realloc;
+        counter->allocator.free_fn = tp_counting_free;
     }
 
-// =====================================================
-// 🛠 Implementation
-// =====================================================
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <stdarg.h>
+    // -----------------------------------------------------
+    // 🧱 Arena Allocator
+    // -----------------------------------------------------
+#define TP_ARENA_ALIGN 16
+#define TP_ARENA_HEADER ((sizeof(tp_arena_block) + TP_ARENA_ALIGN - 1) & ~(size_t)(TP_ARENA_ALIGN - 1))
 
-    static void teapot_init(void)
+    static tp_arena_block *tp_arena_new_block(size_t size)
     {
-#ifdef _WIN32
-        WSADATA wsa;
-        WSAStartup(MAKEWORD(2, 2), &wsa);
-#endif
+        tp_arena_block *block = (tp_arena_block *)tp_realloc(NULL, TP_ARENA_HEADER + size);
+        if (!TP_GREW(block))
+        {
+            return NULL;
+        }
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+        return block;
     }
 
-    static void teapot_close(stb_teapot_socket_t s)
+    void *tp_arena_alloc(tp_arena *arena, size_t size)
     {
-#ifdef _WIN32
-        closesocket(s);
-#else
-        close(s);
-#endif
+        size = (size + TP_ARENA_ALIGN - 1) & ~(size_t)(TP_ARENA_ALIGN - 1);
+
+        tp_arena_block *block = arena->current;
+        if (block == NULL || block->size - block->used < size)
+        {
+            tp_arena_block *fresh = tp_arena_new_block(size > TP_ARENA_BLOCK_SIZE ? size : TP_ARENA_BLOCK_SIZE);
+            if (fresh == NULL)
+            {
+                return NULL;
+            }
+            if (block == NULL)
+            {
+                arena->first = fresh;
+            }
+            else
+            {
+                block->next = fresh;
+            }
+            arena->current = block = fresh;
+        }
+
+        void *p = (char *)block + TP_ARENA_HEADER + block->used;
+        block->used += size;
+        return p;
     }
 
-    static int teapot_read(stb_teapot_socket_t s, char *buf, int len)
+    char *tp_arena_strndup(tp_arena *arena, const char *s, size_t len)
     {
-        if (len <= 0)
+        char *copy = (char *)tp_arena_alloc(arena, len + 1);
+        if (copy == NULL)
         {
-            return 0;
+            return NULL;
         }
-
-#ifdef _WIN32
-        return recv(s, buf, len, 0);
-#else
-        return (int)read(s, buf, (size_t)len);
-#endif
+        if (len > 0)
+        {
+            memcpy(copy, s, len);
+        }
+        copy[len] = '\0';
+        return copy;
     }
 
-    static int teapot_write(stb_teapot_socket_t s, const char *buf, int len)
+    void tp_arena_reset(tp_arena *arena)
     {
-        if (len <= 0)
+        tp_arena_block *first = arena->first;
+        if (first == NULL)
         {
-            return 0;
+            return;
         }
 
-#ifdef _WIN32
-        return send(s, buf, len, 0);
-#else
-        return (int)write(s, buf, (size_t)len);
-#endif
+        /* overflow blocks only exist after an unusually large request */
+        for (tp_arena_block *block = first->next; block != NULL;)
+        {
+            tp_arena_block *next = block->next;
+            tp_free(block);
+            block = next;
+        }
+        first->next = NULL;
+        first->used = 0;
+        arena->current = first;
     }
 
-    // -----------------------------------------------------
-    // 🧩 Request Parsing (minimal, single-line HTTP/1.0)
-    // -----------------------------------------------------
-    static teapot_method parse_method(const char *s)
+    void tp_arena_free(tp_arena *arena)
     {
-        if (strncmp(s, "GET", 3) == 0)
-            return TEAPOT_GET;
-        if (strncmp(s, "POST", 4) == 0)
-            return TEAPOT_POST;
-        return TEAPOT_UNKNOWN;
+        tp_arena_reset(arena);
+        tp_free(arena->first);
+        arena->first = NULL;
+        arena->current = NULL;
     }
 
-    static void free_request(teapot_request *req)
+    // -----------------------------------------------------
+    // 📦 I/O Buffer Pool
+    // -----------------------------------------------------
+    static const size_t tp_io_buffer_sizes[TP_IO_BUFFER_CLASS_COUNT] = {4 * 1024, 16 * 1024, 64 * 1024};
+
+    typedef struct
     {
-        tp_sb_free(req->path);
-        tp_sb_free(req->body);
-        tp_headers_free(&req->headers);
-    }
+        tp_io_buffer *head;
+        size_t count;
+    } tp_io_buffer_list;
 
-    static int parse_request(char *buffer, size_t size, teapot_request *req)
+    static TP_THREAD_LOCAL tp_io_buffer_list tp_io_buffer_free_lists[TP_IO_BUFFER_CLASS_COUNT];
+
+    static tp_io_buffer *tp_io_buffer_of_class(int size_class)
     {
-        if (buffer == NULL || size == 0 || req == NULL)
+        tp_io_buffer_list *list = &tp_io_buffer_free_lists[size_class];
+        tp_io_buffer *buf = list->head;
+        if (buf != NULL)
         {
-            return -1;
+            list->head = buf->next;
+            --list->count;
         }
-
-        /* ensure headers/builders start empty */
-        req->path = (tp_string_builder){0};
-        req->body = (tp_string_builder){0};
-        req->headers = (tp_headers){0};
-
-        char method_buf[8] = {0};
-        char path_buf[512] = {0};
-
-        sscanf(buffer, "%7s %511s", method_buf, path_buf);
-        int method = parse_method(method_buf);
-        if (method == TEAPOT_UNKNOWN)
+        else
         {
-            return -1;
+            size_t size = tp_io_buffer_sizes[size_class];
+            buf = (tp_io_buffer *)TP_CACHE_REALLOC(NULL, sizeof(tp_io_buffer) + size + 1);
+#ifdef TP_NO_HEAP
+            if (buf == NULL)
+            {
+                return NULL;
+            }
+#endif
+            TP_ASSERT(buf != NULL && "Buy more RAM lol");
+            buf->data = (char *)(buf + 1);
+            buf->capacity = size;
+            buf->size_class = size_class;
         }
+        buf->next = NULL;
+        buf->len = 0;
+        return buf;
+    }
 
-        const char *ct = strstr(buffer, "Content-Type:");
-        const char *cl = strstr(buffer, "Content-Length:");
-        const char *body_start = strstr(buffer, "\r\n\r\n");
-
-        char content_type[128] = "";
-        size_t content_length = 0;
-        const char *body = "";
+    tp_io_buffer *tp_io_buffer_acquire(size_t min_capacity)
+    {
+        for (int c = 0; c < TP_IO_BUFFER_CLASS_COUNT; ++c)
+        {
+            if (min_capacity <= tp_io_buffer_sizes[c])
+            {
+                return tp_io_buffer_of_class(c);
+            }
+        }
+        return NULL;
+    }
 
-        if (ct)
+    tp_io_buffer *tp_io_buffer_grow(tp_io_buffer *buf)
+    {
+        if (buf->size_class + 1 >= TP_IO_BUFFER_CLASS_COUNT)
         {
-            sscanf(ct, "Content-Type: %127s", content_type);
+            return NULL;
+        }
+        tp_io_buffer *bigger = tp_io_buffer_of_class(buf->size_class + 1);
+        if (bigger == NULL)
+        {
+            return NULL;
         }
+        memcpy(bigger->data, buf->data, buf->len);
+        bigger->len = buf->len;
+        tp_io_buffer_release(buf);
+        return bigger;
+    }
 
-        if (cl)
+    void tp_io_buffer_release(tp_io_buffer *buf)
+    {
+        if (buf == NULL)
+        {
+            return;
+        }
+        tp_io_buffer_list *list = &tp_io_buffer_free_lists[buf->size_class];
+        if (list->count + 1 > TP_IO_BUFFER_CACHE)
         {
-            sscanf(cl, "Content-Length: " TP_SIZE_T_FMT "", &content_length);
+            TP_CACHE_FREE(buf);
+            return;
         }
+        buf->next = list->head;
+        list->head = buf;
+        ++list->count;
+    }
 
-        if (body_start)
+    void tp_io_buffer_pool_trim(void)
+    {
+        for (int c = 0; c < TP_IO_BUFFER_CLASS_COUNT; ++c)
         {
-            body_start += 4;
-            body = body_start;
+            tp_io_buffer_list *list = &tp_io_buffer_free_lists[c];
+            while (list->head != NULL)
+            {
+                tp_io_buffer *next = list->head->next;
+                TP_CACHE_FREE(list->head);
+                list->head = next;
+            }
+            list->count = 0;
         }
+    }
 
-        /* extract headers from start..(body_start) */
-        size_t header_size = size;
-        if (body_start)
-            header_size = (size_t)(body_start - buffer);
-        tp_extract_header_keyval(&req->headers, buffer, header_size);
+    int tp_sb_appendf(tp_string_builder *sb, const char *fmt, ...)
+    {
+        va_list args;
+        va_list retry;
 
-        req->method = method;
-        tp_sb_append_buf(&req->path, path_buf, strlen(path_buf));
-        tp_sb_append_null(&req->path);
+        // Borrowed builders (capacity 0) have no spare room we are allowed to write into
+        size_t spare = sb->capacity > sb->count ? sb->capacity - sb->count : 0;
+        char *dest = spare > 0 ? sb->items + sb->count : NULL;
 
-        tp_sb_append_buf(&req->body, body, content_length);
-        tp_sb_append_null(&req->body);
+        va_start(args, fmt);
+        va_copy(retry, args);
+        int n = vsnprintf(dest, spare, fmt, args);
+        va_end(args);
+        if (n < 0)
+        {
+            va_end(retry);
+            return n;
+        }
 
-        req->body_length = content_length;
+        // NOTE: the capacity needs room for the null terminator vsnprintf writes, but sb->count
+        // only grows by n: the sb doesn't include the terminator. The user can always
+        // sb_append_null() if they want it
+        if ((size_t)n >= spare)
+        {
+            tp_da_reserve(sb, sb->count + (size_t)n + 1);
+            if (!tp_da_has_room(sb, sb->count + (size_t)n + 1))
+            {
+                va_end(retry);
+                return -1;
+            }
+            vsnprintf(sb->items + sb->count, (size_t)n + 1, fmt, retry);
+        }
+        va_end(retry);
 
-        return 0;
+        sb->count += (size_t)n;
+
+        return n;
     }
 
-    // -----------------------------------------------------
-    // 🧭 Find Matching Route
-    // -----------------------------------------------------
-    static teapot_handler teapot_find_handler(teapot_server *server, teapot_request *req)
+    static const char tp_digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    static const char tp_hex_digits[] = "0123456789abcdef";
+
+    size_t tp_format_u64(char *dst, uint64_t value)
     {
-        for (size_t i = 0; i < server->route_count; i++)
+        // Two digits per division, written backwards into a scratch buffer
+        char tmp[TP_U64_DIGITS_MAX];
+        char *p = tmp + sizeof(tmp);
+        while (value >= 100)
         {
-            const teapot_route *r = &server->routes[i];
-            if (r->method == req->method && strcmp(r->path, req->path.items) == 0)
-            {
-                return r->handler;
-            }
+            size_t pair = (size_t)(value % 100) * 2;
+            value /= 100;
+            p -= 2;
+            p[0] = tp_digit_pairs[pair];
+            p[1] = tp_digit_pairs[pair + 1];
         }
-        return NULL;
+        if (value >= 10)
+        {
+            size_t pair = (size_t)value * 2;
+            p -= 2;
+            p[0] = tp_digit_pairs[pair];
+            p[1] = tp_digit_pairs[pair + 1];
+        }
+        else
+        {
+            *--p = (char)('0' + value);
+        }
+        size_t len = (size_t)(tmp + sizeof(tmp) - p);
+        memcpy(dst, p, len);
+        return len;
     }
 
-    // -----------------------------------------------------
-    // 🫖 Listen Loop
-    // -----------------------------------------------------
-
-    int teapot_listener_open(teapot_server *server, stb_teapot_socket_t *out_listen_sock)
+    void tp_sb_append_u64(tp_string_builder *sb, uint64_t value)
     {
-        if (!server || !out_listen_sock)
-            return -1;
-
-        teapot_init();
+        tp_da_reserve(sb, sb->count + TP_U64_DIGITS_MAX);
+        if (tp_da_has_room(sb, sb->count + TP_U64_DIGITS_MAX))
+        {
+            sb->count += tp_format_u64(sb->items + sb->count, value);
+        }
+    }
 
-        stb_teapot_socket_t s = socket(AF_INET, SOCK_STREAM, 0);
-        if (!socket_ok(s))
+    void tp_sb_append_i64(tp_string_builder *sb, int64_t value)
+    {
+        tp_da_reserve(sb, sb->count + TP_U64_DIGITS_MAX + 1);
+        if (!tp_da_has_room(sb, sb->count + TP_U64_DIGITS_MAX + 1))
         {
-            perror("socket");
-            return -1;
+            return;
+        }
+        // Negate in unsigned arithmetic so INT64_MIN does not overflow
+        uint64_t magnitude = (uint64_t)value;
+        if (value < 0)
+        {
+            sb->items[sb->count++] = '-';
+            magnitude = 0 - magnitude;
         }
+        sb->count += tp_format_u64(sb->items + sb->count, magnitude);
+    }
 
-        struct sockaddr_in addr = {0};
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons((uint16_t)server->port);
-        addr.sin_addr.s_addr = INADDR_ANY;
+    void tp_sb_append_hex(tp_string_builder *sb, uint64_t value)
+    {
+        char tmp[16];
+        char *p = tmp + sizeof(tmp);
+        do
+        {
+            *--p = tp_hex_digits[value & 0xf];
+            value >>= 4;
+        } while (value != 0);
+        size_t len = (size_t)(tmp + sizeof(tmp) - p);
+        tp_sb_append_buf(sb, p, len);
+    }
 
-        if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    void tp_splitter_init(tp_splitter *it, const char *src, size_t src_len, const char *delims)
+    {
+        memset(it, 0, sizeof(*it));
+        it->cur = src;
+        it->end = src ? src + src_len : src;
+        size_t delim_count = delims ? strlen(delims) : 0;
+        if (delim_count == 1)
         {
-            perror("bind");
-            teapot_close(s);
-            return -1;
+            it->single = delims[0];
+            it->is_single = 1;
+            return;
         }
-
-        if (listen(s, 8) < 0)
+        for (size_t i = 0; i < delim_count; ++i)
         {
-            perror("listen");
-            teapot_close(s);
-            return -1;
+            unsigned char c = (unsigned char)delims[i];
+            it->set[c >> 3] = (uint8_t)(it->set[c >> 3] | (1u << (c & 7)));
         }
+    }
 
-        *out_listen_sock = (stb_teapot_socket_t)s;
-        return 0;
+    static int tp_splitter_is_delim(const tp_splitter *it, char ch)
+    {
+        unsigned char c = (unsigned char)ch;
+        return (it->set[c >> 3] >> (c & 7)) & 1;
     }
 
-    stb_teapot_socket_t teapot_listener_accept(stb_teapot_socket_t listen_sock)
+    int tp_splitter_next(tp_splitter *it, tp_str_view *token)
     {
-        if (!socket_ok((stb_teapot_socket_t)listen_sock))
+        const char *p = it->cur;
+        const char *end = it->end;
+
+        if (it->is_single)
         {
-            return (stb_teapot_socket_t)-1;
+            while (p < end && *p == it->single)
+            {
+                ++p;
+            }
+            if (p == end)
+            {
+                it->cur = end;
+                return 0;
+            }
+            const char *stop = (const char *)memchr(p, it->single, (size_t)(end - p));
+            if (stop == NULL)
+            {
+                stop = end;
+            }
+            token->items = p;
+            token->count = (size_t)(stop - p);
+            it->cur = stop;
+            return 1;
         }
 
-        stb_teapot_socket_t client = accept((stb_teapot_socket_t)listen_sock, NULL, NULL);
-        if (!socket_ok(client))
+        while (p < end && tp_splitter_is_delim(it, *p))
         {
-            return (stb_teapot_socket_t)-1;
+            ++p;
         }
-
-        return (stb_teapot_socket_t)client;
+        if (p == end)
+        {
+            it->cur = end;
+            return 0;
+        }
+        const char *stop = p;
+        while (stop < end && !tp_splitter_is_delim(it, *stop))
+        {
+            ++stop;
+        }
+        token->items = p;
+        token->count = (size_t)(stop - p);
+        it->cur = stop;
+        return 1;
     }
 
-    int teapot_recv_request(stb_teapot_socket_t client, char *buffer, int bufsize, int *out_received)
+    void tp_chop_by_delim_into_array(tp_string_array *sa, const char *src, size_t src_len, const char *delim)
     {
-        if (!socket_ok((stb_teapot_socket_t)client) || !buffer || bufsize <= 0)
+        if (!sa || !src || !delim)
         {
-            return -1;
+            return;
         }
 
-        int received = teapot_read((stb_teapot_socket_t)client, buffer, bufsize - 1);
-        if (received <= 0)
+        sa->items = NULL;
+        sa->count = 0;
+        sa->capacity = 0;
+
+        tp_splitter it;
+        tp_str_view token;
+        tp_splitter_init(&it, src, src_len, delim);
+        while (tp_splitter_next(&it, &token))
         {
-            if (out_received)
-            {
-                *out_received = received;
-            }
-            return -1;
+            tp_sa_append_str(sa, token.items, token.count);
         }
+    }
 
-        buffer[received] = '\0';
-        if (out_received)
+#if 0
+    /* helpers for header parsing (static, internal) */
+    static size_t tp_trim_trailing_ws(const char *s, size_t len)
+    {
+        // trim trailing whitespace
+        while (len > 0 && TP_CHAR_IS(s[len - 1], TP_CHAR_OWS))
         {
-            *out_received = received;
+            --len;
         }
-        return 0;
+        return len;
     }
 
-    int teapot_send_response(stb_teapot_socket_t client, const teapot_response *resp)
+#endif
+
+    static size_t tp_trim_leading_ws(const char *s, size_t len)
     {
-        if (!socket_ok((stb_teapot_socket_t)client) || !resp)
-            return -1;
+        size_t start = 0;
+        while (start < len && TP_CHAR_IS(s[start], TP_CHAR_OWS))
+        {
+            ++start;
+        }
+        return start;
+    }
 
-        char header[256] = {0};
-        int header_len = snprintf(
-            header, sizeof(header),
-            "HTTP/1.1 %d OK\r\nContent-Type: text/plain\r\nContent-Length: " TP_SIZE_T_FMT "\r\n\r\n",
-            resp->status, tp_da_len(resp->body));
+    static size_t tp_trim_ws(const char *s, size_t len)
+    {
+        size_t start = tp_trim_leading_ws(s, len);
+        size_t end = len;
+        while (end > start && TP_CHAR_IS(s[end - 1], TP_CHAR_OWS))
+        {
+            --end;
+        }
+        return end - start;
+    }
 
-        if (teapot_write((stb_teapot_socket_t)client, header, header_len) < 0)
+    /* 1*DIGIT and nothing else into '*out'. -1 if empty, not a number or too large */
+    static int tp_parse_decimal(const char *s, size_t len, size_t *out)
+    {
+        if (len == 0)
         {
             return -1;
         }
-
-        if (resp->body.count > 0)
+        size_t value = 0;
+        for (size_t i = 0; i < len; ++i)
         {
-            if (teapot_write((stb_teapot_socket_t)client, resp->body.items, (int)resp->body.count) < 0)
+            if (!TP_CHAR_IS(s[i], TP_CHAR_DIGIT))
+            {
+                return -1;
+            }
+            size_t digit = (size_t)(s[i] - '0');
+            if (value > (SIZE_MAX - digit) / 10)
             {
                 return -1;
             }
+            value = value * 10 + digit;
         }
+        *out = value;
         return 0;
     }
 
-    int teapot_handle_client_connection(teapot_server *server, stb_teapot_socket_t client)
+    static int tp_name_ieq(const char *name, size_t len, const char *lower)
     {
-        if (!server || !socket_ok((stb_teapot_socket_t)client))
+        for (size_t i = 0; i < len; ++i)
         {
-            teapot_close((stb_teapot_socket_t)client);
-            return -1;
+            if (TP_TOLOWER(name[i]) != (unsigned char)lower[i])
+            {
+                return 0;
+            }
         }
+        return lower[len] == '\0';
+    }
 
-        char buffer[8192] = {0};
-        int received = 0;
-        if (teapot_recv_request(client, buffer, (int)sizeof(buffer), &received) < 0)
+    /* FNV-1a over the lowercased bytes, finished with a multiply-xorshift to spread the low bits */
+    static uint32_t tp_name_hash(const char *name, size_t len, uint32_t seed)
+    {
+        uint32_t h = 2166136261u ^ seed;
+        for (size_t i = 0; i < len; ++i)
         {
-            teapot_close((stb_teapot_socket_t)client);
-            return -1;
+            h ^= TP_TOLOWER(name[i]);
+            h *= 16777619u;
         }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        return h;
+    }
 
-        teapot_request req = {0};
-        if (parse_request(buffer, (size_t)received, &req) < 0)
+    /* Slot of a header name, TP_HEADER_KNOWN_COUNT if it has none. The length picks the candidate. */
+    static tp_known_header tp_known_header_id(const char *name, size_t len)
+    {
+        switch (len)
         {
-            free_request(&req);
-            teapot_close((stb_teapot_socket_t)client);
-            return -1;
+        case 4:
+            return tp_name_ieq(name, len, "host") ? TP_HEADER_HOST : TP_HEADER_KNOWN_COUNT;
+        case 10:
+            return tp_name_ieq(name, len, "connection") ? TP_HEADER_CONNECTION : TP_HEADER_KNOWN_COUNT;
+        case 12:
+            return tp_name_ieq(name, len, "content-type") ? TP_HEADER_CONTENT_TYPE : TP_HEADER_KNOWN_COUNT;
+        case 14:
+            return tp_name_ieq(name, len, "content-length") ? TP_HEADER_CONTENT_LENGTH : TP_HEADER_KNOWN_COUNT;
+        default:
+            return TP_HEADER_KNOWN_COUNT;
         }
+    }
 
-        teapot_handler handler = teapot_find_handler(server, &req);
-        teapot_response resp;
-        teapot_response_init(&resp, 200);
-
-        if (handler)
+    // NUL-terminated copy of 'len' bytes of 's' into the empty 'sb': in 'inline_items' if short,
+    // else borrowed from 'arena' (or the heap)
+    static void tp_header_assign(tp_string_builder *sb, char *inline_items, tp_arena *arena, const char *s, size_t len)
+    {
+        if (len + 1 <= TP_HEADER_INLINE)
         {
-            resp = handler(&req);
+            memcpy(inline_items, s, len);
+            inline_items[len] = '\0';
+            sb->items = inline_items;
+            sb->count = len + 1;
+            return;
         }
-        else
+        if (arena != NULL)
         {
-            tp_sb_appendf(&resp.body, "404 Not Found\n");
+            sb->items = tp_arena_strndup(arena, s, len);
+            sb->count = len + 1;
+            return;
         }
-
-        tp_sb_append_null(&resp.body);
-
-        teapot_send_response(client, &resp);
-
-        teapot_response_free(&resp);
-        free_request(&req);
-        teapot_close((stb_teapot_socket_t)client);
-        return 0;
+        tp_sb_append_buf(sb, s, len);
+        tp_sb_append_null(sb);
     }
 
-    // Keep a convenience blocking single-threaded listen that uses the new API
-    int teapot_listen(teapot_server *server)
+    // Point the builders of a line moved from 'old_line' back at its own inline storage
+    static void tp_header_line_rebase(tp_header_line *line, uintptr_t old_line)
     {
-        if (!server)
+        if (line->name.capacity == 0 && (uintptr_t)line->name.items == old_line + offsetof(tp_header_line, inline_name))
         {
-            return 1;
+            line->name.items = line->inline_name;
         }
-
-        stb_teapot_socket_t listen_sock;
-        if (teapot_listener_open(server, &listen_sock) < 0)
+        if (line->value.capacity == 0 && (uintptr_t)line->value.items == old_line + offsetof(tp_header_line, inline_value))
         {
-            return 1;
+            line->value.items = line->inline_value;
         }
+    }
 
-        printf("🫖 stb_teapot listening on port %d\n", server->port);
+#ifndef TP_HEADERS_INIT_CAP
+#define TP_HEADERS_INIT_CAP 16
+#endif
 
-        while (1)
+    // Like tp_da_reserve(), but lines holding inline names or values are rebased after the move
+    static void tp_headers_reserve(tp_headers *h, size_t expected_capacity)
+    {
+        if (expected_capacity <= h->capacity)
         {
-            stb_teapot_socket_t client = teapot_listener_accept(listen_sock);
-            if ((int)client < 0)
-            {
-                continue;
-            }
+            return;
+        }
 
-            // simple single-threaded handling (users can accept and dispatch themselves)
-            teapot_handle_client_connection(server, client);
+        size_t capacity = h->capacity ? h->capacity : TP_HEADERS_INIT_CAP;
+        while (expected_capacity > capacity)
+        {
+            capacity *= 2;
         }
 
-        /* unreachable in current API, but keep symmetry */
-        // teapot_close((stb_teapot_socket_t)listen_sock);
-        return 0;
+        uintptr_t old_items = (uintptr_t)h->items;
+        tp_header_line *items;
+        if (h->capacity == 0)
+        {
+            /* borrowed (or empty): copy out */
+            items = (tp_header_line *)tp_realloc(NULL, capacity * sizeof(tp_header_line));
+            if (!TP_GREW(items))
+            {
+                return;
+            }
+            if (h->count > 0)
+            {
+                memcpy(items, h->items, h->count * sizeof(tp_header_line));
+            }
+        }
+        else
+        {
+            items = (tp_header_line *)tp_realloc(h->items, capacity * sizeof(tp_header_line));
+            if (!TP_GREW(items))
+            {
+                return;
+            }
+        }
+
+        for (size_t i = 0; i < h->count; ++i)
+        {
+            tp_header_line_rebase(&items[i], old_items + i * sizeof(tp_header_line));
+        }
+        h->items = items;
+        h->capacity = capacity;
+    }
+
+    // The line is validated in the same pass that splits it: the name must be a non-empty run of
+    // token characters and the value may only contain field-value characters. Lines containing any
+    // other byte (CTLs, NUL, stray CR, ...) are rejected and 0 is returned.
+    static int tp_split_header_line(const char *line, size_t linelen, tp_str_view *name, tp_str_view *value)
+    {
+        if (!line || linelen == 0)
+        {
+            return 0;
+        }
+
+        const char *p = line;
+        const char *line_end = line + linelen;
+
+        /* name: a token right up to the ':'. Whitespace before it (obs-fold) or before the ':' is
+           rejected, as by tp_request_body_length(), so that no header is read differently from
+           how the request was framed (RFC 9112 5.1, 5.2). */
+        const char *name_start = p;
+        while (p < line_end && TP_CHAR_IS(*p, TP_CHAR_TOKEN))
+        {
+            ++p;
+        }
+        size_t name_len = (size_t)(p - name_start);
+
+        if (name_len == 0 || p == line_end || *p != ':')
+        {
+            return 0;
+        }
+
+        /* value: skip ':' and leading whitespace, validate, then trim trailing whitespace */
+        ++p;
+        p += tp_trim_leading_ws(p, (size_t)(line_end - p));
+        const char *vstart = p;
+        while (p < line_end && TP_CHAR_IS(*p, TP_CHAR_FIELD_VALUE))
+        {
+            ++p;
+        }
+
+        if (p != line_end)
+        {
+            return 0;
+        }
+        size_t vlen = tp_trim_ws(vstart, (size_t)(line_end - vstart));
+
+        /* clamp to configured maxima */
+#ifndef TP_MAX_HEADER_NAME_LEN
+#define TP_MAX_HEADER_NAME_LEN 256
+#endif
+#ifndef TP_MAX_HEADER_VALUE_LEN
+#define TP_MAX_HEADER_VALUE_LEN 4096
+#endif
+        if (name_len > (size_t)TP_MAX_HEADER_NAME_LEN)
+        {
+            name_len = (size_t)TP_MAX_HEADER_NAME_LEN;
+        }
+
+        if (vlen > (size_t)TP_MAX_HEADER_VALUE_LEN)
+        {
+            vlen = (size_t)TP_MAX_HEADER_VALUE_LEN;
+        }
+
+        name->items = name_start;
+        name->count = name_len;
+        value->items = vstart;
+        value->count = vlen;
+        return 1;
+    }
+
+    // TODO: handle multiple headers with same name (append to existing value with comma separation)
+    // With an arena, long names and values are borrowed from it and 'headers_parsed' must have room.
+    static int tp_parse_and_append_header_line(tp_headers *headers_parsed, tp_arena *arena, const char *line, size_t linelen)
+    {
+        tp_str_view name;
+        tp_str_view value;
+        if (!headers_parsed || !tp_split_header_line(line, linelen, &name, &value))
+        {
+            return 0;
+        }
+
+        tp_known_header known = tp_known_header_id(name.items, name.count);
+        if (known != TP_HEADER_KNOWN_COUNT && headers_parsed->known[known] == 0)
+        {
+            headers_parsed->known[known] = (uint32_t)(headers_parsed->count + 1);
+        }
+
+        /* filled in place: inline strings must not be copied into the array afterwards */
+        if (arena == NULL)
+        {
+            tp_headers_reserve(headers_parsed, headers_parsed->count + 1);
+            if (!tp_da_has_room(headers_parsed, headers_parsed->count + 1))
+            {
+                return 0;
+            }
+        }
+        tp_header_line *header_line = &headers_parsed->items[headers_parsed->count++];
+        memset(header_line, 0, sizeof(*header_line));
+        tp_header_assign(&header_line->name, header_line->inline_name, arena, name.items, name.count);
+        if (value.count)
+        {
+            tp_header_assign(&header_line->value, header_line->inline_value, arena, value.items, value.count);
+        }
+        return 1;
+    }
+
+    /* Every CR or LF may end a line: an upper bound on the number of header lines */
+    static size_t tp_header_max_lines(const char *raw_header, size_t header_size)
+    {
+        size_t max_lines = 1;
+        for (size_t i = 0; i < header_size; ++i)
+        {
+            max_lines += (raw_header[i] == '\r' || raw_header[i] == '\n');
+        }
+        return max_lines;
+    }
+
+    /* Next non-empty line at or after '*pos' (CR, LF or CRLF terminated). Returns 0 at the end. */
+    static int tp_header_next_line(const char *raw_header, size_t header_size, size_t *pos, tp_str_view *line)
+    {
+        size_t i = *pos;
+        while (i < header_size)
+        {
+            size_t line_start = i;
+            size_t line_end = line_start;
+
+            // find end of line
+            while ((line_end < header_size) && (raw_header[line_end] != '\r') && (raw_header[line_end] != '\n'))
+            {
+                ++line_end;
+            }
+
+            /* advance past CR/LF */
+            i = line_end;
+            if (i < header_size && raw_header[i] == '\r')
+            {
+                ++i;
+            }
+
+            if (i < header_size && raw_header[i] == '\n')
+            {
+                ++i;
+            }
+
+            if (line_end > line_start)
+            {
+                *pos = i;
+                line->items = raw_header + line_start;
+                line->count = line_end - line_start;
+                return 1;
+            }
+        }
+        *pos = i;
+        return 0;
+    }
+
+    static void tp_extract_header_lines(tp_headers *headers_parsed, tp_arena *arena, const char *raw_header, size_t header_size)
+    {
+        if (headers_parsed == NULL || raw_header == NULL || header_size == 0)
+        {
+            return;
+        }
+
+        /* optional global clamp if defined */
+#ifdef TP_MAX_HEADER_TOTAL
+        if (header_size > (size_t)TP_MAX_HEADER_TOTAL)
+            header_size = (size_t)TP_MAX_HEADER_TOTAL;
+#endif
+
+        if (arena != NULL)
+        {
+            /* enough slots for every line, borrowed from the arena */
+            size_t max_lines = tp_header_max_lines(raw_header, header_size);
+            headers_parsed->items = (tp_header_line *)tp_arena_alloc(arena, max_lines * sizeof(tp_header_line));
+            headers_parsed->count = 0;
+            headers_parsed->capacity = 0;
+            if (headers_parsed->items == NULL)
+            {
+                return;
+            }
+        }
+
+        /* scan line by line and use helper to parse each non-empty line */
+        size_t pos = 0;
+        tp_str_view line;
+        while (tp_header_next_line(raw_header, header_size, &pos, &line))
+        {
+            tp_parse_and_append_header_line(headers_parsed, arena, line.items, line.count);
+        }
+    }
+
+    /* Body length announced by the header block 'raw_header' (request line included). Names are
+       matched case-insensitively and repeated Content-Length values must agree, so the request can
+       only be framed one way, by whoever reads it. Returns 0, or the status to refuse it with: 400
+       for a malformed or conflicting Content-Length (or whitespace before a name or its ':'), 501 for a
+       Transfer-Encoding, as chunked bodies aren't supported. */
+    static int tp_request_body_length(const char *raw_header, size_t header_size, size_t *out)
+    {
+        *out = 0;
+        int seen = 0;
+        size_t pos = 0;
+        tp_str_view line;
+        int request_line = 1;
+        while (tp_header_next_line(raw_header, header_size, &pos, &line))
+        {
+            if (request_line)
+            {
+                request_line = 0;
+                continue;
+            }
+            if (TP_CHAR_IS(line.items[0], TP_CHAR_OWS))
+            {
+                return 400; /* obs-fold */
+            }
+            const char *colon = (const char *)memchr(line.items, ':', line.count);
+            if (colon == NULL)
+            {
+                continue;
+            }
+            size_t name_len = (size_t)(colon - line.items);
+            if (name_len > 0 && TP_CHAR_IS(line.items[name_len - 1], TP_CHAR_OWS))
+            {
+                return 400;
+            }
+            if (tp_name_ieq(line.items, name_len, "transfer-encoding"))
+            {
+                return 501;
+            }
+            if (tp_known_header_id(line.items, name_len) != TP_HEADER_CONTENT_LENGTH)
+            {
+                continue;
+            }
+            const char *value = colon + 1;
+            size_t value_len = line.count - name_len - 1;
+            size_t length;
+            if (tp_parse_decimal(value + tp_trim_leading_ws(value, value_len), tp_trim_ws(value, value_len), &length) < 0 ||
+                (seen && length != *out))
+            {
+                return 400;
+            }
+            *out = length;
+            seen = 1;
+        }
+        return 0;
+    }
+
+    void tp_extract_header_keyval(tp_headers *headers_parsed, char *raw_header, size_t header_size)
+    {
+        tp_extract_header_lines(headers_parsed, NULL, raw_header, header_size);
+    }
+
+    size_t tp_header_block_parse(tp_header_block *block, tp_arena *arena, const char *raw_header, size_t header_size)
+    {
+        memset(block, 0, sizeof(*block));
+        if (raw_header == NULL || header_size == 0 || header_size >= UINT32_MAX / 2)
+        {
+            return 0;
+        }
+
+#ifdef TP_MAX_HEADER_TOTAL
+        if (header_size > (size_t)TP_MAX_HEADER_TOTAL)
+            header_size = (size_t)TP_MAX_HEADER_TOTAL;
+#endif
+
+        /* a valid line takes at least 3 bytes ("a:" and its end of line, except the last one) and
+           stores at most its own bytes minus the ':' plus two NULs */
+        size_t max_entries = (header_size + 1) / 3 + 1;
+        size_t table_size = max_entries * sizeof(tp_header_entry);
+        size_t total = table_size + header_size + max_entries;
+        if (arena != NULL)
+        {
+            block->entries = (tp_header_entry *)tp_arena_alloc(arena, total);
+        }
+        else
+        {
+            block->entries = (tp_header_entry *)tp_realloc(NULL, total);
+            block->owned = 1;
+        }
+        if (!TP_GREW(block->entries))
+        {
+            block->owned = 0;
+            return 0;
+        }
+        char *data = (char *)block->entries + table_size;
+        block->data = data;
+
+        size_t used = 0;
+        size_t pos = 0;
+        tp_str_view line;
+        while (tp_header_next_line(raw_header, header_size, &pos, &line))
+        {
+            tp_str_view name;
+            tp_str_view value;
+            if (!tp_split_header_line(line.items, line.count, &name, &value))
+            {
+                continue;
+            }
+
+            tp_known_header known = tp_known_header_id(name.items, name.count);
+            if (known != TP_HEADER_KNOWN_COUNT && block->known[known] == 0)
+            {
+                block->known[known] = (uint32_t)(block->count + 1);
+            }
+
+            tp_header_entry *entry = &block->entries[block->count++];
+            entry->hash = tp_name_hash(name.items, name.count, 0);
+            entry->name_off = (uint32_t)used;
+            entry->name_len = (uint16_t)name.count;
+            memcpy(data + used, name.items, name.count);
+            used += name.count;
+            data[used++] = '\0';
+
+            entry->value_off = (uint32_t)used;
+            entry->value_len = (uint16_t)value.count;
+            memcpy(data + used, value.items, value.count);
+            used += value.count;
+            data[used++] = '\0';
+        }
+        return block->count;
+    }
+
+    void tp_header_block_free(tp_header_block *block)
+    {
+        if (block->owned)
+        {
+            tp_free(block->entries);
+        }
+        memset(block, 0, sizeof(*block));
+    }
+
+    tp_str_view tp_header_block_name(const tp_header_block *block, size_t index)
+    {
+        const tp_header_entry *entry = &block->entries[index];
+        tp_str_view name = {block->data + entry->name_off, entry->name_len};
+        return name;
+    }
+
+    tp_str_view tp_header_block_value(const tp_header_block *block, size_t index)
+    {
+        const tp_header_entry *entry = &block->entries[index];
+        tp_str_view value = {block->data + entry->value_off, entry->value_len};
+        return value;
+    }
+
+    /* Index of the first entry called 'name', block->count if there is none */
+    static size_t tp_header_block_find(const tp_header_block *block, const char *name)
+    {
+        size_t name_len = strlen(name);
+        uint32_t hash = tp_name_hash(name, name_len, 0);
+        for (size_t i = 0; i < block->count; ++i)
+        {
+            const tp_header_entry *entry = &block->entries[i];
+            if (entry->hash == hash && entry->name_len == name_len &&
+                tp_strnicmp(block->data + entry->name_off, name, name_len) == 0)
+            {
+                return i;
+            }
+        }
+        return block->count;
+    }
+
+    tp_str_view tp_header_block_get(const tp_header_block *block, const char *name)
+    {
+        tp_str_view none = {NULL, 0};
+        if (block == NULL || name == NULL)
+        {
+            return none;
+        }
+        size_t i = tp_header_block_find(block, name);
+        return i < block->count ? tp_header_block_value(block, i) : none;
+    }
+
+    tp_str_view tp_header_block_known(const tp_header_block *block, tp_known_header id)
+    {
+        tp_str_view none = {NULL, 0};
+        if (block == NULL || id >= TP_HEADER_KNOWN_COUNT || block->known[id] == 0)
+        {
+            return none;
+        }
+        return tp_header_block_value(block, block->known[id] - 1);
+    }
+
+    /* Parse the header section into h->block, from 'arena' if given, and point one line of
+       'h->items' at each of its entries. Empty values are left NULL, as tp_header_assign() does. */
+    static void tp_headers_parse_block(tp_headers *h, tp_arena *arena, const char *raw_header, size_t header_size)
+    {
+        size_t count = tp_header_block_parse(&h->block, arena, raw_header, header_size);
+        if (count == 0)
+        {
+            return;
+        }
+
+        size_t size = count * sizeof(tp_header_line);
+        h->items = (tp_header_line *)(arena != NULL ? tp_arena_alloc(arena, size) : tp_realloc(NULL, size));
+        if (!TP_GREW(h->items))
+        {
+            return;
+        }
+        h->capacity = arena != NULL ? 0 : count;
+        memset(h->items, 0, size);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const tp_header_entry *entry = &h->block.entries[i];
+            h->items[i].name.items = h->block.data + entry->name_off;
+            h->items[i].name.count = (size_t)entry->name_len + 1;
+            if (entry->value_len > 0)
+            {
+                h->items[i].value.items = h->block.data + entry->value_off;
+                h->items[i].value.count = (size_t)entry->value_len + 1;
+            }
+        }
+        h->count = count;
+        memcpy(h->known, h->block.known, sizeof(h->known));
+    }
+
+    /* helper: find header line by name (returns NULL if not found) */
+    static const tp_header_line *tp_headers_find(const tp_headers *h, const char *name)
+    {
+        if (h == NULL || name == NULL)
+            return NULL;
+        if (h->block.entries != NULL)
+        {
+            size_t i = tp_header_block_find(&h->block, name);
+            return i < h->count ? &h->items[i] : NULL;
+        }
+        for (size_t i = 0; i < h->count; ++i)
+        {
+            const char *hn = h->items[i].name.items ? h->items[i].name.items : "";
+            if (tp_stricmp(hn, name) == 0)
+                return &h->items[i];
+        }
+        return NULL;
+    }
+
+    /* Return 1 if header 'name' exists and its value equals 'expected_value', otherwise 0 */
+    int tp_headers_match(const tp_headers *h, const char *name, const char *expected_value)
+    {
+        if (h == NULL || name == NULL || expected_value == NULL)
+            return 0;
+        const tp_string_builder *val = tp_headers_get(h, name);
+        if (val == NULL || val->items == NULL)
+            return 0;
+        return strcmp(val->items, expected_value) == 0 ? 1 : 0;
+    }
+
+    const tp_string_builder *tp_headers_get(const tp_headers *h, const char *name)
+    {
+        const tp_header_line *hl = tp_headers_find(h, name);
+        return hl ? &hl->value : NULL;
+    }
+
+    const tp_string_builder *tp_headers_known(const tp_headers *h, tp_known_header id)
+    {
+        if (h == NULL || (unsigned)id >= TP_HEADER_KNOWN_COUNT)
+        {
+            return NULL;
+        }
+        uint32_t line = h->block.entries != NULL ? h->block.known[id] : h->known[id];
+        return line != 0 ? &h->items[line - 1].value : NULL;
+    }
+
+    tp_header_result tp_headers_check(const tp_headers *h, const char *name, const char *expected_value, tp_header_line *o_header_line)
+    {
+        if (expected_value == NULL)
+        {
+            const tp_header_line *hl = tp_headers_find(h, name);
+            if (!hl)
+            {
+                return TP_HEADER_NOT_FOUND;
+            }
+
+            if (o_header_line)
+            {
+                *o_header_line = *hl;
+            }
+
+            return TP_HEADER_FOUND;
+        }
+
+        const tp_header_line *hl = tp_headers_find(h, name);
+        if (!hl)
+        {
+            return TP_HEADER_NOT_FOUND;
+        }
+
+        if (o_header_line)
+        {
+            *o_header_line = *hl;
+        }
+
+        const char *val = hl->value.items ? hl->value.items : "";
+        return (strcmp(val, expected_value) == 0) ? TP_HEADER_MATCH : TP_HEADER_FOUND;
+    }
+
+// =====================================================
+// 🛠 Implementation
+// =====================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+    static void teapot_init(void)
+    {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    }
+
+    static void teapot_close(stb_teapot_socket_t s)
+    {
+#ifdef _WIN32
+        closesocket(s);
+#else
+        close(s);
+#endif
+    }
+
+    static int teapot_read(stb_teapot_socket_t s, char *buf, int len)
+    {
+        if (len <= 0)
+        {
+            return 0;
+        }
+
+#ifdef _WIN32
+        return recv(s, buf, len, 0);
+#else
+        return (int)read(s, buf, (size_t)len);
+#endif
+    }
+
+    static int teapot_write(stb_teapot_socket_t s, const char *buf, int len)
+    {
+        if (len <= 0)
+        {
+            return 0;
+        }
+
+#ifdef _WIN32
+        return send(s, buf, len, 0);
+#else
+        return (int)write(s, buf, (size_t)len);
+#endif
+    }
+
+    // -----------------------------------------------------
+    // 🧩 Request Parsing (minimal, single-line HTTP/1.0)
+    // -----------------------------------------------------
+    static teapot_method parse_method(const char *s)
+    {
+        for (int m = 0; m < (int)TEAPOT_UNKNOWN; ++m)
+        {
+            if (strcmp(s, teapot_method_str((teapot_method)m)) == 0)
+                return (teapot_method)m;
+        }
+        return TEAPOT_UNKNOWN;
+    }
+
+    static void free_request(teapot_request *req)
+    {
+        tp_sb_free(req->path);
+        tp_sb_free(req->body);
+        tp_headers_free(&req->headers);
+    }
+
+    static int parse_request(char *buffer, size_t size, teapot_request *req)
+    {
+        if (buffer == NULL || size == 0 || req == NULL)
+        {
+            return -1;
+        }
+
+        /* ensure headers/builders start empty */
+        memset(&req->path, 0, sizeof(req->path));
+        memset(&req->body, 0, sizeof(req->body));
+        memset(&req->headers, 0, sizeof(req->headers));
+
+        char method_buf[8] = {0};
+        char path_buf[512] = {0};
+        char version_buf[16] = {0};
+
+        sscanf(buffer, "%7s %511s %15s", method_buf, path_buf, version_buf);
+        teapot_method method = parse_method(method_buf);
+        if (method == TEAPOT_UNKNOWN)
+        {
+            return -1;
+        }
+
+        const char *ct = strstr(buffer, "Content-Type:");
+        const char *body_start = strstr(buffer, "\r\n\r\n");
+
+        char content_type[128] = "";
+        size_t content_length = 0;
+        const char *body = "";
+
+        if (ct)
+        {
+            sscanf(ct, "Content-Type: %127s", content_type);
+        }
+
+        /* framed exactly as tp_complete_request_length() did */
+        if (tp_request_body_length(buffer, body_start ? (size_t)(body_start - buffer) : size, &content_length) != 0)
+        {
+            return -1;
+        }
+
+        if (body_start)
+        {
+            body_start += 4;
+            body = body_start;
+        }
+
+        /* never read past what was received */
+        size_t available = body_start ? size - (size_t)(body_start - buffer) : 0;
+        if (content_length > available)
+        {
+            content_length = available;
+        }
+
+        /* extract headers from start..(body_start) */
+        size_t header_size = size;
+        if (body_start)
+            header_size = (size_t)(body_start - buffer);
+        tp_headers_parse_block(&req->headers, req->arena, buffer, header_size);
+
+        req->method = method;
+        if (req->arena != NULL)
+        {
+            size_t path_len = strlen(path_buf);
+            req->path.items = tp_arena_strndup(req->arena, path_buf, path_len);
+            req->path.count = path_len + 1;
+            req->body.items = tp_arena_strndup(req->arena, body, content_length);
+            req->body.count = content_length + 1;
+        }
+        else
+        {
+            tp_sb_append_buf(&req->path, path_buf, strlen(path_buf));
+            tp_sb_append_null(&req->path);
+
+            if (content_length > 0)
+            {
+                tp_sb_append_buf(&req->body, body, content_length);
+            }
+            tp_sb_append_null(&req->body);
+        }
+
+        req->body_length = content_length;
+
+        /* HTTP/1.1 connections persist unless the client says otherwise, HTTP/1.0 ones only on request.
+           Connection is a token list ("keep-alive, Upgrade"). */
+        int close_token = 0;
+        int keep_alive_token = 0;
+        const tp_string_builder *connection = tp_headers_known(&req->headers, TP_HEADER_CONNECTION);
+        if (connection != NULL && connection->items != NULL)
+        {
+            tp_splitter it;
+            tp_str_view token;
+            tp_splitter_init(&it, connection->items, strlen(connection->items), ", \t");
+            while (tp_splitter_next(&it, &token))
+            {
+                close_token |= tp_name_ieq(token.items, token.count, "close");
+                keep_alive_token |= tp_name_ieq(token.items, token.count, "keep-alive");
+            }
+        }
+        if (strcmp(version_buf, "HTTP/1.1") == 0)
+        {
+            req->keep_alive = !close_token;
+        }
+        else
+        {
+            req->keep_alive = keep_alive_token && !close_token;
+        }
+
+        return 0;
+    }
+
+    void *teapot_request_alloc(const teapot_request *req, size_t size)
+    {
+        if (req == NULL || req->arena == NULL)
+        {
+            return NULL;
+        }
+        return tp_arena_alloc(req->arena, size);
+    }
+
+    // -----------------------------------------------------
+    // 🌳 Radix Tree Router
+    // -----------------------------------------------------
+#define TP_ROUTER_NIL UINT32_MAX
+
+    enum
+    {
+        TP_ROUTER_NODE_STATIC,
+        TP_ROUTER_NODE_PARAM,
+        TP_ROUTER_NODE_CATCHALL,
+        TP_ROUTER_NODE_PATTERN // accepting state of the pattern DFA, not linked into the tree
+    };
+
+    static uint32_t tp_router_new_node(teapot_router *router, uint8_t kind, const char *label, size_t label_len)
+    {
+        tp_router_node node = {0};
+        node.label.items = label;
+        node.label.count = label_len;
+        node.first_child = TP_ROUTER_NIL;
+        node.next_sibling = TP_ROUTER_NIL;
+        node.param_child = TP_ROUTER_NIL;
+        node.catchall_child = TP_ROUTER_NIL;
+        node.kind = kind;
+        tp_da_append(&router->nodes, node);
+        return (uint32_t)(router->nodes.count - 1);
+    }
+
+    /* Room for 'more' nodes, so that nodes can be created and used without checking each one */
+    static int tp_router_reserve_nodes(teapot_router *router, size_t more)
+    {
+        tp_da_reserve(&router->nodes, router->nodes.count + more);
+        return tp_da_has_room(&router->nodes, router->nodes.count + more) ? 0 : -1;
+    }
+
+    /* Insert static text 's' below 'parent', splitting edges as needed. Returns the node where 's'
+       ends, TP_ROUTER_NIL if the nodes can't grow. */
+    static uint32_t tp_router_insert_static(teapot_router *router, uint32_t parent, const char *s, size_t len)
+    {
+        /* every split consumes a byte of 's', and the last step may add a leaf */
+        if (tp_router_reserve_nodes(router, len + 1) < 0)
+        {
+            return TP_ROUTER_NIL;
+        }
+        while (len > 0)
+        {
+            uint32_t prev = TP_ROUTER_NIL;
+            uint32_t child = router->nodes.items[parent].first_child;
+            while (child != TP_ROUTER_NIL && router->nodes.items[child].label.items[0] != s[0])
+            {
+                prev = child;
+                child = router->nodes.items[child].next_sibling;
+            }
+
+            if (child == TP_ROUTER_NIL)
+            {
+                uint32_t node = tp_router_new_node(router, TP_ROUTER_NODE_STATIC, s, len);
+                router->nodes.items[node].next_sibling = router->nodes.items[parent].first_child;
+                router->nodes.items[parent].first_child = node;
+                return node;
+            }
+
+            tp_str_view label = router->nodes.items[child].label;
+            size_t common = 0;
+            while (common < label.count && common < len && label.items[common] == s[common])
+            {
+                ++common;
+            }
+
+            if (common < label.count)
+            {
+                /* split: 'mid' takes the common prefix and the place of 'child' among its siblings */
+                uint32_t mid = tp_router_new_node(router, TP_ROUTER_NODE_STATIC, label.items, common);
+                tp_router_node *nodes = router->nodes.items;
+                nodes[mid].next_sibling = nodes[child].next_sibling;
+                nodes[mid].first_child = child;
+                nodes[child].next_sibling = TP_ROUTER_NIL;
+                nodes[child].label.items += common;
+                nodes[child].label.count -= common;
+                if (prev == TP_ROUTER_NIL)
+                {
+                    nodes[parent].first_child = mid;
+                }
+                else
+                {
+                    nodes[prev].next_sibling = mid;
+                }
+                child = mid;
+            }
+
+            parent = child;
+            s += common;
+            len -= common;
+        }
+        return parent;
+    }
+
+    /* Get or create the ':param' / '*' child of 'parent'. Returns TP_ROUTER_NIL on a name conflict
+       (or if the nodes can't grow). */
+    static uint32_t tp_router_insert_wildcard(teapot_router *router, uint32_t parent, uint8_t kind, const char *name, size_t name_len)
+    {
+        uint32_t child = (kind == TP_ROUTER_NODE_PARAM) ? router->nodes.items[parent].param_child
+                                                        : router->nodes.items[parent].catchall_child;
+        if (child != TP_ROUTER_NIL)
+        {
+            tp_str_view label = router->nodes.items[child].label;
+            if (label.count != name_len || memcmp(label.items, name, name_len) != 0)
+            {
+                return TP_ROUTER_NIL;
+            }
+            return child;
+        }
+
+        if (tp_router_reserve_nodes(router, 1) < 0)
+        {
+            return TP_ROUTER_NIL;
+        }
+        child = tp_router_new_node(router, kind, name, name_len);
+        if (kind == TP_ROUTER_NODE_PARAM)
+        {
+            router->nodes.items[parent].param_child = child;
+        }
+        else
+        {
+            router->nodes.items[parent].catchall_child = child;
+        }
+        return child;
+    }
+
+    static int tp_router_insert(teapot_router *router, const teapot_route *route)
+    {
+        if (route->path == NULL || route->path[0] != '/' || route->handler == NULL || route->method >= TEAPOT_UNKNOWN)
+        {
+            return -1;
+        }
+
+        const char *path = route->path;
+        size_t len = strlen(path);
+        size_t param_count = 0;
+        uint32_t node = 0;
+        size_t i = 0;
+
+        while (i < len)
+        {
+            int segment_start = (i > 0 && path[i - 1] == '/');
+            if (segment_start && (path[i] == ':' || path[i] == '*'))
+            {
+                uint8_t kind = (path[i] == ':') ? TP_ROUTER_NODE_PARAM : TP_ROUTER_NODE_CATCHALL;
+                size_t name_start = i + 1;
+                size_t name_end = name_start;
+                while (name_end < len && path[name_end] != '/')
+                {
+                    ++name_end;
+                }
+
+                if (kind == TP_ROUTER_NODE_PARAM && name_end == name_start)
+                {
+                    return -1; /* ":" without a name */
+                }
+
+                if (kind == TP_ROUTER_NODE_CATCHALL && name_end != len)
+                {
+                    return -1; /* catch-all must be the last segment */
+                }
+
+                if (++param_count > TP_MAX_ROUTE_PARAMS)
+                {
+                    return -1;
+                }
+
+                /* an unnamed catch-all is reported as "*" */
+                const char *name = (name_end == name_start) ? path + i : path + name_start;
+                size_t name_len = (name_end == name_start) ? 1 : name_end - name_start;
+                node = tp_router_insert_wildcard(router, node, kind, name, name_len);
+                if (node == TP_ROUTER_NIL)
+                {
+                    return -1; /* same position, different parameter name */
+                }
+                i = name_end;
+                continue;
+            }
+
+            /* static run up to the next ':' or '*' starting a segment */
+            size_t run_end = i + 1;
+            while (run_end < len && !(path[run_end - 1] == '/' && (path[run_end] == ':' || path[run_end] == '*')))
+            {
+                ++run_end;
+            }
+            node = tp_router_insert_static(router, node, path + i, run_end - i);
+            if (node == TP_ROUTER_NIL)
+            {
+                return -1;
+            }
+            i = run_end;
+        }
+
+        /* first route wins, like the linear scan did */
+        if (router->nodes.items[node].handlers[route->method] == NULL)
+        {
+            router->nodes.items[node].handlers[route->method] = route->handler;
+            router->nodes.items[node].methods |= TEAPOT_METHOD_BIT(route->method);
+        }
+        return 0;
+    }
+
+    /* HEAD is served wherever GET is (RFC 9110 9.3.2), by the GET handler unless a route handles
+       HEAD itself. The body is left out when the response is sent. */
+    static void tp_router_add_implicit_head(teapot_router *router)
+    {
+        for (size_t i = 0; i < router->nodes.count; ++i)
+        {
+            tp_router_node *node = &router->nodes.items[i];
+            if ((node->methods & TEAPOT_METHOD_BIT(TEAPOT_GET)) && node->handlers[TEAPOT_HEAD] == NULL)
+            {
+                node->handlers[TEAPOT_HEAD] = node->handlers[TEAPOT_GET];
+                node->methods |= TEAPOT_METHOD_BIT(TEAPOT_HEAD);
+            }
+        }
+    }
+
+    /* Precompute the Allow line of every routed node. Nodes with the same method set share one line. */
+    static void tp_router_build_allow_lines(teapot_router *router)
+    {
+        uint32_t cached_offset[TEAPOT_METHOD_BIT(TEAPOT_UNKNOWN)];
+        uint32_t cached_len[TEAPOT_METHOD_BIT(TEAPOT_UNKNOWN)] = {0};
+
+        for (size_t i = 0; i < router->nodes.count; ++i)
+        {
+            tp_router_node *node = &router->nodes.items[i];
+            if (node->methods == 0)
+            {
+                continue;
+            }
+
+            uint32_t allowed = node->methods | TEAPOT_METHOD_BIT(TEAPOT_OPTIONS);
+            if (cached_len[allowed] == 0)
+            {
+                size_t start = router->allow_lines.count;
+                tp_sb_append_cstr(&router->allow_lines, "Allow: ");
+                for (int m = 0; m < (int)TEAPOT_UNKNOWN; ++m)
+                {
+                    if (allowed & TEAPOT_METHOD_BIT(m))
+                    {
+                        if (router->allow_lines.count > start + 7)
+                        {
+                            tp_sb_append_buf(&router->allow_lines, ", ", 2);
+                        }
+                        tp_sb_append_cstr(&router->allow_lines, teapot_method_str((teapot_method)m));
+                    }
+                }
+                tp_sb_append_buf(&router->allow_lines, "\r\n", 2);
+                cached_offset[allowed] = (uint32_t)start;
+                cached_len[allowed] = (uint32_t)(router->allow_lines.count - start);
+            }
+            node->allow_offset = cached_offset[allowed];
+            node->allow_len = cached_len[allowed];
+        }
+    }
+
+    typedef struct
+    {
+        const teapot_router *router;
+        const tp_router_node *node;
+    } tp_router_hit;
+
+    // -----------------------------------------------------------------------------
+    // 🧩 Pattern routes: glob/regex subset compiled to a DFA
+    // -----------------------------------------------------------------------------
+
+#ifndef TP_ROUTER_MAX_DFA_STATES
+#define TP_ROUTER_MAX_DFA_STATES 4096
+#endif
+
+    enum
+    {
+        TP_PATTERN_ONE,   // one byte of 'set', then the next position
+        TP_PATTERN_STAR,  // any number of bytes of 'set'
+        TP_PATTERN_ACCEPT // end of a pattern
+    };
+
+    /* One position of the pattern NFA. Position k only ever moves to k or k + 1, so the NFA of
+       all patterns is just their positions laid end to end. */
+    typedef struct
+    {
+        uint8_t set[32];
+        uint8_t kind;
+        teapot_method method;    // TP_PATTERN_ACCEPT only
+        teapot_handler handler;  // TP_PATTERN_ACCEPT only
+    } tp_pattern_pos;
+
+    typedef struct
+    {
+        tp_pattern_pos *items;
+        size_t count;
+        size_t capacity;
+    } tp_pattern_positions;
+
+    typedef struct
+    {
+        uint64_t *items;
+        size_t count;
+        size_t capacity;
+    } tp_pattern_sets;
+
+#define TP_SET_HAS(set, c) (((set)[(uint8_t)(c) >> 3] >> ((uint8_t)(c) & 7)) & 1)
+#define TP_SET_ADD(set, c) ((set)[(uint8_t)(c) >> 3] |= (uint8_t)(1u << ((uint8_t)(c) & 7)))
+
+    /* Append the positions of 'p' (after the '~'). Returns -1 on a syntax error. */
+    static int tp_pattern_parse(tp_pattern_positions *out, const char *p, teapot_method method, teapot_handler handler)
+    {
+        if (p[0] != '/')
+        {
+            return -1;
+        }
+
+        size_t first = out->count;
+        while (*p != '\0')
+        {
+            tp_pattern_pos pos = {0};
+            pos.kind = TP_PATTERN_ONE;
+
+            if (*p == '+')
+            {
+                if (out->count == first || out->items[out->count - 1].kind != TP_PATTERN_ONE)
+                {
+                    return -1; /* nothing to repeat */
+                }
+                /* x+ is x x* */
+                pos = out->items[out->count - 1];
+                pos.kind = TP_PATTERN_STAR;
+                ++p;
+            }
+            else if (*p == '*')
+            {
+                int deep = (p[1] == '*');
+                memset(pos.set, 0xff, sizeof(pos.set));
+                if (!deep)
+                {
+                    pos.set['/' >> 3] &= (uint8_t)~(1u << ('/' & 7));
+                }
+                pos.kind = TP_PATTERN_STAR;
+                p += deep ? 2 : 1;
+            }
+            else if (*p == '?')
+            {
+                memset(pos.set, 0xff, sizeof(pos.set));
+                pos.set['/' >> 3] &= (uint8_t)~(1u << ('/' & 7));
+                ++p;
+            }
+            else if (*p == '[')
+            {
+                ++p;
+                int negate = (*p == '^' || *p == '!');
+                if (negate)
+                {
+                    ++p;
+                }
+
+                const char *start = p;
+                while (*p != '\0' && (*p != ']' || p == start))
+                {
+                    unsigned lo = (unsigned char)*p;
+                    unsigned hi = lo;
+                    if (p[1] == '-' && p[2] != '\0' && p[2] != ']')
+                    {
+                        hi = (unsigned char)p[2];
+                        p += 2;
+                    }
+                    for (unsigned c = lo; c <= hi; ++c)
+                    {
+                        TP_SET_ADD(pos.set, c);
+                    }
+                    ++p;
+                }
+                if (*p != ']')
+                {
+                    return -1; /* unterminated set */
+                }
+                ++p;
+
+                if (negate)
+                {
+                    for (size_t i = 0; i < sizeof(pos.set); ++i)
+                    {
+                        pos.set[i] = (uint8_t)~pos.set[i];
+                    }
+                    pos.set['/' >> 3] &= (uint8_t)~(1u << ('/' & 7));
+                }
+            }
+            else
+            {
+                if (*p == '\\' && p[1] != '\0')
+                {
+                    ++p;
+                }
+                TP_SET_ADD(pos.set, *p);
+                ++p;
+            }
+
+            tp_da_append(out, pos);
+        }
+
+        tp_pattern_pos accept = {0};
+        accept.kind = TP_PATTERN_ACCEPT;
+        accept.method = method;
+        accept.handler = handler;
+        tp_da_append(out, accept);
+        return 0;
+    }
+
+    /* Add k + 1 for every STAR position k in 'set' (zero repetitions). Chains resolve in one
+       ascending pass because positions only move forward. */
+    static void tp_pattern_closure(const tp_pattern_positions *positions, uint64_t *set)
+    {
+        for (size_t k = 0; k < positions->count; ++k)
+        {
+            if (((set[k >> 6] >> (k & 63)) & 1) && positions->items[k].kind == TP_PATTERN_STAR)
+            {
+                set[(k + 1) >> 6] |= 1ull << ((k + 1) & 63);
+            }
+        }
+    }
+
+    static uint64_t tp_pattern_set_hash(const uint64_t *set, size_t words)
+    {
+        uint64_t h = 1469598103934665603ull;
+        for (size_t i = 0; i < words; ++i)
+        {
+            h = (h ^ set[i]) * 1099511628211ull;
+        }
+        return h ^ (h >> 29);
+    }
+
+    /* Subset construction over every '~' route. Returns -1 on a bad pattern or too many states. */
+    static int tp_router_compile_patterns(teapot_router *router, const teapot_route *routes, size_t route_count)
+    {
+        tp_pattern_positions positions = {0};
+        for (size_t i = 0; i < route_count; ++i)
+        {
+            const teapot_route *r = &routes[i];
+            if (r->path == NULL || r->path[0] != '~')
+            {
+                continue;
+            }
+            if (r->handler == NULL || r->method >= TEAPOT_UNKNOWN ||
+                tp_pattern_parse(&positions, r->path + 1, r->method, r->handler) < 0)
+            {
+                fprintf(stderr, "stb_teapot: invalid route '%s'\n", r->path);
+                tp_da_free(positions);
+                return -1;
+            }
+        }
+
+        if (positions.count == 0)
+        {
+            return 0;
+        }
+
+        /* bytes no position tells apart share a class */
+        tp_router_dfa *dfa = &router->patterns;
+        uint8_t representative[256];
+        dfa->class_count = 1;
+        memset(dfa->byte_class, 0, sizeof(dfa->byte_class));
+        for (size_t k = 0; k < positions.count; ++k)
+        {
+            if (positions.items[k].kind == TP_PATTERN_ACCEPT)
+            {
+                continue;
+            }
+            uint16_t split[512];
+            memset(split, 0xff, sizeof(split));
+            uint32_t classes = 0;
+            for (unsigned c = 0; c < 256; ++c)
+            {
+                unsigned key = (unsigned)dfa->byte_class[c] * 2u + TP_SET_HAS(positions.items[k].set, c);
+                if (split[key] == 0xffff)
+                {
+                    split[key] = (uint16_t)classes++;
+                }
+                dfa->byte_class[c] = (uint8_t)split[key];
+            }
+            dfa->class_count = classes;
+        }
+        for (unsigned c = 256; c-- > 0;)
+        {
+            representative[dfa->byte_class[c]] = (uint8_t)c;
+        }
+
+        size_t words = (positions.count + 63) / 64;
+        tp_pattern_sets sets = {0};
+        uint64_t *scratch = (uint64_t *)tp_realloc(NULL, words * sizeof(uint64_t));
+
+        /* open addressing over state sets, TP_ROUTER_NIL marks a free slot */
+        size_t table_cap = 64;
+        uint32_t *table = (uint32_t *)tp_realloc(NULL, table_cap * sizeof(uint32_t));
+        if (!TP_GREW(scratch) || !TP_GREW(table))
+        {
+            tp_free(scratch);
+            tp_free(table);
+            tp_da_free(positions);
+            return -1;
+        }
+        memset(table, 0xff, table_cap * sizeof(uint32_t));
+
+        /* start state: position 0 of every pattern */
+        memset(scratch, 0, words * sizeof(uint64_t));
+        for (size_t k = 0; k < positions.count; ++k)
+        {
+            if (k == 0 || positions.items[k - 1].kind == TP_PATTERN_ACCEPT)
+            {
+                scratch[k >> 6] |= 1ull << (k & 63);
+            }
+        }
+        tp_pattern_closure(&positions, scratch);
+        tp_da_append_many(&sets, scratch, words);
+        table[tp_pattern_set_hash(scratch, words) & (table_cap - 1)] = 0;
+
+        int result = sets.count == words ? 0 : -1;
+        for (size_t state = 0; state * words < sets.count; ++state)
+        {
+            for (uint32_t cls = 0; cls < dfa->class_count; ++cls)
+            {
+                uint8_t c = representative[cls];
+                const uint64_t *from = &sets.items[state * words];
+                memset(scratch, 0, words * sizeof(uint64_t));
+                int empty = 1;
+                for (size_t k = 0; k < positions.count; ++k)
+                {
+                    if (!((from[k >> 6] >> (k & 63)) & 1) || !TP_SET_HAS(positions.items[k].set, c))
+                    {
+                        continue;
+                    }
+                    size_t to = (positions.items[k].kind == TP_PATTERN_STAR) ? k : k + 1;
+                    if (positions.items[k].kind != TP_PATTERN_ACCEPT)
+                    {
+                        scratch[to >> 6] |= 1ull << (to & 63);
+                        empty = 0;
+                    }
+                }
+
+                uint32_t target = TP_ROUTER_NIL;
+                if (!empty)
+                {
+                    tp_pattern_closure(&positions, scratch);
+                    size_t slot = tp_pattern_set_hash(scratch, words) & (table_cap - 1);
+                    while (table[slot] != TP_ROUTER_NIL &&
+                           memcmp(&sets.items[table[slot] * words], scratch, words * sizeof(uint64_t)) != 0)
+                    {
+                        slot = (slot + 1) & (table_cap - 1);
+                    }
+
+                    if (table[slot] == TP_ROUTER_NIL)
+                    {
+                        size_t state_count = sets.count / words;
+                        if (state_count >= TP_ROUTER_MAX_DFA_STATES)
+                        {
+                            fprintf(stderr, "stb_teapot: pattern routes need more than %d DFA states\n",
+                                    TP_ROUTER_MAX_DFA_STATES);
+                            result = -1;
+                            break;
+                        }
+                        tp_da_append_many(&sets, scratch, words);
+                        if (sets.count != (state_count + 1) * words)
+                        {
+                            result = -1;
+                            break;
+                        }
+                        table[slot] = (uint32_t)state_count;
+
+                        if ((state_count + 1) * 2 > table_cap)
+                        {
+                            uint32_t *bigger = (uint32_t *)tp_realloc(table, table_cap * 2 * sizeof(uint32_t));
+                            if (!TP_GREW(bigger))
+                            {
+                                result = -1;
+                                break;
+                            }
+                            table = bigger;
+                            table_cap *= 2;
+                            memset(table, 0xff, table_cap * sizeof(uint32_t));
+                            for (uint32_t s = 0; s <= state_count; ++s)
+                            {
+                                size_t h = tp_pattern_set_hash(&sets.items[s * words], words) & (table_cap - 1);
+                                while (table[h] != TP_ROUTER_NIL)
+                                {
+                                    h = (h + 1) & (table_cap - 1);
+                                }
+                                table[h] = s;
+                            }
+                        }
+                        target = (uint32_t)state_count;
+                    }
+                    else
+                    {
+                        target = table[slot];
+                    }
+                }
+                tp_da_append(&dfa->next, target);
+            }
+            if (result < 0)
+            {
+                break;
+            }
+
+            /* accepting positions are in route order, so the first one per method wins */
+            const uint64_t *set = &sets.items[state * words];
+            uint32_t accept = TP_ROUTER_NIL;
+            for (size_t k = 0; k < positions.count; ++k)
+            {
+                const tp_pattern_pos *pos = &positions.items[k];
+                if (pos->kind != TP_PATTERN_ACCEPT || !((set[k >> 6] >> (k & 63)) & 1))
+                {
+                    continue;
+                }
+                if (accept == TP_ROUTER_NIL)
+                {
+                    if (tp_router_reserve_nodes(router, 1) < 0)
+                    {
+                        result = -1;
+                        break;
+                    }
+                    accept = tp_router_new_node(router, TP_ROUTER_NODE_PATTERN, "", 0);
+                }
+                tp_router_node *node = &router->nodes.items[accept];
+                if (node->handlers[pos->method] == NULL)
+                {
+                    node->handlers[pos->method] = pos->handler;
+                    node->methods |= TEAPOT_METHOD_BIT(pos->method);
+                }
+            }
+            if (result < 0)
+            {
+                break;
+            }
+            tp_da_append(&dfa->accept, accept);
+        }
+
+        tp_free(table);
+        tp_free(scratch);
+        tp_da_free(sets);
+        tp_da_free(positions);
+        return result;
+    }
+
+    /* Run the pattern DFA over the whole path */
+    static tp_router_hit tp_router_match_patterns(const teapot_router *router, uint32_t method_bit,
+                                                  const char *s, size_t len, tp_router_hit *path_match)
+    {
+        tp_router_hit found = {0};
+        const tp_router_dfa *dfa = &router->patterns;
+        if (dfa->accept.count == 0)
+        {
+            return found;
+        }
+
+        uint32_t state = 0;
+        for (size_t i = 0; i < len && state != TP_ROUTER_NIL; ++i)
+        {
+            state = dfa->next.items[state * dfa->class_count + dfa->byte_class[(unsigned char)s[i]]];
+        }
+        if (state == TP_ROUTER_NIL || dfa->accept.items[state] == TP_ROUTER_NIL)
+        {
+            return found;
+        }
+
+        const tp_router_node *node = &router->nodes.items[dfa->accept.items[state]];
+        if (node->methods & method_bit)
+        {
+            found.router = router;
+            found.node = node;
+        }
+        else if (path_match->node == NULL)
+        {
+            path_match->router = router;
+            path_match->node = node;
+        }
+        return found;
+    }
+
+    int teapot_router_build(teapot_router *router, const teapot_route *routes, size_t route_count)
+    {
+        if (router == NULL || (routes == NULL && route_count > 0))
+        {
+            return -1;
+        }
+
+        teapot_router_free(router);
+        size_t failures = tp_out_of_memory_count();
+        if (tp_router_reserve_nodes(router, 1) < 0)
+        {
+            return -1;
+        }
+        tp_router_new_node(router, TP_ROUTER_NODE_STATIC, "", 0);
+
+        for (size_t i = 0; i < route_count; ++i)
+        {
+            if (routes[i].path != NULL && routes[i].path[0] == '~')
+            {
+                continue;
+            }
+            if (tp_router_insert(router, &routes[i]) < 0)
+            {
+                fprintf(stderr, "stb_teapot: invalid route '%s'\n", routes[i].path ? routes[i].path : "(null)");
+                teapot_router_free(router);
+                return -1;
+            }
+        }
+
+        if (tp_router_compile_patterns(router, routes, route_count) < 0)
+        {
+            teapot_router_free(router);
+            return -1;
+        }
+
+        tp_router_add_implicit_head(router);
+        tp_router_build_allow_lines(router);
+        if (tp_out_of_memory_count() != failures)
+        {
+            teapot_router_free(router);
+            return -1;
+        }
+        return 0;
+    }
+
+    void teapot_router_free(teapot_router *router)
+    {
+        if (router == NULL)
+        {
+            return;
+        }
+        tp_da_free(router->nodes);
+        router->nodes.items = NULL;
+        router->nodes.count = 0;
+        router->nodes.capacity = 0;
+        tp_sb_free(router->allow_lines);
+        router->allow_lines.items = NULL;
+        router->allow_lines.count = 0;
+        tp_da_free(router->patterns.next);
+        tp_da_free(router->patterns.accept);
+        memset(&router->patterns, 0, sizeof(router->patterns));
+        router->allow_lines.capacity = 0;
+    }
+
+    int teapot_router_mount(teapot_router *parent, const char *prefix, const teapot_router *child)
+    {
+        if (parent == NULL || child == NULL || child == parent || prefix == NULL || prefix[0] != '/')
+        {
+            return -1;
+        }
+
+        size_t len = strlen(prefix);
+        while (len > 0 && prefix[len - 1] == '/')
+        {
+            --len;
+        }
+
+        for (size_t i = 1; i < len; ++i)
+        {
+            if (prefix[i - 1] == '/' && (prefix[i] == ':' || prefix[i] == '*'))
+            {
+                return -1; /* mount prefixes are static */
+            }
+        }
+
+        if (parent->nodes.count == 0)
+        {
+            if (tp_router_reserve_nodes(parent, 1) < 0)
+            {
+                return -1;
+            }
+            tp_router_new_node(parent, TP_ROUTER_NODE_STATIC, "", 0);
+        }
+
+        uint32_t node = tp_router_insert_static(parent, 0, prefix, len);
+        if (node == TP_ROUTER_NIL || parent->nodes.items[node].mount != NULL)
+        {
+            return -1;
+        }
+        parent->nodes.items[node].mount = child;
+        return 0;
+    }
+
+    /* Match the rest of the path below 'node'. Backtracks from sub-router to static to ':param'
+       to '*' children. The first node matching the path but not the method is remembered in
+       '*path_match'. */
+    static tp_router_hit tp_router_lookup(const teapot_router *router, uint32_t node, uint32_t method_bit,
+                                          const char *s, size_t len, tp_route_param *params, size_t *param_count,
+                                          tp_router_hit *path_match)
+    {
+        const tp_router_node *nodes = router->nodes.items;
+        const tp_router_node *n = &nodes[node];
+        tp_router_hit found = {0};
+
+        if (n->mount != NULL && n->mount->nodes.count > 0 && (len == 0 || s[0] == '/'))
+        {
+            /* the mount prefix itself is the sub-router's "/" */
+            const char *rest = (len == 0) ? "/" : s;
+            size_t rest_len = (len == 0) ? 1 : len;
+            size_t saved = *param_count;
+            found = tp_router_lookup(n->mount, 0, method_bit, rest, rest_len, params, param_count, path_match);
+            if (found.node == NULL)
+            {
+                *param_count = saved;
+                found = tp_router_match_patterns(n->mount, method_bit, rest, rest_len, path_match);
+            }
+            if (found.node != NULL)
+            {
+                return found;
+            }
+        }
+
+        if (len == 0 && n->methods != 0)
+        {
+            if (n->methods & method_bit)
+            {
+                found.router = router;
+                found.node = n;
+                return found;
+            }
+            if (path_match->node == NULL)
+            {
+                path_match->router = router;
+                path_match->node = n;
+            }
+        }
+
+        if (len > 0)
+        {
+            for (uint32_t child = n->first_child; child != TP_ROUTER_NIL; child = nodes[child].next_sibling)
+            {
+                tp_str_view label = nodes[child].label;
+                if (label.items[0] != s[0])
+                {
+                    continue;
+                }
+
+                /* siblings never share a first byte, so there is nothing else to try on mismatch */
+                if (label.count <= len && memcmp(label.items, s, label.count) == 0)
+                {
+                    found = tp_router_lookup(router, child, method_bit, s + label.count, len - label.count,
+                                             params, param_count, path_match);
+                    if (found.node != NULL)
+                    {
+                        return found;
+                    }
+                }
+                break;
+            }
+
+            /* captures of a mounted sub-router share the parent's parameter slots */
+            if (n->param_child != TP_ROUTER_NIL && *param_count < TP_MAX_ROUTE_PARAMS)
+            {
+                const char *slash = (const char *)memchr(s, '/', len);
+                size_t seg_len = slash ? (size_t)(slash - s) : len;
+                if (seg_len > 0)
+                {
+                    size_t saved = *param_count;
+                    params[saved].name = nodes[n->param_child].label;
+                    params[saved].value.items = s;
+                    params[saved].value.count = seg_len;
+                    *param_count = saved + 1;
+
+                    found = tp_router_lookup(router, n->param_child, method_bit, s + seg_len, len - seg_len,
+                                             params, param_count, path_match);
+                    if (found.node != NULL)
+                    {
+                        return found;
+                    }
+                    *param_count = saved;
+                }
+            }
+        }
+
+        if (n->catchall_child != TP_ROUTER_NIL && *param_count < TP_MAX_ROUTE_PARAMS)
+        {
+            const tp_router_node *catchall = &nodes[n->catchall_child];
+            if (catchall->methods & method_bit)
+            {
+                params[*param_count].name = catchall->label;
+                params[*param_count].value.items = s;
+                params[*param_count].value.count = len;
+                ++*param_count;
+                found.router = router;
+                found.node = catchall;
+                return found;
+            }
+            if (path_match->node == NULL)
+            {
+                path_match->router = router;
+                path_match->node = catchall;
+            }
+        }
+
+        return found;
+    }
+
+    teapot_route_match teapot_router_resolve(const teapot_router *router, teapot_method method,
+                                             const char *path, size_t path_len,
+                                             tp_route_param *params, size_t *param_count)
+    {
+        teapot_route_match match = {0};
+
+        tp_route_param scratch[TP_MAX_ROUTE_PARAMS];
+        size_t scratch_count = 0;
+        tp_route_param *out = params ? params : scratch;
+        size_t *out_count = param_count ? param_count : &scratch_count;
+        *out_count = 0;
+
+        if (router == NULL || router->nodes.count == 0 || path == NULL || method >= TEAPOT_UNKNOWN)
+        {
+            return match;
+        }
+
+        tp_router_hit path_match = {0};
+        tp_router_hit hit = tp_router_lookup(router, 0, TEAPOT_METHOD_BIT(method), path, path_len, out, out_count, &path_match);
+        if (hit.node == NULL)
+        {
+            *out_count = 0;
+            hit = tp_router_match_patterns(router, TEAPOT_METHOD_BIT(method), path, path_len, &path_match);
+        }
+        if (hit.node == NULL)
+        {
+            *out_count = 0;
+            hit = path_match;
+        }
+        else
+        {
+            match.handler = hit.node->handlers[method];
+        }
+
+        if (hit.node != NULL)
+        {
+            match.allowed = hit.node->methods | TEAPOT_METHOD_BIT(TEAPOT_OPTIONS);
+            match.allow.items = hit.router->allow_lines.items + hit.node->allow_offset;
+            match.allow.count = hit.node->allow_len;
+        }
+        return match;
+    }
+
+    teapot_handler teapot_router_match(const teapot_router *router, teapot_method method,
+                                       const char *path, size_t path_len,
+                                       tp_route_param *params, size_t *param_count)
+    {
+        return teapot_router_resolve(router, method, path, path_len, params, param_count).handler;
+    }
+
+    tp_str_view teapot_request_param(const teapot_request *req, const char *name)
+    {
+        tp_str_view empty = {0};
+        if (req == NULL || name == NULL)
+        {
+            return empty;
+        }
+
+        size_t name_len = strlen(name);
+        for (size_t i = 0; i < req->param_count; ++i)
+        {
+            const tp_route_param *p = &req->params[i];
+            if (p->name.count == name_len && memcmp(p->name.items, name, name_len) == 0)
+            {
+                return p->value;
+            }
+        }
+        return empty;
+    }
+
+    const char *teapot_method_str(teapot_method method)
+    {
+        switch (method)
+        {
+        case TEAPOT_GET:
+            return "GET";
+        case TEAPOT_POST:
+            return "POST";
+        case TEAPOT_PUT:
+            return "PUT";
+        case TEAPOT_DELETE:
+            return "DELETE";
+        case TEAPOT_PATCH:
+            return "PATCH";
+        case TEAPOT_HEAD:
+            return "HEAD";
+        case TEAPOT_OPTIONS:
+            return "OPTIONS";
+        default:
+            return NULL;
+        }
+    }
+
+    // -----------------------------------------------------
+    // #️⃣ Generated Static Route Tables
+    // -----------------------------------------------------
+    static uint32_t tp_fnv1a(uint32_t h, const char *s, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            h ^= (unsigned char)s[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    uint32_t tp_route_hash(uint32_t seed, teapot_method method, const char *path, size_t path_len)
+    {
+        const char *name = teapot_method_str(method);
+        uint32_t h = 2166136261u ^ seed;
+        h = tp_fnv1a(h, name ? name : "", name ? strlen(name) : 0);
+        h = tp_fnv1a(h, " ", 1);
+        h = tp_fnv1a(h, path, path_len);
+
+        /* final avalanche so that the low bits used by '%' depend on every input byte */
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    teapot_handler teapot_static_routes_find(const teapot_static_routes *table, teapot_method method,
+                                             const char *path, size_t path_len)
+    {
+        if (table == NULL || table->count == 0 || path == NULL)
+        {
+            return NULL;
+        }
+
+        uint32_t bucket = tp_route_hash(0, method, path, path_len) % (uint32_t)table->count;
+        int32_t d = table->displacements[bucket];
+        uint32_t slot = (d < 0) ? (uint32_t)(-d - 1)
+                                : tp_route_hash((uint32_t)d, method, path, path_len) % (uint32_t)table->count;
+
+        const teapot_static_route *e = &table->entries[slot];
+        if (e->method != method || e->path_len != path_len || memcmp(e->path, path, path_len) != 0)
+        {
+            return NULL;
+        }
+        return e->handler;
+    }
+
+    // -----------------------------------------------------
+    // ↪️ Rewrites and Redirects
+    // -----------------------------------------------------
+    /* Returns -1 if 'per_node' can't grow to 'count' entries */
+    static int tp_rewriter_grow(tp_router_u32s *per_node, size_t count)
+    {
+        tp_da_reserve(per_node, count);
+        if (!tp_da_has_room(per_node, count))
+        {
+            return -1;
+        }
+        while (per_node->count < count)
+        {
+            per_node->items[per_node->count++] = TP_ROUTER_NIL;
+        }
+        return 0;
+    }
+
+    int teapot_rewriter_build(teapot_rewriter *rw, const teapot_rewrite_rule *rules, size_t rule_count)
+    {
+        if (rw == NULL || (rules == NULL && rule_count > 0))
+        {
+            return -1;
+        }
+
+        teapot_rewriter_free(rw);
+        if (rule_count == 0)
+        {
+            return 0;
+        }
+        size_t failures = tp_out_of_memory_count();
+        if (tp_router_reserve_nodes(&rw->trie, 1) < 0)
+        {
+            return -1;
+        }
+        tp_router_new_node(&rw->trie, TP_ROUTER_NODE_STATIC, "", 0);
+
+        for (size_t i = 0; i < rule_count; ++i)
+        {
+            const teapot_rewrite_rule *r = &rules[i];
+            size_t from_len = r->from ? strlen(r->from) : 0;
+            size_t to_len = r->to ? strlen(r->to) : 0;
+            int is_prefix = (from_len > 0 && r->from[from_len - 1] == '*');
+            int append_rest = (to_len > 0 && r->to[to_len - 1] == '*');
+            int status_ok = r->status == 0 || r->status == 301 || r->status == 302 || r->status == 307 || r->status == 308;
+
+            if (from_len == 0 || r->from[0] != '/' || to_len == 0 || !status_ok ||
+                memchr(r->from, '*', from_len - (size_t)is_prefix) != NULL ||
+                memchr(r->to, '*', to_len - (size_t)append_rest) != NULL ||
+                (append_rest && !is_prefix) || (r->status == 0 && r->to[0] != '/'))
+            {
+                fprintf(stderr, "stb_teapot: invalid rewrite rule '%s'\n", r->from ? r->from : "(null)");
+                teapot_rewriter_free(rw);
+                return -1;
+            }
+
+            tp_rewrite_entry entry = {0};
+            entry.status = r->status;
+            entry.append_rest = (uint8_t)append_rest;
+            entry.to_offset = (uint32_t)rw->text.count;
+            if (r->status != 0)
+            {
+                tp_sb_append_cstr(&rw->text, "Location: ");
+            }
+            tp_sb_append_buf(&rw->text, r->to, to_len - (size_t)append_rest);
+            entry.to_len = (uint32_t)(rw->text.count - entry.to_offset);
+
+            uint32_t node = tp_router_insert_static(&rw->trie, 0, r->from, from_len - (size_t)is_prefix);
+            if (node == TP_ROUTER_NIL || tp_rewriter_grow(&rw->exact, rw->trie.nodes.count) < 0 ||
+                tp_rewriter_grow(&rw->prefix, rw->trie.nodes.count) < 0)
+            {
+                teapot_rewriter_free(rw);
+                return -1;
+            }
+            tp_router_u32s *slots = is_prefix ? &rw->prefix : &rw->exact;
+            if (slots->items[node] == TP_ROUTER_NIL)
+            {
+                slots->items[node] = (uint32_t)rw->entries.count;
+            }
+            tp_da_append(&rw->entries, entry);
+        }
+        if (tp_out_of_memory_count() != failures)
+        {
+            teapot_rewriter_free(rw);
+            return -1;
+        }
+        return 0;
+    }
+
+    void teapot_rewriter_free(teapot_rewriter *rw)
+    {
+        if (rw == NULL)
+        {
+            return;
+        }
+        teapot_router_free(&rw->trie);
+        tp_da_free(rw->exact);
+        tp_da_free(rw->prefix);
+        tp_da_free(rw->entries);
+        tp_sb_free(rw->text);
+        memset(rw, 0, sizeof(*rw));
+    }
+
+    int teapot_rewrite(const teapot_rewriter *rw, teapot_request *req, teapot_response *resp)
+    {
+        if (rw == NULL || rw->entries.count == 0 || req == NULL || req->path.items == NULL)
+        {
+            return 0;
+        }
+
+        const char *path = req->path.items;
+        size_t full_len = strlen(path);
+        const char *query = (const char *)memchr(path, '?', full_len);
+        size_t len = query ? (size_t)(query - path) : full_len;
+
+        /* walk the trie once, remembering the deepest prefix rule on the way */
+        const tp_router_node *nodes = rw->trie.nodes.items;
+        uint32_t node = 0;
+        size_t i = 0;
+        uint32_t hit = TP_ROUTER_NIL;
+        size_t matched = 0;
+        for (;;)
+        {
+            if (rw->prefix.items[node] != TP_ROUTER_NIL)
+            {
+                hit = rw->prefix.items[node];
+                matched = i;
+            }
+            if (i == len)
+            {
+                if (rw->exact.items[node] != TP_ROUTER_NIL)
+                {
+                    hit = rw->exact.items[node];
+                    matched = i;
+                }
+                break;
+            }
+
+            uint32_t child = nodes[node].first_child;
+            while (child != TP_ROUTER_NIL && nodes[child].label.items[0] != path[i])
+            {
+                child = nodes[child].next_sibling;
+            }
+            if (child == TP_ROUTER_NIL || nodes[child].label.count > len - i ||
+                memcmp(nodes[child].label.items, path + i, nodes[child].label.count) != 0)
+            {
+                break;
+            }
+            i += nodes[child].label.count;
+            node = child;
+        }
+
+        if (hit == TP_ROUTER_NIL)
+        {
+            return 0;
+        }
+
+        const tp_rewrite_entry *e = &rw->entries.items[hit];
+        const char *to = rw->text.items + e->to_offset;
+
+        /* the part after 'to' that is kept: the rest matched by '*' and/or the query string */
+        size_t keep_from = e->append_rest ? matched : len;
+
+        if (e->status != 0)
+        {
+            resp->status = e->status;
+            tp_sb_append_buf(&resp->headers, to, e->to_len);
+            tp_sb_append_buf(&resp->headers, path + keep_from, full_len - keep_from);
+            tp_sb_append_buf(&resp->headers, "\r\n", 2);
+            return 1;
+        }
+
+        /* in place: shift the kept tail (and its NUL) behind the new prefix */
+        size_t tail = full_len - keep_from + 1;
+        tp_da_reserve(&req->path, e->to_len + tail);
+        if (!tp_da_has_room(&req->path, e->to_len + tail))
+        {
+            return 0; /* out of memory: left as it was, and answered with 503 */
+        }
+        memmove(req->path.items + e->to_len, req->path.items + keep_from, tail);
+        memcpy(req->path.items, to, e->to_len);
+        req->path.count = e->to_len + tail;
+        return 0;
+    }
+
+    // -----------------------------------------------------
+    // 🏠 Virtual Hosts
+    // -----------------------------------------------------
+    // Host names compare without case, port and trailing dot: "API.example.com.:8080" is
+    // "api.example.com". IPv6 literals keep their brackets.
+    static tp_str_view tp_host_normalize(const char *s, size_t len)
+    {
+        tp_str_view host = {s, len};
+        const char *end = (len > 0 && s[0] == '[') ? (const char *)memchr(s, ']', len)
+                                                   : (const char *)memchr(s, ':', len);
+        if (end != NULL)
+        {
+            host.count = (size_t)(end - s) + (s[0] == '[');
+        }
+        if (host.count > 0 && host.items[host.count - 1] == '.')
+        {
+            --host.count;
+        }
+        return host;
+    }
+
+    static uint32_t tp_host_hash(tp_str_view host, int wildcard)
+    {
+        return tp_name_hash(host.items, host.count, wildcard ? 0x2au : 0u);
+    }
+
+    /* Key of a configured host: "*.example.com" is the wildcard key "example.com" */
+    static tp_str_view tp_vhost_key(const teapot_vhost *vhost, int *wildcard)
+    {
+        const char *name = vhost->host;
+        *wildcard = (name[0] == '*' && name[1] == '.');
+        return tp_host_normalize(name + (*wildcard ? 2 : 0), strlen(name) - (*wildcard ? 2u : 0u));
+    }
+
+    static uint32_t tp_vhost_index_find(const teapot_server *server, tp_str_view host, int wildcard, uint32_t hash)
+    {
+        const tp_vhost_index *index = &server->vhost_index;
+        for (size_t i = hash & index->mask;; i = (i + 1) & index->mask)
+        {
+            const tp_vhost_slot *slot = &index->slots[i];
+            if (slot->vhost == TP_ROUTER_NIL)
+            {
+                return TP_ROUTER_NIL;
+            }
+            if (slot->hash != hash)
+            {
+                continue;
+            }
+
+            int key_wildcard;
+            tp_str_view key = tp_vhost_key(&server->vhosts[slot->vhost], &key_wildcard);
+            if (key_wildcard == wildcard && key.count == host.count)
+            {
+                size_t n = 0;
+                while (n < key.count && TP_TOLOWER(key.items[n]) == TP_TOLOWER(host.items[n]))
+                {
+                    ++n;
+                }
+                if (n == key.count)
+                {
+                    return slot->vhost;
+                }
+            }
+        }
+    }
+
+    /* Build every virtual host's router and the hash index over their names */
+    static int tp_vhost_index_build(teapot_server *server)
+    {
+        tp_vhost_index *index = &server->vhost_index;
+        tp_free(index->slots);
+        index->slots = NULL;
+        index->default_vhost = TP_ROUTER_NIL;
+        if (server->vhost_count == 0)
+        {
+            return 0;
+        }
+
+        size_t slot_count = 8;
+        while (slot_count < server->vhost_count * 2)
+        {
+            slot_count *= 2;
+        }
+        index->slots = (tp_vhost_slot *)tp_realloc(NULL, slot_count * sizeof(tp_vhost_slot));
+        if (!TP_GREW(index->slots))
+        {
+            return -1;
+        }
+        memset(index->slots, 0xff, slot_count * sizeof(tp_vhost_slot));
+        index->mask = slot_count - 1;
+
+        for (size_t i = 0; i < server->vhost_count; ++i)
+        {
+            teapot_vhost *vhost = &server->vhosts[i];
+            if (vhost->host == NULL || vhost->host[0] == '\0' ||
+                teapot_router_build(&vhost->router, vhost->routes, vhost->route_count) < 0)
+            {
+                fprintf(stderr, "stb_teapot: invalid virtual host '%s'\n", vhost->host ? vhost->host : "(null)");
+                return -1;
+            }
+
+            if (strcmp(vhost->host, "*") == 0)
+            {
+                if (index->default_vhost != TP_ROUTER_NIL)
+                {
+                    fprintf(stderr, "stb_teapot: duplicate default virtual host\n");
+                    return -1;
+                }
+                index->default_vhost = (uint32_t)i;
+                continue;
+            }
+
+            int wildcard;
+            tp_str_view key = tp_vhost_key(vhost, &wildcard);
+            uint32_t hash = tp_host_hash(key, wildcard);
+            if (tp_vhost_index_find(server, key, wildcard, hash) != TP_ROUTER_NIL)
+            {
+                fprintf(stderr, "stb_teapot: duplicate virtual host '%s'\n", vhost->host);
+                return -1;
+            }
+
+            size_t s = hash & index->mask;
+            while (index->slots[s].vhost != TP_ROUTER_NIL)
+            {
+                s = (s + 1) & index->mask;
+            }
+            index->slots[s].hash = hash;
+            index->slots[s].vhost = (uint32_t)i;
+        }
+        return 0;
+    }
+
+    /* Router of the virtual host serving 'req', or NULL if the server-wide router applies.
+       Costs one hash probe, plus one per label for wildcard hosts, whatever the host count. */
+    static const teapot_router *tp_vhost_router(const teapot_server *server, const teapot_request *req)
+    {
+        if (server->vhost_count == 0 || server->vhost_index.slots == NULL)
+        {
+            return NULL;
+        }
+
+        uint32_t found = TP_ROUTER_NIL;
+        const tp_string_builder *value = tp_headers_known(&req->headers, TP_HEADER_HOST);
+        if (value != NULL && value->items != NULL)
+        {
+            tp_str_view host = tp_host_normalize(value->items, strlen(value->items));
+            found = tp_vhost_index_find(server, host, 0, tp_host_hash(host, 0));
+
+            /* "a.b.example.com" tries "*.b.example.com", then "*.example.com", then "*.com" */
+            for (size_t i = 0; found == TP_ROUTER_NIL && i < host.count; ++i)
+            {
+                if (host.items[i] == '.')
+                {
+                    tp_str_view suffix = {host.items + i + 1, host.count - i - 1};
+                    found = tp_vhost_index_find(server, suffix, 1, tp_host_hash(suffix, 1));
+                }
+            }
+        }
+
+        if (found == TP_ROUTER_NIL)
+        {
+            found = server->vhost_index.default_vhost;
+        }
+        return (found == TP_ROUTER_NIL) ? NULL : &server->vhosts[found].router;
+    }
+
+    static int tp_server_build(teapot_server *server)
+    {
+        if (teapot_router_build(&server->router, server->routes, server->route_count) < 0)
+        {
+            return -1;
+        }
+
+        for (size_t i = 0; i < server->mount_count; ++i)
+        {
+            const teapot_mount *m = &server->mounts[i];
+            if (teapot_router_mount(&server->router, m->prefix, m->router) < 0)
+            {
+                fprintf(stderr, "stb_teapot: invalid mount '%s'\n", m->prefix ? m->prefix : "(null)");
+                teapot_router_free(&server->router);
+                return -1;
+            }
+        }
+
+        if (tp_vhost_index_build(server) < 0 ||
+            teapot_rewriter_build(&server->rewriter, server->rewrites, server->rewrite_count) < 0)
+        {
+            teapot_server_free(server);
+            return -1;
+        }
+        return 0;
+    }
+
+    int teapot_server_build(teapot_server *server)
+    {
+        if (server == NULL)
+        {
+            return -1;
+        }
+        if (server->allocator == NULL && server->region != NULL)
+        {
+            server->allocator = &server->region->allocator;
+        }
+#ifdef TP_NO_HEAP
+        if (server->allocator == NULL)
+        {
+            fprintf(stderr, "stb_teapot: TP_NO_HEAP needs a teapot_server::region\n");
+            return -1;
+        }
+#endif
+        const tp_allocator *previous = tp_allocator_use(server->allocator);
+        size_t failures = tp_out_of_memory_count();
+        int result = tp_server_build(server);
+        if (result == 0 && tp_out_of_memory_count() != failures)
+        {
+            teapot_server_free(server); /* some table came out short */
+            result = -1;
+        }
+        tp_allocator_use(previous);
+        return result;
+    }
+
+    void teapot_server_free(teapot_server *server)
+    {
+        if (server == NULL)
+        {
+            return;
+        }
+        const tp_allocator *previous = tp_allocator_use(server->allocator);
+        teapot_router_free(&server->router);
+        for (size_t i = 0; i < server->vhost_count; ++i)
+        {
+            teapot_router_free(&server->vhosts[i].router);
+        }
+        teapot_rewriter_free(&server->rewriter);
+        tp_free(server->vhost_index.slots);
+        memset(&server->vhost_index, 0, sizeof(server->vhost_index));
+        tp_allocator_use(previous);
+    }
+
+    // -----------------------------------------------------
+    // 🧭 Find Matching Route
+    // -----------------------------------------------------
+    // Length of the request path without the query string
+    static size_t tp_request_path_len(const teapot_request *req)
+    {
+        if (req->path.items == NULL)
+        {
+            return 0;
+        }
+
+        size_t len = strlen(req->path.items);
+        const char *query = (const char *)memchr(req->path.items, '?', len);
+        return query ? (size_t)(query - req->path.items) : len;
+    }
+
+    // Linear scan over the route array, used when the server's router has not been built
+    static teapot_handler teapot_find_handler_linear(const teapot_server *server, const teapot_request *req)
+    {
+        teapot_handler head_fallback = NULL;
+        for (size_t i = 0; i < server->route_count; i++)
+        {
+            const teapot_route *r = &server->routes[i];
+            if (strcmp(r->path, req->path.items) != 0)
+            {
+                continue;
+            }
+            if (r->method == req->method)
+            {
+                return r->handler;
+            }
+            if (req->method == TEAPOT_HEAD && r->method == TEAPOT_GET && head_fallback == NULL)
+            {
+                head_fallback = r->handler;
+            }
+        }
+        return head_fallback;
+    }
+
+    static teapot_route_match teapot_find_route(teapot_server *server, teapot_request *req)
+    {
+        teapot_route_match match = {0};
+
+        /* the static table belongs to the server-wide routes: a named virtual host never sees it */
+        const teapot_router *router = tp_vhost_router(server, req);
+        uint32_t default_vhost = server->vhost_index.default_vhost;
+        int server_wide = router == NULL || (default_vhost != TP_ROUTER_NIL && router == &server->vhosts[default_vhost].router);
+
+        if (server->static_routes != NULL && server_wide)
+        {
+            match.handler = teapot_static_routes_find(server->static_routes, req->method,
+                                                      req->path.items, tp_request_path_len(req));
+            if (match.handler == NULL && req->method == TEAPOT_HEAD)
+            {
+                match.handler = teapot_static_routes_find(server->static_routes, TEAPOT_GET,
+                                                          req->path.items, tp_request_path_len(req));
+            }
+            if (match.handler != NULL)
+            {
+                return match;
+            }
+        }
+
+        if (router == NULL && server->router.nodes.count == 0)
+        {
+            match.handler = teapot_find_handler_linear(server, req);
+            return match;
+        }
+
+        return teapot_router_resolve(router ? router : &server->router, req->method, req->path.items, tp_request_path_len(req),
+                                     req->params, &req->param_count);
+    }
+
+    // -----------------------------------------------------
+    // ♻️ Response Buffers
+    // -----------------------------------------------------
+    static TP_THREAD_LOCAL tp_response_buffers *tp_current_response_buffers;
+
+    // Installs the buffers teapot_response_init() draws from on this thread and returns the
+    // previous ones
+    static tp_response_buffers *tp_response_buffers_use(tp_response_buffers *buffers)
+    {
+        tp_response_buffers *previous = tp_current_response_buffers;
+        tp_current_response_buffers = buffers;
+        return previous;
+    }
+
+    void tp_response_buffers_take(teapot_response *res)
+    {
+        memset(&res->headers, 0, sizeof(res->headers));
+        memset(&res->body, 0, sizeof(res->body));
+        tp_response_buffers *buffers = tp_current_response_buffers;
+        if (buffers != NULL)
+        {
+            res->headers = buffers->headers;
+            res->body = buffers->body;
+            memset(buffers, 0, sizeof(*buffers));
+        }
+    }
+
+    static void tp_response_buffer_recycle(tp_string_builder *slot, tp_string_builder *sb)
+    {
+        if (sb->capacity == 0)
+        {
+            return; /* empty or borrowed: nothing worth keeping */
+        }
+        if (slot->capacity != 0)
+        {
+            /* the response was not built from these buffers (e.g. no teapot_response_init) */
+            tp_sb_free(*sb);
+        }
+        else
+        {
+            if (sb->capacity > TP_RESPONSE_BUFFER_HIGH_WATER)
+            {
+                char *smaller = (char *)tp_realloc(sb->items, TP_RESPONSE_BUFFER_SHRINK_TO);
+                if (!TP_GREW(smaller))
+                {
+                    tp_sb_free(*sb); /* not worth keeping at that size */
+                    memset(sb, 0, sizeof(*sb));
+                    return;
+                }
+                sb->items = smaller;
+                sb->capacity = TP_RESPONSE_BUFFER_SHRINK_TO;
+            }
+            sb->count = 0;
+            *slot = *sb;
+        }
+        memset(sb, 0, sizeof(*sb));
+    }
+
+    void tp_response_buffers_recycle(tp_response_buffers *buffers, teapot_response *res)
+    {
+        tp_response_buffer_recycle(&buffers->headers, &res->headers);
+        tp_response_buffer_recycle(&buffers->body, &res->body);
+    }
+
+    // Hands a response that will not be sent back to the current buffers (or frees it)
+    static void tp_response_release(teapot_response *res)
+    {
+        if (tp_current_response_buffers != NULL)
+        {
+            tp_response_buffers_recycle(tp_current_response_buffers, res);
+        }
+        else
+        {
+            teapot_response_free(res);
+        }
+    }
+
+    void tp_response_buffers_free(tp_response_buffers *buffers)
+    {
+        tp_sb_free(buffers->headers);
+        tp_sb_free(buffers->body);
+        memset(buffers, 0, sizeof(*buffers));
+    }
+
+    // Produce the response for a parsed request: rewrites, dispatch hook, then route tables, then the
+    // automatic OPTIONS / 405 / 404 answers
+    static teapot_response teapot_dispatch(teapot_server *server, teapot_request *req)
+    {
+        teapot_response resp;
+        teapot_response_init(&resp, 200);
+
+        if (teapot_rewrite(&server->rewriter, req, &resp))
+        {
+            return resp;
+        }
+
+        if (server->dispatch != NULL)
+        {
+            /* the hook may overwrite 'resp' with a response of its own: hand it one without the
+               buffers, and take them back if it passes */
+            tp_response_release(&resp);
+            if (server->dispatch(req, &resp))
+            {
+                return resp;
+            }
+            teapot_response_init(&resp, 200);
+        }
+
+        teapot_route_match match = teapot_find_route(server, req);
+        if (match.handler)
+        {
+            /* the handler builds its own response: let it have the buffers */
+            tp_response_release(&resp);
+            return match.handler(req);
+        }
+
+        if (match.allowed != 0)
+        {
+            resp.status = (req->method == TEAPOT_OPTIONS) ? 204 : 405;
+            tp_sb_append_buf(&resp.headers, match.allow.items, match.allow.count);
+            if (resp.status == 405)
+            {
+                tp_sb_append_cstr(&resp.body, "405 Method Not Allowed\n");
+            }
+            return resp;
+        }
+
+        resp.status = 404;
+        tp_sb_append_cstr(&resp.body, "404 Not Found\n");
+        return resp;
+    }
+
+    // -----------------------------------------------------
+    // 🫖 Listen Loop
+    // -----------------------------------------------------
+
+#ifndef TP_LISTEN_BACKLOG
+#define TP_LISTEN_BACKLOG 128
+#endif
+
+    /* 'shard_cpu' -1 for a plain listener. Otherwise the listener shares its port (SO_REUSEPORT):
+       -2 for any connection, a CPU number to prefer those whose packets that CPU processed */
+    static int tp_listener_open(teapot_server *server, int shard_cpu, stb_teapot_socket_t *out_listen_sock)
+    {
+        if (!server || !out_listen_sock)
+            return -1;
+
+        if (server->router.nodes.count == 0 && teapot_server_build(server) < 0)
+        {
+            return -1;
+        }
+
+        teapot_init();
+
+        stb_teapot_socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+        if (!socket_ok(s))
+        {
+            perror("socket");
+            return -1;
+        }
+
+        /* a restarted server can bind while its old connections are in TIME_WAIT */
+        int reuse = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+#ifdef TP_HAS_REUSEPORT
+        if (shard_cpu != -1)
+        {
+            setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (const char *)&reuse, sizeof(reuse));
+#ifdef SO_INCOMING_CPU
+            if (shard_cpu >= 0)
+            {
+                setsockopt(s, SOL_SOCKET, SO_INCOMING_CPU, (const char *)&shard_cpu, sizeof(shard_cpu));
+            }
+#endif
+        }
+#else
+        (void)shard_cpu;
+#endif
+
+        struct sockaddr_in addr = {0};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)server->port);
+        addr.sin_addr.s_addr = INADDR_ANY;
+
+        if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            perror("bind");
+            teapot_close(s);
+            return -1;
+        }
+
+        if (listen(s, TP_LISTEN_BACKLOG) < 0)
+        {
+            perror("listen");
+            teapot_close(s);
+            return -1;
+        }
+
+        *out_listen_sock = (stb_teapot_socket_t)s;
+        return 0;
+    }
+
+    int teapot_listener_open(teapot_server *server, stb_teapot_socket_t *out_listen_sock)
+    {
+        return tp_listener_open(server, -1, out_listen_sock);
+    }
+
+    stb_teapot_socket_t teapot_listener_accept(stb_teapot_socket_t listen_sock)
+    {
+        if (!socket_ok((stb_teapot_socket_t)listen_sock))
+        {
+            return (stb_teapot_socket_t)-1;
+        }
+
+        stb_teapot_socket_t client = accept((stb_teapot_socket_t)listen_sock, NULL, NULL);
+        if (!socket_ok(client))
+        {
+            return (stb_teapot_socket_t)-1;
+        }
+
+        return (stb_teapot_socket_t)client;
+    }
+
+    // -----------------------------------------------------
+    // 🔗 Connection Table
+    // -----------------------------------------------------
+    void tp_mutex_init(tp_mutex *m)
+    {
+#ifdef _WIN32
+        InitializeSRWLock(m);
+#else
+        pthread_mutex_init(m, NULL);
+#endif
+    }
+
+    void tp_mutex_lock(tp_mutex *m)
+    {
+#ifdef _WIN32
+        AcquireSRWLockExclusive(m);
+#else
+        pthread_mutex_lock(m);
+#endif
+    }
+
+    void tp_mutex_unlock(tp_mutex *m)
+    {
+#ifdef _WIN32
+        ReleaseSRWLockExclusive(m);
+#else
+        pthread_mutex_unlock(m);
+#endif
+    }
+
+    void tp_mutex_destroy(tp_mutex *m)
+    {
+#ifdef _WIN32
+        (void)m;
+#else
+        pthread_mutex_destroy(m);
+#endif
+    }
+
+    static teapot_conn *tp_conn_slot_at(const teapot_conn_table *table, uint32_t index)
+    {
+        return &table->slabs[index / TP_CONN_SLAB_SIZE].slots[index % TP_CONN_SLAB_SIZE].conn;
+    }
+
+    static teapot_conn_handle tp_conn_handle_make(uint32_t generation, uint32_t index)
+    {
+        return ((teapot_conn_handle)generation << 32) | (teapot_conn_handle)(index + 1);
+    }
+
+    int teapot_conn_table_init(teapot_conn_table *table, size_t max_conns)
+    {
+        memset(table, 0, sizeof(*table));
+        if (max_conns == 0 || max_conns >= UINT32_MAX)
+        {
+            return -1;
+        }
+
+        table->slab_count = (max_conns + TP_CONN_SLAB_SIZE - 1) / TP_CONN_SLAB_SIZE;
+        table->capacity = table->slab_count * TP_CONN_SLAB_SIZE;
+        table->slabs = (tp_conn_slab *)TP_CACHE_REALLOC(NULL, table->slab_count * sizeof(tp_conn_slab));
+        if (!TP_GREW(table->slabs))
+        {
+            memset(table, 0, sizeof(*table));
+            return -1;
+        }
+
+        for (size_t s = 0; s < table->slab_count; ++s)
+        {
+            void *memory = TP_CACHE_REALLOC(NULL, TP_CONN_SLAB_SIZE * sizeof(tp_conn_slot) + TP_CACHE_LINE - 1);
+            if (!TP_GREW(memory))
+            {
+                while (s-- > 0)
+                {
+                    TP_CACHE_FREE(table->slabs[s].memory);
+                }
+                TP_CACHE_FREE(table->slabs);
+                memset(table, 0, sizeof(*table));
+                return -1;
+            }
+            uintptr_t aligned = ((uintptr_t)memory + TP_CACHE_LINE - 1) & ~(uintptr_t)(TP_CACHE_LINE - 1);
+            table->slabs[s].memory = memory;
+            table->slabs[s].slots = (tp_conn_slot *)aligned;
+            memset(table->slabs[s].slots, 0, TP_CONN_SLAB_SIZE * sizeof(tp_conn_slot));
+        }
+
+        /* chain the free list so that slot 0 is handed out first */
+        for (uint32_t i = (uint32_t)table->capacity; i-- > 0;)
+        {
+            teapot_conn *conn = tp_conn_slot_at(table, i);
+            conn->handle = tp_conn_handle_make(0, i);
+            conn->next_free = table->free_head;
+            table->free_head = i + 1;
+        }
+
+        tp_mutex_init(&table->lock);
+        return 0;
+    }
+
+    void teapot_conn_table_free(teapot_conn_table *table)
+    {
+        if (table->slabs == NULL)
+        {
+            return;
+        }
+        for (size_t s = 0; s < table->slab_count; ++s)
+        {
+            TP_CACHE_FREE(table->slabs[s].memory);
+        }
+        TP_CACHE_FREE(table->slabs);
+        tp_mutex_destroy(&table->lock);
+        memset(table, 0, sizeof(*table));
+    }
+
+    teapot_conn *teapot_conn_acquire(teapot_conn_table *table, teapot_server *server, stb_teapot_socket_t socket)
+    {
+        tp_mutex_lock(&table->lock);
+        if (table->free_head == 0)
+        {
+            tp_mutex_unlock(&table->lock);
+            return NULL;
+        }
+
+        uint32_t index = table->free_head - 1;
+        teapot_conn *conn = tp_conn_slot_at(table, index);
+        table->free_head = conn->next_free;
+        ++table->live;
+
+        uint32_t generation = (uint32_t)(conn->handle >> 32) + 1;
+        conn->handle = tp_conn_handle_make(generation, index);
+        conn->next_free = 0;
+        tp_mutex_unlock(&table->lock);
+
+        conn->socket = socket;
+        conn->server = server;
+        conn->next = NULL;
+        conn->user = NULL;
+        return conn;
+    }
+
+    teapot_conn *teapot_conn_get(teapot_conn_table *table, teapot_conn_handle handle)
+    {
+        uint32_t index = (uint32_t)handle - 1;
+        if ((uint32_t)handle == 0 || index >= table->capacity || ((handle >> 32) & 1) == 0)
+        {
+            return NULL;
+        }
+
+        teapot_conn *conn = tp_conn_slot_at(table, index);
+        tp_mutex_lock(&table->lock);
+        int live = conn->handle == handle;
+        tp_mutex_unlock(&table->lock);
+        return live ? conn : NULL;
+    }
+
+    int teapot_conn_release(teapot_conn_table *table, teapot_conn_handle handle)
+    {
+        uint32_t index = (uint32_t)handle - 1;
+        if ((uint32_t)handle == 0 || index >= table->capacity)
+        {
+            return -1;
+        }
+
+        teapot_conn *conn = tp_conn_slot_at(table, index);
+        tp_mutex_lock(&table->lock);
+        if (conn->handle != handle || ((handle >> 32) & 1) == 0)
+        {
+            tp_mutex_unlock(&table->lock);
+            return -1;
+        }
+
+        /* the even generation invalidates every outstanding handle until the slot is reused */
+        conn->handle = tp_conn_handle_make((uint32_t)(handle >> 32) + 1, index);
+        conn->next_free = table->free_head;
+        table->free_head = index + 1;
+        --table->live;
+        tp_mutex_unlock(&table->lock);
+        return 0;
+    }
+
+    // -----------------------------------------------------
+    // 🧱 Fixed Memory Region
+    // -----------------------------------------------------
+    static size_t tp_region_block_size(uint32_t klass)
+    {
+        return TP_ALLOC_HEADER + ((size_t)TP_REGION_MIN << klass);
+    }
+
+    /* Smallest class holding 'size' bytes, TP_REGION_CLASSES if none does */
+    static uint32_t tp_region_class(size_t size)
+    {
+        uint32_t klass = 0;
+        while (klass < TP_REGION_CLASSES && ((size_t)TP_REGION_MIN << klass) < size)
+        {
+            ++klass;
+        }
+        return klass;
+    }
+
+    /* Free block of class 'klass' or larger, carved from the untouched memory if the list is empty.
+       Called with the lock held. */
+    static tp_alloc_header *tp_region_take(teapot_region *region, uint32_t klass)
+    {
+        if (region->free_lists[klass] != NULL)
+        {
+            tp_alloc_header *header = (tp_alloc_header *)region->free_lists[klass];
+            region->free_lists[klass] = header->next;
+            --region->free_counts[klass];
+            header->info.klass = klass;
+            return header;
+        }
+        size_t block = tp_region_block_size(klass);
+        if (region->size - region->carved >= block)
+        {
+            tp_alloc_header *header = (tp_alloc_header *)(region->base + region->carved);
+            region->carved += block;
+            header->info.klass = klass;
+            return header;
+        }
+        /* last resort: a free block of a larger class */
+        for (uint32_t larger = klass + 1; larger < TP_REGION_CLASSES; ++larger)
+        {
+            if (region->free_lists[larger] != NULL)
+            {
+                tp_alloc_header *header = (tp_alloc_header *)region->free_lists[larger];
+                region->free_lists[larger] = header->next;
+                --region->free_counts[larger];
+                header->info.klass = larger;
+                return header;
+            }
+        }
+        return NULL;
+    }
+
+    static void tp_region_put(teapot_region *region, tp_alloc_header *header)
+    {
+        uint32_t klass = header->info.klass;
+        region->used -= tp_region_block_size(klass);
+        header->next = region->free_lists[klass];
+        region->free_lists[klass] = header;
+        ++region->free_counts[klass];
+    }
+
+    static void *tp_region_realloc(void *ctx, void *ptr, size_t size)
+    {
+        teapot_region *region = (teapot_region *)ctx;
+        tp_alloc_header *old = ptr ? (tp_alloc_header *)((char *)ptr - TP_ALLOC_HEADER) : NULL;
+        if (size == 0)
+        {
+            if (old != NULL)
+            {
+                tp_mutex_lock(&region->lock);
+                tp_region_put(region, old);
+                tp_mutex_unlock(&region->lock);
+            }
+            return NULL;
+        }
+
+        uint32_t klass = tp_region_class(size);
+        if (old != NULL && old->info.klass >= klass)
+        {
+            old->info.size = size; /* still fits its block */
+            return ptr;
+        }
+
+        tp_mutex_lock(&region->lock);
+        tp_alloc_header *header = klass < TP_REGION_CLASSES ? tp_region_take(region, klass) : NULL;
+        if (header == NULL)
+        {
+            ++region->failures;
+            tp_mutex_unlock(&region->lock);
+            return NULL; /* 'ptr' stays valid */
+        }
+        region->used += tp_region_block_size(header->info.klass);
+        if (region->used > region->peak)
+        {
+            region->peak = region->used;
+        }
+        tp_mutex_unlock(&region->lock);
+
+        header->info.size = size;
+        if (old != NULL)
+        {
+            memcpy((char *)header + TP_ALLOC_HEADER, ptr, old->info.size < size ? old->info.size : size);
+            tp_mutex_lock(&region->lock);
+            tp_region_put(region, old);
+            tp_mutex_unlock(&region->lock);
+        }
+        return (char *)header + TP_ALLOC_HEADER;
+    }
+
+    static void tp_region_free(void *ctx, void *ptr)
+    {
+        tp_region_realloc(ctx, ptr, 0);
+    }
+
+    int teapot_region_init(teapot_region *region, void *memory, size_t size)
+    {
+        memset(region, 0, sizeof(*region));
+        uintptr_t aligned = ((uintptr_t)memory + TP_ALLOC_HEADER - 1) & ~(uintptr_t)(TP_ALLOC_HEADER - 1);
+        size_t skipped = (size_t)(aligned - (uintptr_t)memory);
+        if (memory == NULL || size < skipped + tp_region_block_size(0))
+        {
+            return -1;
+        }
+        region->allocator.ctx = region;
+        region->allocator.realloc_fn = tp_region_realloc;
+        region->allocator.free_fn = tp_region_free;
+        region->base = (char *)aligned;
+        region->size = size - skipped;
+        tp_mutex_init(&region->lock);
+        return 0;
+    }
+
+    void teapot_region_destroy(teapot_region *region)
+    {
+        tp_mutex_destroy(&region->lock);
+        memset(region, 0, sizeof(*region));
+    }
+
+    size_t teapot_region_available(teapot_region *region)
+    {
+        /* the first thing a request takes is its receive buffer */
+        uint32_t usable = tp_region_class(sizeof(tp_io_buffer) + tp_io_buffer_sizes[TP_IO_BUFFER_4K] + 1);
+        tp_mutex_lock(&region->lock);
+        size_t available = region->size - region->carved;
+        for (uint32_t klass = usable; klass < TP_REGION_CLASSES; ++klass)
+        {
+            available += region->free_counts[klass] * tp_region_block_size(klass);
+        }
+        tp_mutex_unlock(&region->lock);
+        return available;
+    }
+
+    int teapot_recv_request(stb_teapot_socket_t client, char *buffer, int bufsize, int *out_received)
+    {
+        if (!socket_ok((stb_teapot_socket_t)client) || !buffer || bufsize <= 0)
+        {
+            return -1;
+        }
+
+        int received = teapot_read((stb_teapot_socket_t)client, buffer, bufsize - 1);
+        if (received <= 0)
+        {
+            if (out_received)
+            {
+                *out_received = received;
+            }
+            return -1;
+        }
+
+        buffer[received] = '\0';
+        if (out_received)
+        {
+            *out_received = received;
+        }
+        return 0;
+    }
+
+    /* 'head_only' for an answer to HEAD: the headers (Content-Length included) without the body */
+    static int tp_send_response(stb_teapot_socket_t client, const teapot_response *resp, int head_only)
+    {
+        if (!socket_ok((stb_teapot_socket_t)client) || !resp)
+            return -1;
+
+        /* 1xx, 204 and 304 responses carry no body */
+        int has_body = !(resp->status < 200 || resp->status == 204 || resp->status == 304);
+
+        /* status line and Content-Length are assembled by hand: this runs once per response and
+           snprintf would re-parse the format string every time */
+        static const char tp_body_headers[] = "Content-Type: text/plain\r\nContent-Length: ";
+        char header[1024];
+        char *p = header;
+        const char *reason = teapot_status_str(resp->status);
+        size_t reason_len = strlen(reason);
+        if (reason_len > 256)
+        {
+            reason_len = 256;
+        }
+        memcpy(p, "HTTP/1.1 ", 9);
+        p += 9;
+        if (resp->status < 0)
+        {
+            *p++ = '-';
+        }
+        p += tp_format_u64(p, resp->status < 0 ? 0 - (uint64_t)resp->status : (uint64_t)resp->status);
+        *p++ = ' ';
+        memcpy(p, reason, reason_len);
+        p += reason_len;
+        memcpy(p, "\r\n", 2);
+        p += 2;
+        if (has_body)
+        {
+            memcpy(p, tp_body_headers, sizeof(tp_body_headers) - 1);
+            p += sizeof(tp_body_headers) - 1;
+            p += tp_format_u64(p, (uint64_t)tp_da_len(resp->body));
+            memcpy(p, "\r\n", 2);
+            p += 2;
+        }
+        int header_len = (int)(p - header);
+
+        /* extra headers and the blank line go out with the status line when they fit */
+        if (resp->headers.count + 2 <= sizeof(header) - (size_t)header_len)
+        {
+            if (resp->headers.count > 0)
+            {
+                memcpy(header + header_len, resp->headers.items, resp->headers.count);
+                header_len += (int)resp->headers.count;
+            }
+            memcpy(header + header_len, "\r\n", 2);
+            header_len += 2;
+        }
+        else
+        {
+            if (teapot_write((stb_teapot_socket_t)client, header, header_len) < 0 ||
+                teapot_write((stb_teapot_socket_t)client, resp->headers.items, (int)resp->headers.count) < 0)
+            {
+                return -1;
+            }
+            memcpy(header, "\r\n", 2);
+            header_len = 2;
+        }
+
+        if (teapot_write((stb_teapot_socket_t)client, header, header_len) < 0)
+        {
+            return -1;
+        }
+
+        if (has_body && !head_only && resp->body.count > 0)
+        {
+            if (teapot_write((stb_teapot_socket_t)client, resp->body.items, (int)resp->body.count) < 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    int teapot_send_response(stb_teapot_socket_t client, const teapot_response *resp)
+    {
+        return tp_send_response(client, resp, 0);
+    }
+
+#ifndef TP_KEEP_ALIVE_TIMEOUT_MS
+#define TP_KEEP_ALIVE_TIMEOUT_MS 5000
+#endif
+#ifndef TP_REQUEST_TIMEOUT_MS
+#define TP_REQUEST_TIMEOUT_MS 30000 // how long a client may stay silent while it owes a request
+#endif
+
+    static void tp_socket_set_recv_timeout(stb_teapot_socket_t s, int timeout_ms)
+    {
+#ifdef _WIN32
+        DWORD tv = (DWORD)timeout_ms;
+#else
+        struct timeval tv;
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+#endif
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof(tv));
+    }
+
+    /* 1 once 'client' is readable, 0 on timeout, -1 on error. A negative timeout waits forever. */
+    static int tp_wait_readable(stb_teapot_socket_t client, int timeout_ms)
+    {
+#ifdef _WIN32
+        WSAPOLLFD pfd;
+        pfd.fd = client;
+        pfd.events = POLLRDNORM;
+        pfd.revents = 0;
+        int ready = WSAPoll(&pfd, 1, timeout_ms);
+#else
+        struct pollfd pfd;
+        pfd.fd = client;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, timeout_ms);
+#endif
+        return ready < 0 ? -1 : (ready > 0);
+    }
+
+    /* Wait up to 'timeout_ms' for input from a client of 'server', in TP_POOL_POLL_MS slices so that
+       teapot_server_stop() is noticed. 1 once readable, 0 on timeout or stop, -1 on error. */
+    static int tp_wait_input(const teapot_server *server, stb_teapot_socket_t client, int timeout_ms)
+    {
+        for (int waited = 0; waited < timeout_ms; waited += TP_POOL_POLL_MS)
+        {
+            if (tp_atomic_load(&server->stop) != 0)
+            {
+                return 0;
+            }
+            int ready = tp_wait_readable(client, timeout_ms - waited < TP_POOL_POLL_MS ? timeout_ms - waited
+                                                                                       : TP_POOL_POLL_MS);
+            if (ready != 0)
+            {
+                return ready;
+            }
+        }
+        return 0;
+    }
+
+    // -----------------------------------------------------
+    // 📊 Memory Budget
+    // -----------------------------------------------------
+#ifndef TP_BUDGET_WAIT_MS
+#define TP_BUDGET_WAIT_MS 1000 // how long a connection waits for an exhausted budget before a 503
+#endif
+
+    size_t teapot_memory_used(const teapot_memory_budget *budget)
+    {
+        return budget ? tp_atomic_load(&budget->used) : 0;
+    }
+
+    /* What one connection has charged to the budget. Its allocator wraps the server's allocator. */
+    typedef struct
+    {
+        teapot_memory_budget *budget;
+        const tp_allocator *parent;
+        tp_allocator allocator;
+        size_t used;
+    } tp_conn_budget;
+
+    static void tp_budget_charge(tp_conn_budget *cb, size_t bytes)
+    {
+        cb->used += bytes;
+        size_t used = tp_atomic_add(&cb->budget->used, bytes);
+        size_t peak = tp_atomic_load(&cb->budget->peak);
+        while (used > peak && !tp_atomic_cas(&cb->budget->peak, &peak, used))
+        {
+            /* a racing charge moved the peak: 'peak' now holds it, retry while ours is higher */
+        }
+    }
+
+    static void tp_budget_uncharge(tp_conn_budget *cb, size_t bytes)
+    {
+        cb->used -= bytes;
+        tp_atomic_sub(&cb->budget->used, bytes);
+    }
+
+    /* 0 if 'bytes' more may be charged, else the status to refuse the request with */
+    static int tp_budget_admit(const tp_conn_budget *cb, size_t bytes)
+    {
+        const teapot_memory_budget *budget = cb->budget;
+        if (budget->connection_limit != 0 && cb->used + bytes > budget->connection_limit)
+        {
+            return 413;
+        }
+        if (budget->global_limit != 0 && tp_atomic_load(&budget->used) + bytes > budget->global_limit)
+        {
+            return 503;
+        }
+        return 0;
+    }
+
+    /* Nonzero once the connection, or the budget as a whole, is past its limit */
+    static int tp_budget_exceeded(const tp_conn_budget *cb)
+    {
+        const teapot_memory_budget *budget = cb->budget;
+        return (budget->connection_limit != 0 && cb->used > budget->connection_limit) ||
+               (budget->global_limit != 0 && tp_atomic_load(&budget->used) > budget->global_limit);
+    }
+
+    static void tp_sleep_ms(int ms)
+    {
+#ifdef _WIN32
+        Sleep((DWORD)ms);
+#else
+        poll(NULL, 0, ms);
+#endif
+    }
+
+    /* Backpressure: don't read while the global budget is spent. Returns 0 once there is room again,
+       -1 if there still isn't any after TP_BUDGET_WAIT_MS. */
+    static int tp_budget_wait(const tp_conn_budget *cb)
+    {
+        const teapot_memory_budget *budget = cb->budget;
+        for (int waited = 0; budget->global_limit != 0 && tp_atomic_load(&budget->used) >= budget->global_limit;
+             waited += 10)
+        {
+            if (waited >= TP_BUDGET_WAIT_MS)
+            {
+                return -1;
+            }
+            tp_sleep_ms(10);
+        }
+        return 0;
+    }
+
+    /* Charges every allocation without refusing any, as failing a handler's allocation would abort
+       it. Limits are enforced on request input before it is read (tp_budget_admit) and on the
+       response once the handler returned (tp_budget_exceeded), which is then refused with a 503. */
+    static void *tp_budget_realloc(void *ctx, void *ptr, size_t size)
+    {
+        tp_conn_budget *cb = (tp_conn_budget *)ctx;
+        const tp_allocator *parent = cb->parent;
+        tp_alloc_header *old = ptr ? (tp_alloc_header *)((char *)ptr - TP_ALLOC_HEADER) : NULL;
+        size_t old_size = old ? old->info.size : 0;
+
+        if (size == 0)
+        {
+            tp_budget_uncharge(cb, old_size);
+            parent->free_fn(parent->ctx, old);
+            return NULL;
+        }
+
+        tp_alloc_header *header = (tp_alloc_header *)parent->realloc_fn(parent->ctx, old, TP_ALLOC_HEADER + size);
+        if (header == NULL)
+        {
+            return NULL;
+        }
+        header->info.size = size;
+        tp_budget_uncharge(cb, old_size);
+        tp_budget_charge(cb, size);
+        return (char *)header + TP_ALLOC_HEADER;
+    }
+
+    static void tp_budget_free(void *ctx, void *ptr)
+    {
+        if (ptr == NULL)
+        {
+            return;
+        }
+        tp_conn_budget *cb = (tp_conn_budget *)ctx;
+        tp_alloc_header *header = (tp_alloc_header *)((char *)ptr - TP_ALLOC_HEADER);
+        tp_budget_uncharge(cb, header->info.size);
+        cb->parent->free_fn(cb->parent->ctx, header);
+    }
+
+    static void tp_conn_budget_init(tp_conn_budget *cb, teapot_memory_budget *budget, const tp_allocator *parent)
+    {
+        cb->budget = budget;
+        cb->parent = parent ? parent : &tp_default_allocator;
+        cb->allocator.ctx = cb;
+        cb->allocator.realloc_fn = tp_budget_realloc;
+        cb->allocator.free_fn = tp_budget_free;
+        cb->used = 0;
+    }
+
+    /* Receive buffers come from the process-wide pool, so they are charged by hand. Under TP_NO_HEAP
+       they come from the current allocator, which charges them already. */
+    static void tp_budget_charge_io(tp_conn_budget *cb, size_t bytes)
+    {
+#ifndef TP_NO_HEAP
+        if (cb != NULL)
+        {
+            tp_budget_charge(cb, bytes);
+        }
+#else
+        (void)cb;
+        (void)bytes;
+#endif
+    }
+
+    /* Give a buffer back, uncharging it */
+    static void tp_budget_release_io(tp_conn_budget *cb, tp_io_buffer **io)
+    {
+        if (*io == NULL)
+        {
+            return;
+        }
+#ifndef TP_NO_HEAP
+        if (cb != NULL)
+        {
+            tp_budget_uncharge(cb, (*io)->capacity);
+        }
+#else
+        (void)cb;
+#endif
+        tp_io_buffer_release(*io);
+        *io = NULL;
+    }
+
+    /* Length of the first complete request (headers + Content-Length body) in 'buf', 0 if incomplete.
+       Once the headers are in, '*expected' (if given) is set to the full length of the request.
+       SIZE_MAX if it has to be refused, with the status in '*status': 413 if it can't fit in any
+       buffer, 400 or 501 if its body can't be framed (see tp_request_body_length()). */
+    static size_t tp_complete_request_length(tp_io_buffer *buf, size_t *expected, int *status)
+    {
+        buf->data[buf->len] = '\0';
+        const char *end = strstr(buf->data, "\r\n\r\n");
+        if (end == NULL)
+        {
+            return 0;
+        }
+
+        size_t header_len = (size_t)(end - buf->data) + 4;
+        size_t content_length = 0;
+        int refused = tp_request_body_length(buf->data, (size_t)(end - buf->data), &content_length);
+        if (refused != 0)
+        {
+            *status = refused;
+            return SIZE_MAX;
+        }
+        if (expected != NULL)
+        {
+            *expected = (content_length > SIZE_MAX - header_len) ? SIZE_MAX : header_len + content_length;
+        }
+
+        if (content_length > buf->len || buf->len - content_length < header_len)
+        {
+            /* body still incomplete, or more than the largest buffer can ever hold */
+            if (content_length > tp_io_buffer_sizes[TP_IO_BUFFER_CLASS_COUNT - 1])
+            {
+                *status = 413;
+                return SIZE_MAX;
+            }
+            return 0;
+        }
+        return header_len + content_length;
+    }
+
+    /* Read until '*io' (acquired on first use, grown as needed) holds a complete request, charging
+       the buffer to 'cb' if given. Returns 1 and its length, 0 if the peer closed, stalled for
+       TP_REQUEST_TIMEOUT_MS or the server stopped first, or the status to refuse the request with:
+       413 if it can't fit in any buffer or in the connection's budget, 503 if the global budget
+       can't hold it, 400 or 501 if its body can't be framed. */
+    static int tp_read_request(const teapot_server *server, stb_teapot_socket_t client, tp_io_buffer **io,
+                               size_t *out_len, tp_conn_budget *cb)
+    {
+        if (*io == NULL)
+        {
+            int refused = cb != NULL ? tp_budget_admit(cb, tp_io_buffer_sizes[TP_IO_BUFFER_4K]) : 0;
+            if (refused != 0)
+            {
+                return refused;
+            }
+            *io = tp_io_buffer_acquire(1);
+            if (*io == NULL)
+            {
+                return 503; /* TP_NO_HEAP region exhausted */
+            }
+            tp_budget_charge_io(cb, (*io)->capacity);
+        }
+
+        int checked = 0; /* budget checked against the announced request size */
+        for (;;)
+        {
+            size_t expected = 0;
+            int status = 0;
+            size_t len = tp_complete_request_length(*io, &expected, &status);
+            if (len == SIZE_MAX)
+            {
+                return status;
+            }
+            if (len > 0)
+            {
+                *out_len = len;
+                return 1;
+            }
+
+            /* refuse a request the budget can't hold before reading its body */
+            if (cb != NULL && expected > (*io)->capacity && !checked)
+            {
+                int refused = tp_budget_admit(cb, expected - (*io)->capacity);
+                if (refused != 0)
+                {
+                    return refused;
+                }
+                checked = 1;
+            }
+
+            if ((*io)->len == (*io)->capacity)
+            {
+                size_t old_capacity = (*io)->capacity;
+                tp_io_buffer *bigger = tp_io_buffer_grow(*io);
+                if (bigger == NULL)
+                {
+                    return (*io)->size_class + 1 < TP_IO_BUFFER_CLASS_COUNT ? 503 : 413;
+                }
+                *io = bigger;
+                tp_budget_charge_io(cb, bigger->capacity - old_capacity);
+            }
+
+            if (tp_wait_input(server, client, TP_REQUEST_TIMEOUT_MS) <= 0)
+            {
+                return 0;
+            }
+            int got = teapot_read(client, (*io)->data + (*io)->len, (int)((*io)->capacity - (*io)->len));
+            if (got <= 0)
+            {
+                return 0;
+            }
+            (*io)->len += (size_t)got;
+        }
+    }
+
+    /* Refusals are sent when memory is short: their builders borrow static text */
+    static char tp_refusal_400[] = "400 Bad Request\n";
+    static char tp_refusal_413[] = "413 Content Too Large\n";
+    static char tp_refusal_501[] = "501 Not Implemented\n";
+    static char tp_refusal_503[] = "503 Service Unavailable\n";
+    static char tp_refusal_headers[] = "Connection: close\r\n";
+
+    static void tp_send_refusal(stb_teapot_socket_t client, int status)
+    {
+        teapot_response refusal;
+        memset(&refusal, 0, sizeof(refusal));
+        refusal.status = status;
+        switch (status)
+        {
+        case 400:
+            refusal.body.items = tp_refusal_400;
+            break;
+        case 413:
+            refusal.body.items = tp_refusal_413;
+            break;
+        case 501:
+            refusal.body.items = tp_refusal_501;
+            break;
+        default:
+            refusal.body.items = tp_refusal_503;
+            break;
+        }
+        refusal.body.count = strlen(refusal.body.items);
+        refusal.headers.items = tp_refusal_headers;
+        refusal.headers.count = sizeof(tp_refusal_headers) - 1;
+        teapot_send_response(client, &refusal);
+    }
+
+    int teapot_handle_client_connection(teapot_server *server, stb_teapot_socket_t client)
+    {
+        if (!server || !socket_ok((stb_teapot_socket_t)client))
+        {
+            teapot_close((stb_teapot_socket_t)client);
+            return -1;
+        }
+
+        /* reads only follow a successful wait, the timeout is a backstop */
+        tp_socket_set_recv_timeout(client, server->keep_alive ? TP_KEEP_ALIVE_TIMEOUT_MS : TP_REQUEST_TIMEOUT_MS);
+
+        /* requests, responses and handler allocations all go to the server's allocator, through
+           the connection's budget if the server has one */
+        tp_conn_budget conn_budget;
+        tp_conn_budget *cb = NULL;
+        const tp_allocator *allocator = server->allocator;
+        if (server->budget != NULL)
+        {
+            tp_conn_budget_init(&conn_budget, server->budget, server->allocator);
+            cb = &conn_budget;
+            allocator = &conn_budget.allocator;
+        }
+        const tp_allocator *previous_allocator = tp_allocator_use(allocator);
+
+        /* responses reuse the connection's buffers from one request to the next */
+        tp_response_buffers response_buffers;
+        memset(&response_buffers, 0, sizeof(response_buffers));
+        tp_response_buffers *previous_buffers = tp_response_buffers_use(&response_buffers);
+
+        /* every request of the connection allocates from the same arena, reset after each response */
+        tp_arena arena = {0};
+        tp_io_buffer *io = NULL; /* pending input, NULL while the connection is idle */
+        int result = 0;
+        int keep_alive = 0;
+        do
+        {
+            /* an idle connection is dropped once it times out or the server stops */
+            int timeout_ms = keep_alive ? TP_KEEP_ALIVE_TIMEOUT_MS : TP_REQUEST_TIMEOUT_MS;
+            if (io == NULL && tp_wait_input(server, client, timeout_ms) <= 0)
+            {
+                result = keep_alive ? 0 : -1;
+                break;
+            }
+
+            /* a fixed region can't grow: turn requests away before they could exhaust it */
+            if (server->region != NULL && teapot_region_available(server->region) < TP_REGION_REQUEST_RESERVE)
+            {
+                tp_send_refusal(client, 503);
+                result = -1;
+                break;
+            }
+
+            /* backpressure: leave the input in the socket while the budget is spent */
+            if (cb != NULL && tp_budget_wait(cb) < 0)
+            {
+                tp_send_refusal(client, 503);
+                tp_atomic_add(&server->budget->rejected, 1);
+                result = -1;
+                break;
+            }
+
+            size_t request_len = 0;
+            int status = tp_read_request(server, client, &io, &request_len, cb);
+            if (status != 1)
+            {
+                if (status != 0)
+                {
+                    tp_send_refusal(client, status);
+                    if (cb != NULL && (status == 413 || status == 503))
+                    {
+                        tp_atomic_add(&server->budget->rejected, 1);
+                    }
+                }
+                /* an idle persistent connection going away is not an error */
+                result = (status == 0 && keep_alive && (io == NULL || io->len == 0)) ? 0 : -1;
+                break;
+            }
+
+            teapot_request req;
+            memset(&req, 0, sizeof(req));
+            req.arena = &arena;
+            size_t failures = tp_out_of_memory_count(); /* only failures of this request count */
+
+            /* hide pipelined input from the parser */
+            char next_byte = io->data[request_len];
+            io->data[request_len] = '\0';
+            int parsed = parse_request(io->data, request_len, &req);
+            io->data[request_len] = next_byte;
+
+            /* the request now lives in the arena: give the buffer back unless more input is pending */
+            io->len -= request_len;
+            if (io->len > 0)
+            {
+                memmove(io->data, io->data + request_len, io->len);
+            }
+            else
+            {
+                tp_budget_release_io(cb, &io);
+            }
+
+            int out_of_memory = tp_out_of_memory_count() != failures;
+            if (parsed < 0 || out_of_memory)
+            {
+                /* malformed, or the region ran out while parsing it */
+                if (out_of_memory)
+                {
+                    tp_send_refusal(client, 503);
+                }
+                free_request(&req);
+                result = -1;
+                break;
+            }
+
+            keep_alive = server->keep_alive && req.keep_alive;
+            teapot_response resp = teapot_dispatch(server, &req);
+            if (server->keep_alive && !keep_alive)
+            {
+                teapot_response_add_header(&resp, "Connection", "close");
+            }
+            tp_sb_append_null(&resp.body);
+
+            if (tp_out_of_memory_count() != failures)
+            {
+                /* the region ran out while answering: the response may be cut short */
+                tp_response_buffers_recycle(&response_buffers, &resp);
+                free_request(&req);
+                tp_send_refusal(client, 503);
+                result = -1;
+                break;
+            }
+
+            if (cb != NULL && tp_budget_exceeded(cb))
+            {
+                /* the handler took the connection past its budget: don't send what it built */
+                tp_response_buffers_recycle(&response_buffers, &resp);
+                free_request(&req);
+                tp_send_refusal(client, 503);
+                tp_atomic_add(&server->budget->rejected, 1);
+                result = -1;
+                break;
+            }
+
+            if (tp_send_response(client, &resp, req.method == TEAPOT_HEAD) < 0)
+            {
+                keep_alive = 0;
+            }
+
+            tp_response_buffers_recycle(&response_buffers, &resp);
+            free_request(&req);
+            tp_arena_reset(&arena);
+        } while (keep_alive);
+
+        tp_response_buffers_use(previous_buffers);
+        tp_response_buffers_free(&response_buffers);
+        tp_budget_release_io(cb, &io);
+        tp_arena_free(&arena);
+        tp_allocator_use(previous_allocator);
+        teapot_close((stb_teapot_socket_t)client);
+        return result;
+    }
+
+    // Keep a convenience blocking single-threaded listen that uses the new API
+    int teapot_listen(teapot_server *server)
+    {
+        if (!server)
+        {
+            return 1;
+        }
+
+        stb_teapot_socket_t listen_sock;
+        if (teapot_listener_open(server, &listen_sock) < 0)
+        {
+            return 1;
+        }
+
+        printf("🫖 stb_teapot listening on port %d\n", server->port);
+
+        while (1)
+        {
+            stb_teapot_socket_t client = teapot_listener_accept(listen_sock);
+            if ((int)client < 0)
+            {
+                continue;
+            }
+
+            // simple single-threaded handling (users can accept and dispatch themselves)
+            teapot_handle_client_connection(server, client);
+        }
+
+        /* unreachable in current API, but keep symmetry */
+        // teapot_close((stb_teapot_socket_t)listen_sock);
+        return 0;
+    }
+
+    // -----------------------------------------------------
+    // 🧵 Worker Pool
+    // -----------------------------------------------------
+#ifdef _WIN32
+    typedef HANDLE tp_thread;
+    typedef DWORD(WINAPI *tp_thread_fn)(LPVOID arg);
+#define TP_THREAD_FN(name, arg) static DWORD WINAPI name(LPVOID arg)
+#define TP_THREAD_RETURN return 0
+
+    /* windows.h was included with _WINCON_ defined: declare the bits of wincon.h used here */
+#ifndef CTRL_C_EVENT
+#define CTRL_C_EVENT 0
+#endif
+#ifndef CTRL_BREAK_EVENT
+#define CTRL_BREAK_EVENT 1
+#endif
+#ifndef CTRL_CLOSE_EVENT
+#define CTRL_CLOSE_EVENT 2
+#endif
+    BOOL WINAPI SetConsoleCtrlHandler(BOOL(WINAPI *handler)(DWORD), BOOL add);
+#else
+    typedef pthread_t tp_thread;
+    typedef void *(*tp_thread_fn)(void *arg);
+#define TP_THREAD_FN(name, arg) static void *name(void *arg)
+#define TP_THREAD_RETURN return NULL
+#endif
+
+    static int tp_thread_start(tp_thread *thread, tp_thread_fn fn, void *arg)
+    {
+#ifdef _WIN32
+        *thread = CreateThread(NULL, 0, fn, arg, 0, NULL);
+        return *thread != NULL ? 0 : -1;
+#else
+        return pthread_create(thread, NULL, fn, arg) == 0 ? 0 : -1;
+#endif
+    }
+
+    static void tp_thread_join(tp_thread thread)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+#else
+        pthread_join(thread, NULL);
+#endif
+    }
+
+    static void tp_thread_yield(void)
+    {
+#ifdef _WIN32
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+    }
+
+    static void tp_socket_set_nonblocking(stb_teapot_socket_t s, int on)
+    {
+#ifdef _WIN32
+        u_long mode = (u_long)on;
+        ioctlsocket(s, FIONBIO, &mode);
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        fcntl(s, F_SETFL, on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+    }
+
+    int teapot_cpu_count(void)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        int count = (int)info.dwNumberOfProcessors;
+#else
+        int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        return count > 0 ? count : 1;
+    }
+
+#ifndef TP_CPU_MASK_WORDS
+#define TP_CPU_MASK_WORDS 16 // affinity masks cover CPUs 0 to 16 * 64 - 1
+#endif
+
+    int teapot_pin_current_thread(int cpu)
+    {
+        if (cpu < 0)
+        {
+            return -1;
+        }
+#if defined(_WIN32)
+        if (cpu >= (int)(sizeof(DWORD_PTR) * 8))
+        {
+            return -1;
+        }
+        return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0 ? 0 : -1;
+#elif defined(TP_HAS_AFFINITY)
+        /* the system call itself: the libc wrappers need _GNU_SOURCE */
+        unsigned long mask[TP_CPU_MASK_WORDS] = {0};
+        const size_t bits = sizeof(mask[0]) * 8;
+        if ((size_t)cpu >= TP_CPU_MASK_WORDS * bits)
+        {
+            return -1;
+        }
+        mask[(size_t)cpu / bits] = 1ul << ((size_t)cpu % bits);
+        return syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0 ? 0 : -1;
+#else
+        return -1;
+#endif
+    }
+
+    /* The i-th CPU the process may run on, wrapping around. -1 where threads can't be pinned. */
+    static int tp_pool_cpu(int i)
+    {
+#if defined(_WIN32)
+        int count = teapot_cpu_count();
+        return count <= (int)(sizeof(DWORD_PTR) * 8) ? i % count : -1;
+#elif defined(TP_HAS_AFFINITY)
+        unsigned long mask[TP_CPU_MASK_WORDS] = {0};
+        const size_t bits = sizeof(mask[0]) * 8;
+        long got = syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask); /* bytes filled in */
+        if (got <= 0)
+        {
+            return -1;
+        }
+        size_t cpus = (size_t)got * 8;
+        size_t allowed = 0;
+        for (size_t cpu = 0; cpu < cpus; ++cpu)
+        {
+            allowed += (mask[cpu / bits] >> (cpu % bits)) & 1;
+        }
+        size_t skip = allowed > 0 ? (size_t)i % allowed : 0;
+        for (size_t cpu = 0; cpu < cpus; ++cpu)
+        {
+            if (((mask[cpu / bits] >> (cpu % bits)) & 1) && skip-- == 0)
+            {
+                return (int)cpu;
+            }
+        }
+        return -1;
+#else
+        (void)i;
+        return -1;
+#endif
+    }
+
+    void teapot_server_stop(teapot_server *server)
+    {
+        tp_atomic_add(&server->stop, 1); /* lock-free, so safe from a signal handler */
+    }
+
+    /* Where idle workers sleep: a counting semaphore, only touched once a worker found nothing to do */
+    typedef struct
+    {
+#if defined(_WIN32)
+        HANDLE semaphore;
+#elif defined(__linux__)
+        int fd; /* eventfd in semaphore mode */
+#else
+        pthread_mutex_t lock;
+        pthread_cond_t posted;
+        size_t count;
+#endif
+    } tp_parking;
+
+    static int tp_parking_init(tp_parking *p)
+    {
+#if defined(_WIN32)
+        p->semaphore = CreateSemaphoreA(NULL, 0, 0x7fffffff, NULL);
+        return p->semaphore != NULL ? 0 : -1;
+#elif defined(__linux__)
+        p->fd = eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
+        return p->fd >= 0 ? 0 : -1;
+#else
+        p->count = 0;
+        pthread_mutex_init(&p->lock, NULL);
+        pthread_cond_init(&p->posted, NULL);
+        return 0;
+#endif
+    }
+
+    static void tp_parking_destroy(tp_parking *p)
+    {
+#if defined(_WIN32)
+        CloseHandle(p->semaphore);
+#elif defined(__linux__)
+        close(p->fd);
+#else
+        pthread_cond_destroy(&p->posted);
+        pthread_mutex_destroy(&p->lock);
+#endif
+    }
+
+    /* Lets 'n' waits through, now or later */
+    static void tp_parking_post(tp_parking *p, size_t n)
+    {
+#if defined(_WIN32)
+        ReleaseSemaphore(p->semaphore, (LONG)n, NULL);
+#elif defined(__linux__)
+        uint64_t value = n;
+        while (write(p->fd, &value, sizeof(value)) != (ssize_t)sizeof(value))
+        {
+        }
+#else
+        pthread_mutex_lock(&p->lock);
+        p->count += n;
+        pthread_mutex_unlock(&p->lock);
+        if (n == 1)
+        {
+            pthread_cond_signal(&p->posted);
+        }
+        else
+        {
+            pthread_cond_broadcast(&p->posted);
+        }
+#endif
+    }
+
+    static void tp_parking_wait(tp_parking *p)
+    {
+#if defined(_WIN32)
+        WaitForSingleObject(p->semaphore, INFINITE);
+#elif defined(__linux__)
+        uint64_t value;
+        while (read(p->fd, &value, sizeof(value)) != (ssize_t)sizeof(value))
+        {
+            /* interrupted by a signal */
+        }
+#else
+        pthread_mutex_lock(&p->lock);
+        while (p->count == 0)
+        {
+            pthread_cond_wait(&p->posted, &p->lock);
+        }
+        --p->count;
+        pthread_mutex_unlock(&p->lock);
+#endif
+    }
+
+    /* Bounded MPMC ring of accepted sockets, after Dmitry Vyukov's: every cell carries a sequence
+       number telling producers and consumers whether it is theirs, so claiming a cell is one CAS on
+       a position and nobody ever holds a lock. The hot positions sit on their own cache lines. */
+    typedef struct
+    {
+        size_t sequence;
+        stb_teapot_socket_t socket;
+    } tp_ring_cell;
+
+    typedef struct
+    {
+        tp_ring_cell *cells;
+        size_t mask; /* capacity - 1, the capacity is a power of two */
+        char pad0[TP_CACHE_LINE];
+        size_t enqueue_pos;
+        char pad1[TP_CACHE_LINE];
+        size_t dequeue_pos;
+        char pad2[TP_CACHE_LINE];
+        size_t sleepers; /* consumers parked, or about to */
+        size_t closed;
+        tp_parking parking;
+    } tp_socket_ring;
+
+    static int tp_socket_ring_init(tp_socket_ring *ring, size_t min_capacity)
+    {
+        memset(ring, 0, sizeof(*ring));
+        size_t capacity = 2;
+        while (capacity < min_capacity)
+        {
+            capacity *= 2;
+        }
+        ring->cells = (tp_ring_cell *)tp_realloc(NULL, capacity * sizeof(tp_ring_cell));
+        if (ring->cells == NULL)
+        {
+            return -1;
+        }
+        if (tp_parking_init(&ring->parking) < 0)
+        {
+            tp_free(ring->cells);
+            ring->cells = NULL;
+            return -1;
+        }
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            ring->cells[i].sequence = i;
+        }
+        ring->mask = capacity - 1;
+        return 0;
+    }
+
+    static void tp_socket_ring_destroy(tp_socket_ring *ring)
+    {
+        if (ring->cells != NULL)
+        {
+            tp_parking_destroy(&ring->parking);
+            tp_free(ring->cells);
+            ring->cells = NULL;
+        }
+    }
+
+    /* -1 when the ring is full. Wakes a parked consumer, if any */
+    static int tp_socket_ring_push(tp_socket_ring *ring, stb_teapot_socket_t socket)
+    {
+        size_t pos = tp_atomic_load(&ring->enqueue_pos);
+        for (;;)
+        {
+            tp_ring_cell *cell = &ring->cells[pos & ring->mask];
+            intptr_t diff = (intptr_t)tp_atomic_load_acquire(&cell->sequence) - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (tp_atomic_cas(&ring->enqueue_pos, &pos, pos + 1))
+                {
+                    cell->socket = socket;
+                    tp_atomic_store_release(&cell->sequence, pos + 1);
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return -1;
+            }
+            else
+            {
+                pos = tp_atomic_load(&ring->enqueue_pos); /* another producer got there first */
+            }
+        }
+        /* pairs with the fence in tp_socket_ring_pop(): either the consumer about to park sees
+           this socket, or this sees it parking */
+        tp_atomic_fence();
+        if (tp_atomic_load(&ring->sleepers) > 0)
+        {
+            tp_parking_post(&ring->parking, 1);
+        }
+        return 0;
+    }
+
+    static int tp_socket_ring_try_pop(tp_socket_ring *ring, stb_teapot_socket_t *socket)
+    {
+        size_t pos = tp_atomic_load(&ring->dequeue_pos);
+        for (;;)
+        {
+            tp_ring_cell *cell = &ring->cells[pos & ring->mask];
+            intptr_t diff = (intptr_t)tp_atomic_load_acquire(&cell->sequence) - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (tp_atomic_cas(&ring->dequeue_pos, &pos, pos + 1))
+                {
+                    *socket = cell->socket;
+                    tp_atomic_store_release(&cell->sequence, pos + ring->mask + 1);
+                    return 1;
+                }
+            }
+            else if (diff < 0)
+            {
+                return 0; /* empty */
+            }
+            else
+            {
+                pos = tp_atomic_load(&ring->dequeue_pos);
+            }
+        }
+    }
+
+    /* Next socket, or an invalid one once the ring is closed and drained.
+       Spins for TP_POOL_SPIN tries before parking, so busy workers never touch the semaphore. */
+    static stb_teapot_socket_t tp_socket_ring_pop(tp_socket_ring *ring)
+    {
+        stb_teapot_socket_t socket;
+        for (;;)
+        {
+            for (int spin = 0; spin < TP_POOL_SPIN; ++spin)
+            {
+                if (tp_socket_ring_try_pop(ring, &socket))
+                {
+                    return socket;
+                }
+                tp_thread_yield();
+            }
+
+            tp_atomic_add(&ring->sleepers, 1);
+            tp_atomic_fence();
+            size_t closed = tp_atomic_load_acquire(&ring->closed); /* before the last look */
+            if (tp_socket_ring_try_pop(ring, &socket))
+            {
+                tp_atomic_sub(&ring->sleepers, 1);
+                return socket;
+            }
+            if (closed)
+            {
+                tp_atomic_sub(&ring->sleepers, 1);
+                return (stb_teapot_socket_t)-1;
+            }
+            tp_parking_wait(&ring->parking);
+            tp_atomic_sub(&ring->sleepers, 1);
+        }
+    }
+
+    /* No more pushes: releases up to 'consumers' parked threads once the ring is drained */
+    static void tp_socket_ring_close(tp_socket_ring *ring, size_t consumers)
+    {
+        tp_atomic_store_release(&ring->closed, 1);
+        tp_atomic_fence();
+        tp_parking_post(&ring->parking, consumers);
+    }
+
+    /* Chase-Lev work-stealing deque of sockets, fixed size: the owner pushes and pops at the bottom,
+       newest first, while other threads steal the oldest at the top. Only the last element is
+       ever fought over, with one CAS. */
+    typedef struct
+    {
+        size_t top;
+        char pad0[TP_CACHE_LINE];
+        size_t bottom;
+        char pad1[TP_CACHE_LINE];
+        size_t cells[TP_POOL_DEQUE_SIZE]; /* sockets, accessed atomically */
+        char pad2[TP_CACHE_LINE];
+    } tp_deque;
+
+    /* Owner only */
+    static int tp_deque_full(tp_deque *d)
+    {
+        return tp_atomic_load(&d->bottom) - tp_atomic_load_acquire(&d->top) >= TP_POOL_DEQUE_SIZE;
+    }
+
+    /* Owner only. -1 when full */
+    static int tp_deque_push(tp_deque *d, stb_teapot_socket_t socket)
+    {
+        size_t b = tp_atomic_load(&d->bottom);
+        if (b - tp_atomic_load_acquire(&d->top) >= TP_POOL_DEQUE_SIZE)
+        {
+            return -1;
+        }
+        tp_atomic_store_release(&d->cells[b & (TP_POOL_DEQUE_SIZE - 1)], (size_t)socket);
+        tp_atomic_store_release(&d->bottom, b + 1);
+        return 0;
+    }
+
+    /* Owner only */
+    static int tp_deque_pop(tp_deque *d, stb_teapot_socket_t *socket)
+    {
+        size_t b = tp_atomic_load(&d->bottom) - 1;
+        tp_atomic_store_release(&d->bottom, b);
+        tp_atomic_fence(); /* thieves see the claim before we look at top */
+        size_t t = tp_atomic_load(&d->top);
+        if ((intptr_t)(b - t) < 0)
+        {
+            tp_atomic_store_release(&d->bottom, b + 1); /* empty */
+            return 0;
+        }
+        *socket = (stb_teapot_socket_t)tp_atomic_load(&d->cells[b & (TP_POOL_DEQUE_SIZE - 1)]);
+        if (b != t)
+        {
+            return 1;
+        }
+        int won = tp_atomic_cas(&d->top, &t, t + 1); /* the last one: race the thieves for it */
+        tp_atomic_store_release(&d->bottom, b + 1);
+        return won;
+    }
+
+    /* Any thread. 0 when empty or when someone else took it first */
+    static int tp_deque_steal(tp_deque *d, stb_teapot_socket_t *socket)
+    {
+        size_t t = tp_atomic_load_acquire(&d->top);
+        tp_atomic_fence();
+        size_t b = tp_atomic_load_acquire(&d->bottom);
+        if ((intptr_t)(b - t) <= 0)
+        {
+            return 0;
+        }
+        size_t value = tp_atomic_load(&d->cells[t & (TP_POOL_DEQUE_SIZE - 1)]);
+        if (!tp_atomic_cas(&d->top, &t, t + 1))
+        {
+            return 0;
+        }
+        *socket = (stb_teapot_socket_t)value;
+        return 1;
+    }
+
+    struct tp_pool;
+
+    typedef struct
+    {
+        tp_deque deque; /* work stealing only */
+        struct tp_pool *pool;
+        size_t index;
+        uint32_t rng;                  /* picks steal victims */
+        int cpu;                       /* -1 when not pinned */
+        stb_teapot_socket_t listener;  /* the pool's, or its own when sharded */
+    } tp_pool_worker;
+
+    typedef struct tp_pool
+    {
+        teapot_server *server;
+        stb_teapot_socket_t listener;
+        tp_socket_ring ring; /* dispatcher only */
+        size_t max_connections;
+        size_t in_service;   /* connections queued or being served */
+
+        tp_pool_worker *workers;
+        size_t worker_count;
+
+        /* work stealing only */
+        size_t leader;   /* 1 while a worker waits on the listener */
+        size_t queued;   /* connections sitting in deques */
+        size_t sleepers; /* workers parked, or about to */
+        tp_parking parking;
+
+        size_t unpinned; /* pin_workers only: workers left floating */
+    } tp_pool;
+
+    /* Next accepted connection, or an invalid socket once the server is stopped */
+    static stb_teapot_socket_t tp_pool_accept(tp_pool *pool, stb_teapot_socket_t listener)
+    {
+        while (tp_atomic_load(&pool->server->stop) == 0)
+        {
+            if (tp_wait_readable(listener, TP_POOL_POLL_MS) <= 0)
+            {
+                continue; /* timeout, or interrupted by a signal */
+            }
+            stb_teapot_socket_t client = teapot_listener_accept(listener);
+            if (socket_ok(client))
+            {
+                return client;
+            }
+        }
+        return (stb_teapot_socket_t)-1;
+    }
+
+    /* Pinned before the worker allocates anything, so its memory is first touched on its node */
+    static void tp_pool_worker_enter(tp_pool_worker *self)
+    {
+        if (self->cpu >= 0 && teapot_pin_current_thread(self->cpu) < 0)
+        {
+            self->cpu = -1;
+            tp_atomic_add(&self->pool->unpinned, 1);
+        }
+    }
+
+    static void tp_pool_worker_exit(void)
+    {
+        tp_io_buffer_pool_trim();
+        tp_thread_cache_trim();
+    }
+
+    TP_THREAD_FN(tp_pool_dispatched_worker, arg)
+    {
+        tp_pool_worker *self = (tp_pool_worker *)arg;
+        tp_pool *pool = self->pool;
+        tp_pool_worker_enter(self);
+        stb_teapot_socket_t client;
+        while (socket_ok(client = tp_socket_ring_pop(&pool->ring)))
+        {
+            teapot_handle_client_connection(pool->server, client); /* closes the socket */
+            tp_atomic_sub(&pool->in_service, 1);
+        }
+        tp_pool_worker_exit();
+        TP_THREAD_RETURN;
+    }
+
+    TP_THREAD_FN(tp_pool_accepting_worker, arg)
+    {
+        tp_pool_worker *self = (tp_pool_worker *)arg;
+        tp_pool *pool = self->pool;
+        tp_pool_worker_enter(self);
+        stb_teapot_socket_t client;
+        while (socket_ok(client = tp_pool_accept(pool, self->listener)))
+        {
+            tp_socket_set_nonblocking(client, 0); /* Winsock hands out the listener's mode */
+            teapot_handle_client_connection(pool->server, client);
+        }
+        tp_pool_worker_exit();
+        TP_THREAD_RETURN;
+    }
+
+    static void tp_pool_wake(tp_pool *pool)
+    {
+        tp_atomic_fence(); /* pairs with the one in tp_pool_stealing_worker() before it parks */
+        if (tp_atomic_load(&pool->sleepers) > 0)
+        {
+            tp_parking_post(&pool->parking, 1);
+        }
+    }
+
+    /* Any other worker's oldest connection, trying them from a random one */
+    static int tp_pool_steal(tp_pool_worker *self, stb_teapot_socket_t *socket)
+    {
+        tp_pool *pool = self->pool;
+        self->rng ^= self->rng << 13;
+        self->rng ^= self->rng >> 17;
+        self->rng ^= self->rng << 5;
+        size_t start = self->rng % pool->worker_count;
+        for (size_t i = 0; i < pool->worker_count; ++i)
+        {
+            tp_pool_worker *victim = &pool->workers[(start + i) % pool->worker_count];
+            if (victim != self && tp_deque_steal(&victim->deque, socket))
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    /* Waits for the listener, accepts a burst into our own deque and hands the lead over */
+    static void tp_pool_lead(tp_pool_worker *self)
+    {
+        tp_pool *pool = self->pool;
+        while (tp_atomic_load(&pool->server->stop) == 0)
+        {
+            if (tp_wait_readable(pool->listener, TP_POOL_POLL_MS) <= 0)
+            {
+                continue;
+            }
+            size_t accepted = 0;
+            stb_teapot_socket_t client;
+            while (accepted < TP_POOL_ACCEPT_BATCH && !tp_deque_full(&self->deque) &&
+                   socket_ok(client = teapot_listener_accept(pool->listener)))
+            {
+                tp_socket_set_nonblocking(client, 0); /* BSD sockets and Winsock inherit the listener's mode */
+                tp_deque_push(&self->deque, client);
+                tp_atomic_add(&pool->queued, 1);
+                ++accepted;
+            }
+            if (accepted > 0)
+            {
+                break;
+            }
+        }
+        tp_atomic_store_release(&pool->leader, 0);
+        tp_pool_wake(pool); /* someone takes the lead, or steals from the burst */
+    }
+
+    TP_THREAD_FN(tp_pool_stealing_worker, arg)
+    {
+        tp_pool_worker *self = (tp_pool_worker *)arg;
+        tp_pool *pool = self->pool;
+        tp_pool_worker_enter(self);
+        stb_teapot_socket_t client;
+        for (;;)
+        {
+            if (tp_deque_pop(&self->deque, &client) || tp_pool_steal(self, &client))
+            {
+                if (tp_atomic_sub(&pool->queued, 1) > 0)
+                {
+                    tp_pool_wake(pool); /* more for whoever is idle */
+                }
+                teapot_handle_client_connection(pool->server, client);
+                continue;
+            }
+            if (tp_atomic_load(&pool->server->stop) != 0)
+            {
+                if (tp_atomic_load(&pool->queued) == 0)
+                {
+                    break;
+                }
+                tp_thread_yield(); /* the rest is being taken */
+                continue;
+            }
+
+            size_t expected = 0;
+            if (tp_atomic_cas(&pool->leader, &expected, 1))
+            {
+                tp_pool_lead(self);
+                continue;
+            }
+
+            /* park until there is something to steal or the lead is free */
+            tp_atomic_add(&pool->sleepers, 1);
+            tp_atomic_fence();
+            if (tp_atomic_load(&pool->queued) == 0 && tp_atomic_load_acquire(&pool->leader) != 0 &&
+                tp_atomic_load(&pool->server->stop) == 0)
+            {
+                tp_parking_wait(&pool->parking);
+            }
+            tp_atomic_sub(&pool->sleepers, 1);
+        }
+        tp_parking_post(&pool->parking, pool->worker_count); /* the parked ones see the stop too */
+        tp_pool_worker_exit();
+        TP_THREAD_RETURN;
+    }
+
+    /* stop_on_signals: one pooled server at a time receives them */
+    static teapot_server *volatile tp_signal_server;
+
+#ifdef _WIN32
+    static BOOL WINAPI tp_console_handler(DWORD type)
+    {
+        if (type == CTRL_C_EVENT || type == CTRL_BREAK_EVENT || type == CTRL_CLOSE_EVENT)
+        {
+            teapot_server *server = tp_signal_server;
+            if (server != NULL)
+            {
+                teapot_server_stop(server);
+            }
+            return TRUE;
+        }
+        return FALSE;
+    }
+#else
+    static void tp_signal_handler(int sig)
+    {
+        (void)sig;
+        teapot_server *server = tp_signal_server;
+        if (server != NULL)
+        {
+            teapot_server_stop(server);
+        }
+    }
+#endif
+
+    int teapot_serve_pooled(teapot_server *server, int n_workers)
+    {
+        teapot_pool_options options;
+        memset(&options, 0, sizeof(options));
+        options.workers = n_workers;
+        options.accept = TEAPOT_ACCEPT_DISPATCHER;
+        options.stop_on_signals = 1;
+        return teapot_serve_pooled_ex(server, &options);
+    }
+
+    int teapot_serve_pooled_ex(teapot_server *server, const teapot_pool_options *options)
+    {
+        teapot_pool_options defaults;
+        memset(&defaults, 0, sizeof(defaults));
+        if (server == NULL)
+        {
+            return -1;
+        }
+        if (options == NULL)
+        {
+            options = &defaults;
+        }
+        int dispatch = options->accept == TEAPOT_ACCEPT_DISPATCHER;
+        int stealing = options->accept == TEAPOT_ACCEPT_WORK_STEALING;
+#ifdef TP_HAS_REUSEPORT
+        int sharded = options->accept == TEAPOT_ACCEPT_SHARDED;
+#else
+        int sharded = 0; /* TEAPOT_ACCEPT_WORKERS on the one listener */
+#endif
+        int worker_count = options->workers > 0 ? options->workers : teapot_cpu_count();
+
+        tp_pool pool;
+        memset(&pool, 0, sizeof(pool));
+        pool.server = server;
+        pool.listener = (stb_teapot_socket_t)-1;
+        if (!sharded && teapot_listener_open(server, &pool.listener) < 0)
+        {
+            return -1;
+        }
+
+        /* the pool's own memory comes from the server's allocator, once */
+        const tp_allocator *previous_allocator = tp_allocator_use(server->allocator);
+        tp_thread *threads = (tp_thread *)tp_realloc(NULL, (size_t)worker_count * sizeof(tp_thread));
+        pool.workers = (tp_pool_worker *)tp_realloc(NULL, (size_t)worker_count * sizeof(tp_pool_worker));
+        if (!TP_GREW(threads) || !TP_GREW(pool.workers))
+        {
+            tp_free(threads);
+            tp_free(pool.workers);
+            tp_allocator_use(previous_allocator);
+            if (!sharded)
+            {
+                teapot_close(pool.listener);
+            }
+            return -1;
+        }
+        memset(pool.workers, 0, (size_t)worker_count * sizeof(tp_pool_worker));
+        pool.worker_count = (size_t)worker_count;
+        int shards = 0;
+        for (int i = 0; i < worker_count; ++i)
+        {
+            tp_pool_worker *w = &pool.workers[i];
+            w->pool = &pool;
+            w->index = (size_t)i;
+            w->rng = 2654435761u * (uint32_t)(i + 1);
+            w->cpu = options->pin_workers ? tp_pool_cpu(i) : -1;
+            if (options->pin_workers && w->cpu < 0)
+            {
+                ++pool.unpinned; /* its shard takes any connection */
+            }
+            w->listener = pool.listener;
+            if (sharded && shards == i)
+            {
+                shards += tp_listener_open(server, w->cpu >= 0 ? w->cpu : -2, &w->listener) == 0;
+            }
+        }
+        int started = 0;
+        if (sharded && shards < worker_count)
+        {
+            worker_count = 0; /* the port is taken, or a shard couldn't bind to it */
+        }
+        if (dispatch)
+        {
+            pool.max_connections = options->max_connections ? options->max_connections : TP_POOL_MAX_CONNECTIONS;
+            if (tp_socket_ring_init(&pool.ring, pool.max_connections) < 0)
+            {
+                worker_count = 0;
+            }
+        }
+        else
+        {
+            /* workers that lose the race for a connection must not block in accept() */
+            for (int i = 0; i < shards; ++i)
+            {
+                tp_socket_set_nonblocking(pool.workers[i].listener, 1);
+            }
+            if (!sharded)
+            {
+                tp_socket_set_nonblocking(pool.listener, 1);
+            }
+        }
+        int parking = stealing && worker_count > 0 && tp_parking_init(&pool.parking) == 0;
+        if (stealing && !parking)
+        {
+            worker_count = 0;
+        }
+        tp_allocator_use(previous_allocator);
+
+        tp_thread_fn worker = dispatch ? tp_pool_dispatched_worker
+                              : stealing ? tp_pool_stealing_worker
+                                         : tp_pool_accepting_worker;
+        for (int i = 0; i < worker_count; ++i)
+        {
+            if (tp_thread_start(&threads[started], worker, &pool.workers[i]) == 0)
+            {
+                ++started;
+            }
+        }
+
+#ifdef _WIN32
+        if (options->stop_on_signals)
+        {
+            tp_signal_server = server;
+            SetConsoleCtrlHandler(tp_console_handler, TRUE);
+        }
+#else
+        void (*previous_sigint)(int) = SIG_DFL;
+        void (*previous_sigterm)(int) = SIG_DFL;
+        if (options->stop_on_signals)
+        {
+            tp_signal_server = server;
+            previous_sigint = signal(SIGINT, tp_signal_handler);
+            previous_sigterm = signal(SIGTERM, tp_signal_handler);
+        }
+#endif
+
+        if (started == 0)
+        {
+            teapot_server_stop(server);
+        }
+        else if (dispatch)
+        {
+            stb_teapot_socket_t client;
+            while (socket_ok(client = tp_pool_accept(&pool, pool.listener)))
+            {
+                if (tp_atomic_add(&pool.in_service, 1) > pool.max_connections ||
+                    tp_socket_ring_push(&pool.ring, client) < 0)
+                {
+                    /* every worker is busy with enough already: shed rather than queue without bound */
+                    tp_atomic_sub(&pool.in_service, 1);
+                    tp_send_refusal(client, 503);
+                    teapot_close(client);
+                }
+            }
+        }
+
+        /* accepted connections are still served before the workers exit */
+        if (dispatch)
+        {
+            tp_socket_ring_close(&pool.ring, (size_t)started);
+        }
+        for (int i = 0; i < started; ++i)
+        {
+            tp_thread_join(threads[i]);
+        }
+
+        if (options->stop_on_signals)
+        {
+#ifdef _WIN32
+            SetConsoleCtrlHandler(tp_console_handler, FALSE);
+#else
+            signal(SIGINT, previous_sigint);
+            signal(SIGTERM, previous_sigterm);
+#endif
+            tp_signal_server = NULL;
+        }
+
+        previous_allocator = tp_allocator_use(server->allocator);
+        if (dispatch)
+        {
+            tp_socket_ring_destroy(&pool.ring);
+        }
+        if (parking)
+        {
+            tp_parking_destroy(&pool.parking);
+        }
+        for (int i = 0; i < shards; ++i)
+        {
+            teapot_close(pool.workers[i].listener);
+        }
+        tp_free(pool.workers);
+        tp_free(threads);
+        tp_allocator_use(previous_allocator);
+        if (!sharded)
+        {
+            teapot_close(pool.listener);
+        }
+        tp_atomic_sub(&server->stop, tp_atomic_load(&server->stop)); /* ready to serve again */
+        if (started == 0)
+        {
+            return -1;
+        }
+        return tp_atomic_load(&pool.unpinned) > 0 ? 1 : 0;
     }
 
 #endif // STB_TEAPOT_IMPLEMENTATION
@@ -998,4 +6629,269 @@ int socket_ok(stb_teapot_socket_t s);
 #ifdef __cplusplus
 }
 #endif
+
+// =====================================================
+// ⚙️ C++ Compile-Time Routing (C++17 and later)
+// =====================================================
+// Routes declared as template arguments are matched by code generated for that exact route set.
+// The path length is compared against each distinct route length, a chain of constants the
+// compiler lowers to a switch; each case only holds the routes of that length and compares them
+// by method and by a fixed-width comparison against the constant path (a few word compares),
+// then calls the handler directly. There is no indirect call and no strcmp/strlen over the set.
+//
+//     static constexpr char hello_path[] = "/hello";
+//     using app = teapot::router<
+//         teapot::route<TEAPOT_GET, hello_path, hello_handler>, // C++17
+//         teapot::post<"/echo", echo_handler>>;                 // C++20
+//
+//     server.dispatch = app::dispatch; // unmatched requests continue to the C route tables
+//
+// Define TP_NO_CPP_ROUTER to leave this section out.
+#if defined(__cplusplus) && !defined(TP_NO_CPP_ROUTER) && \
+    (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+
+#include <utility>
+
+namespace teapot
+{
+    namespace detail
+    {
+        constexpr size_t cstr_len(const char *s)
+        {
+            size_t n = 0;
+            while (s[n] != '\0')
+            {
+                ++n;
+            }
+            return n;
+        }
+
+        constexpr bool same_route(teapot_method ma, const char *a, size_t alen, teapot_method mb, const char *b, size_t blen)
+        {
+            if (ma != mb || alen != blen)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < alen; ++i)
+            {
+                if (a[i] != b[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        struct route_key
+        {
+            teapot_method method;
+            const char *path;
+            size_t size;
+        };
+
+        template <class... Routes>
+        constexpr bool unique_routes()
+        {
+            if constexpr (sizeof...(Routes) > 1)
+            {
+                const route_key keys[] = {{Routes::method, Routes::path, Routes::size}...};
+                for (size_t i = 0; i < sizeof...(Routes); ++i)
+                {
+                    for (size_t j = i + 1; j < sizeof...(Routes); ++j)
+                    {
+                        if (same_route(keys[i].method, keys[i].path, keys[i].size, keys[j].method, keys[j].path, keys[j].size))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Path length of the I-th route
+        template <size_t I, class... Routes>
+        constexpr size_t route_size()
+        {
+            const size_t sizes[] = {Routes::size...};
+            return sizes[I];
+        }
+
+        // Whether no route before the I-th has the same path length
+        template <size_t I, class... Routes>
+        constexpr bool first_of_its_size()
+        {
+            const size_t sizes[] = {Routes::size...};
+            for (size_t j = 0; j < I; ++j)
+            {
+                if (sizes[j] == sizes[I])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Route R if its path is 'Len' long, nothing otherwise (resolved at compile time)
+        template <size_t Len, class R>
+        inline bool try_route(const teapot_request *req, teapot_response *out, const char *p, teapot_method m)
+        {
+            if constexpr (R::size == Len)
+            {
+                if (R::match(m, p, Len))
+                {
+                    *out = R::call(req);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Length of the request path without the query string
+        inline size_t request_path_len(const teapot_request *req)
+        {
+            const char *p = req->path.items;
+            size_t n = 0;
+            while (p[n] != '\0' && p[n] != '?')
+            {
+                ++n;
+            }
+            return n;
+        }
+
+        // 'PathT' provides the constant path as 'PathT::value' (NUL-terminated) and 'PathT::size'
+        template <teapot_method Method, class PathT, auto Handler>
+        struct route_impl
+        {
+            static_assert(Method < TEAPOT_UNKNOWN, "unsupported route method");
+            static_assert(PathT::size > 0 && PathT::value[0] == '/', "route paths must start with '/'");
+
+            static constexpr teapot_method method = Method;
+            static constexpr const char *path = PathT::value;
+            static constexpr size_t size = PathT::size;
+
+            static bool match(teapot_method m, const char *p, size_t len)
+            {
+                return m == Method && len == size && memcmp(p, path, size) == 0;
+            }
+
+            static teapot_response call(const teapot_request *req)
+            {
+                return Handler(req);
+            }
+        };
+
+        template <const char *Path>
+        struct static_path
+        {
+            static constexpr const char *value = Path;
+            static constexpr size_t size = cstr_len(Path);
+        };
+    } // namespace detail
+
+    // C++17 route: 'Path' must point to a constexpr char array with static storage duration.
+    template <teapot_method Method, const char *Path, auto Handler>
+    struct route : detail::route_impl<Method, detail::static_path<Path>, Handler>
+    {
+    };
+
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+    // String literal usable as a template argument (C++20)
+    template <size_t N>
+    struct fixed_string
+    {
+        char data[N] = {};
+
+        constexpr fixed_string(const char (&s)[N])
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                data[i] = s[i];
+            }
+        }
+    };
+
+    namespace detail
+    {
+        template <fixed_string Path>
+        struct literal_path
+        {
+            static constexpr const char *value = Path.data;
+            static constexpr size_t size = sizeof(Path.data) - 1;
+        };
+    } // namespace detail
+
+    template <teapot_method Method, fixed_string Path, auto Handler>
+    struct route_s : detail::route_impl<Method, detail::literal_path<Path>, Handler>
+    {
+    };
+
+    template <fixed_string Path, auto Handler>
+    using get = route_s<TEAPOT_GET, Path, Handler>;
+
+    template <fixed_string Path, auto Handler>
+    using post = route_s<TEAPOT_POST, Path, Handler>;
+#endif
+
+    template <class... Routes>
+    struct router
+    {
+        static_assert(detail::unique_routes<Routes...>(), "duplicate (method, path) in teapot::router");
+
+      private:
+        // The routes whose path is 'Len' long
+        template <size_t Len>
+        static int bucket(const teapot_request *req, teapot_response *out, const char *p, teapot_method m)
+        {
+            return (detail::try_route<Len, Routes>(req, out, p, m) || ...) ? 1 : 0;
+        }
+
+        // The bucket of the I-th route's length if 'len' is that length; only the first route of
+        // each length generates a case
+        template <size_t I>
+        static int length_case(const teapot_request *req, teapot_response *out, const char *p, teapot_method m,
+                               size_t len)
+        {
+            if constexpr (detail::first_of_its_size<I, Routes...>())
+            {
+                constexpr size_t size = detail::route_size<I, Routes...>();
+                if (len == size)
+                {
+                    return bucket<size>(req, out, p, m);
+                }
+            }
+            return 0;
+        }
+
+        template <size_t... Is>
+        static int match(const teapot_request *req, teapot_response *out, const char *p, teapot_method m,
+                         size_t len, std::index_sequence<Is...>)
+        {
+            return (length_case<Is>(req, out, p, m, len) || ...) ? 1 : 0;
+        }
+
+      public:
+        // Matches teapot_dispatch_fn, so it can be installed as teapot_server::dispatch
+        static int dispatch(const teapot_request *req, teapot_response *out)
+        {
+            if (req == nullptr || out == nullptr || req->path.items == nullptr)
+            {
+                return 0;
+            }
+
+            const size_t len = detail::request_path_len(req);
+            const char *p = req->path.items;
+            if (match(req, out, p, req->method, len, std::index_sequence_for<Routes...>()))
+            {
+                return 1;
+            }
+            /* HEAD falls back to the GET route, like the C router */
+            return req->method == TEAPOT_HEAD ? match(req, out, p, TEAPOT_GET, len, std::index_sequence_for<Routes...>())
+                                              : 0;
+        }
+    };
+} // namespace teapot
+
+#endif // C++17
+
 #endif // STB_TEAPOT_H
@@ -0,0 +1,51 @@
+#ifndef TEST_SERVE_H
+#define TEST_SERVE_H
+
+/*
+ * Socket pair fixtures shared by the unit tests that drive a connection (POSIX only). Include it
+ * after stb_teapot.h and the test's ok() helper.
+ */
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* A connected pair of stream sockets. A failure is reported through ok() and returns -1. */
+static int socket_pair(int sv[2])
+{
+    int made = socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0;
+    if (!made)
+        ok("socket pair", 0);
+    return made ? 0 : -1;
+}
+
+/* Read 'fd' until the peer closes, then close it. 'out' is NUL-terminated; the NULs the bodies go
+   out with become '.' so the answer can be searched as a string. Returns the bytes read. */
+static size_t recv_all(int fd, char *out, size_t out_size)
+{
+    size_t got = 0;
+    ssize_t r;
+    while (got + 1 < out_size && (r = recv(fd, out + got, out_size - 1 - got, 0)) > 0)
+        got += (size_t)r;
+    for (size_t i = 0; i < got; ++i)
+        if (out[i] == '\0')
+            out[i] = '.';
+    out[got] = '\0';
+    close(fd);
+    return got;
+}
+
+/* Serve 'request' on one end of a socket pair and return what the server answered */
+static size_t serve(teapot_server *server, const char *request, char *response, size_t response_size)
+{
+    int sv[2];
+    if (socket_pair(sv) < 0)
+    {
+        response[0] = '\0';
+        return 0;
+    }
+    send(sv[0], request, strlen(request), 0);
+    shutdown(sv[0], SHUT_WR);
+    teapot_handle_client_connection(server, sv[1]); /* closes sv[1] */
+    return recv_all(sv[0], response, response_size);
+}
+
+#endif
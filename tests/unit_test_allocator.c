@@ -0,0 +1,275 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static teapot_response h_ok(const teapot_request *req)
+{
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    tp_sb_appendf(&resp.body, "hello %s", req->path.items);
+    return resp;
+}
+
+/* body capacity each /grow request found in its fresh response */
+static size_t grow_capacities[4];
+static size_t grow_calls;
+
+static teapot_response h_grow(const teapot_request *req)
+{
+    (void)req;
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    if (grow_calls < 4)
+        grow_capacities[grow_calls] = resp.body.capacity;
+    ++grow_calls;
+    for (int i = 0; i < 200; ++i)
+        tp_sb_append_cstr(&resp.body, "0123456789");
+    return resp;
+}
+
+static void test_current_allocator(void)
+{
+    tp_counting_allocator counter;
+    tp_counting_allocator_init(&counter, NULL);
+
+    ok("no allocator by default", tp_allocator_use(&counter.allocator) == NULL);
+    tp_string_builder sb = {0};
+    tp_sb_append_cstr(&sb, "abc");
+    tp_sb_appendf(&sb, "%d", 42);
+    tp_sb_free(sb);
+
+    tp_counting_allocator inner;
+    tp_counting_allocator_init(&inner, NULL);
+    const tp_allocator *previous = tp_allocator_use(&inner.allocator);
+    ok("use returns the previous allocator", previous == &counter.allocator);
+    void *p = tp_realloc(NULL, 10);
+    tp_free(p);
+    tp_allocator_use(previous);
+    ok("nested allocator counted separately", inner.allocs == 1 && inner.frees == 1 && counter.allocs == 1);
+
+    tp_allocator_use(NULL);
+    ok("dynamic arrays go through the current allocator", counter.allocs == 1 && counter.frees == 1);
+    ok("bytes tracked", counter.bytes_live == 0 && counter.bytes_peak == TP_DA_INIT_CAP);
+}
+
+static void test_counting_realloc(void)
+{
+    tp_counting_allocator counter;
+    tp_counting_allocator_init(&counter, NULL);
+    tp_allocator_use(&counter.allocator);
+
+    char *p = (char *)tp_realloc(NULL, 100);
+    memset(p, 'x', 100);
+    p = (char *)tp_realloc(p, 1000);
+    ok("realloc keeps content", p[99] == 'x');
+    ok("realloc counted", counter.allocs == 1 && counter.reallocs == 1 && counter.bytes_live == 1000 &&
+                              counter.bytes_total == 1100);
+    tp_free(p);
+    ok("free counted", counter.frees == 1 && counter.bytes_live == 0 && counter.bytes_peak == 1000);
+
+    tp_allocator_use(NULL);
+}
+
+static void test_thread_cache(void)
+{
+    tp_allocator_use(&tp_thread_cache_allocator);
+
+    char *a = (char *)tp_realloc(NULL, 20);
+    memcpy(a, "cached", 7);
+    char *same = (char *)tp_realloc(a, 30);
+    ok("growing within the size class keeps the block", same == a);
+    char *bigger = (char *)tp_realloc(a, 100);
+    ok("growing past the class moves the content", bigger != a && strcmp(bigger, "cached") == 0);
+    ok("freed block is reused LIFO", tp_realloc(NULL, 17) == a);
+    tp_free(a);
+    tp_free(bigger);
+
+    char *large = (char *)tp_realloc(NULL, 100 * 1024);
+    large[100 * 1024 - 1] = 'z';
+    large = (char *)tp_realloc(large, 200 * 1024);
+    ok("large blocks bypass the cache", large != NULL && large[100 * 1024 - 1] == 'z');
+    tp_free(large);
+
+    tp_allocator_use(NULL);
+    tp_thread_cache_trim();
+}
+
+static void test_server_allocator(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/a", h_ok},
+        {TEAPOT_GET, "/users/:id", h_ok},
+    };
+
+    tp_counting_allocator counter;
+    tp_counting_allocator_init(&counter, &tp_thread_cache_allocator);
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = sizeof(routes) / sizeof(routes[0]);
+    server.allocator = &counter.allocator;
+
+    ok("build", teapot_server_build(&server) == 0);
+    ok("router built with the server's allocator", counter.allocs > 0 && counter.bytes_live > 0);
+    ok("allocator only current while building", tp_allocator_use(NULL) == NULL);
+
+    teapot_server_free(&server);
+    ok("everything returned on free", counter.bytes_live == 0 && counter.frees == counter.allocs);
+    tp_thread_cache_trim();
+}
+
+static void test_response_buffers(void)
+{
+    tp_response_buffers buffers;
+    memset(&buffers, 0, sizeof(buffers));
+    tp_response_buffers_use(&buffers);
+
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    ok("first response starts empty", resp.body.items == NULL && resp.body.capacity == 0);
+    tp_sb_append_cstr(&resp.body, "hello");
+    teapot_response_add_header(&resp, "X-A", "b");
+    char *body = resp.body.items;
+    tp_response_buffers_recycle(&buffers, &resp);
+    ok("recycled response is emptied", resp.body.items == NULL && resp.headers.items == NULL);
+
+    teapot_response_init(&resp, 200);
+    ok("next response reuses the buffer", resp.body.items == body && resp.body.count == 0 && resp.body.capacity > 0);
+    ok("header buffer reused too", resp.headers.capacity > 0 && resp.headers.count == 0);
+
+    teapot_response other;
+    teapot_response_init(&other, 200);
+    ok("a second live response gets fresh buffers", other.body.capacity == 0);
+    tp_sb_append_cstr(&other.body, "x");
+    tp_response_buffers_recycle(&buffers, &other);
+    tp_response_buffers_recycle(&buffers, &resp);
+    ok("only one buffer kept per slot", buffers.body.items != body && buffers.body.capacity > 0);
+
+    teapot_response_init(&resp, 200);
+    tp_da_reserve(&resp.body, (size_t)TP_RESPONSE_BUFFER_HIGH_WATER + 1);
+    tp_response_buffers_recycle(&buffers, &resp);
+    ok("oversized buffer shrunk on recycle", buffers.body.capacity == TP_RESPONSE_BUFFER_SHRINK_TO);
+
+    tp_response_buffers_use(NULL);
+    teapot_response_init(&resp, 200);
+    ok("no buffers outside a connection", resp.body.capacity == 0 && resp.headers.capacity == 0);
+    tp_response_buffers_free(&buffers);
+}
+
+#ifndef _WIN32
+#include "serve.h"
+
+static void test_keep_alive_reuse(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/grow", h_grow},
+    };
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = sizeof(routes) / sizeof(routes[0]);
+    server.keep_alive = 1;
+    teapot_server_build(&server);
+
+    static const char requests[] = "GET /grow HTTP/1.1\r\nHost: a\r\n\r\n"
+                                   "GET /grow HTTP/1.1\r\nHost: a\r\n\r\n"
+                                   "GET /grow HTTP/1.1\r\nHost: a\r\nConnection: close\r\n\r\n";
+    static char wire[16384];
+    serve(&server, requests, wire, sizeof(wire));
+
+    ok("three keep-alive requests served", grow_calls == 3);
+    ok("first request grows its body from scratch", grow_capacities[0] == 0);
+    ok("later requests reuse the grown body", grow_capacities[1] >= 2000 && grow_capacities[2] >= 2000);
+    teapot_server_free(&server);
+}
+
+/* a dispatch hook that replaces the response it is handed, as the C++ router does */
+static int hook_grow(const teapot_request *req, teapot_response *out)
+{
+    if (strcmp(req->path.items, "/grow") != 0)
+        return 0;
+    *out = h_grow(req);
+    return 1;
+}
+
+static void test_keep_alive_dispatch_hook(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/a", h_ok},
+    };
+
+    tp_counting_allocator counter;
+    tp_counting_allocator_init(&counter, NULL);
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = sizeof(routes) / sizeof(routes[0]);
+    server.dispatch = hook_grow;
+    server.allocator = &counter.allocator;
+    server.keep_alive = 1;
+    teapot_server_build(&server);
+
+    static const char requests[] = "GET /grow HTTP/1.1\r\nHost: a\r\n\r\n"
+                                   "GET /a HTTP/1.1\r\nHost: a\r\n\r\n"
+                                   "GET /grow HTTP/1.1\r\nHost: a\r\n\r\n"
+                                   "GET /grow HTTP/1.1\r\nHost: a\r\nConnection: close\r\n\r\n";
+    grow_calls = 0;
+    memset(grow_capacities, 0, sizeof(grow_capacities));
+    static char wire[16384];
+    size_t got = serve(&server, requests, wire, sizeof(wire));
+
+    size_t answers = 0;
+    for (size_t i = 0; i + 9 <= got; ++i)
+        if (memcmp(wire + i, "HTTP/1.1 ", 9) == 0)
+            ++answers;
+    ok("hook and route table answer on one connection", grow_calls == 3 && answers == 4);
+    ok("responses built by the hook reuse the grown body", grow_capacities[1] >= 2000 && grow_capacities[2] >= 2000);
+    teapot_server_free(&server);
+    ok("no buffer lost to the hook", counter.bytes_live == 0 && counter.frees == counter.allocs);
+}
+#endif
+
+int main(void)
+{
+    printf("Running allocator unit tests...\n\n");
+
+    test_current_allocator();
+    test_counting_realloc();
+    test_thread_cache();
+    test_server_allocator();
+    test_response_buffers();
+#ifndef _WIN32
+    test_keep_alive_reuse();
+    test_keep_alive_dispatch_hook();
+#endif
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
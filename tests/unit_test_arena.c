@@ -0,0 +1,141 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static void test_alloc_and_reset(void)
+{
+    tp_arena arena = {0};
+
+    char *a = (char *)tp_arena_alloc(&arena, 3);
+    char *b = (char *)tp_arena_alloc(&arena, 5);
+    ok("allocations are aligned", ((uintptr_t)a % 16) == 0 && ((uintptr_t)b % 16) == 0);
+    ok("allocations don't overlap", b >= a + 3);
+
+    char *big = (char *)tp_arena_alloc(&arena, TP_ARENA_BLOCK_SIZE * 2);
+    memset(big, 'x', TP_ARENA_BLOCK_SIZE * 2);
+    ok("oversized allocation gets its own block", arena.first->next != NULL);
+
+    tp_arena_block *first = arena.first;
+    tp_arena_reset(&arena);
+    ok("reset keeps the first block", arena.first == first && arena.current == first && first->next == NULL);
+    ok("first block is reused", tp_arena_alloc(&arena, 3) == a);
+
+    char *s = tp_arena_strndup(&arena, "hello world", 5);
+    ok("strndup", strcmp(s, "hello") == 0);
+
+    tp_arena_free(&arena);
+    ok("free releases everything", arena.first == NULL && arena.current == NULL);
+}
+
+static void test_borrowed_builders(void)
+{
+    tp_arena arena = {0};
+    tp_string_builder sb = {0};
+    sb.items = tp_arena_strndup(&arena, "abc", 3);
+    sb.count = 3;
+
+    char *borrowed = sb.items;
+    tp_sb_append_cstr(&sb, "def");
+    tp_sb_append_null(&sb);
+    ok("growing a borrowed builder moves it to the heap", sb.items != borrowed && sb.capacity > 0);
+    ok("content is kept", strcmp(sb.items, "abcdef") == 0);
+    ok("arena copy untouched", strcmp(borrowed, "abc") == 0);
+    tp_sb_free(sb);
+
+    tp_string_builder view = {0};
+    view.items = borrowed;
+    view.count = 4;
+    tp_sb_free(view); /* no-op: must not free arena memory */
+    ok("freeing a borrowed builder is a no-op", strcmp(view.items, "abc") == 0);
+
+    tp_arena_free(&arena);
+}
+
+static void test_request_in_arena(void)
+{
+    char raw[] = "POST /echo?x=1 HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "Content-Type: text/plain\r\n"
+                 "Content-Length: 5\r\n"
+                 "\r\n"
+                 "hello";
+
+    tp_arena arena = {0};
+    teapot_request req;
+    memset(&req, 0, sizeof(req));
+    req.arena = &arena;
+    ok("parse", parse_request(raw, strlen(raw), &req) == 0);
+
+    ok("path borrowed from arena", strcmp(req.path.items, "/echo?x=1") == 0 && req.path.capacity == 0);
+    ok("body borrowed from arena", strcmp(req.body.items, "hello") == 0 && req.body_length == 5);
+    ok("headers borrowed from arena", req.headers.count == 3 && req.headers.capacity == 0);
+    ok("header lookup", tp_headers_match(&req.headers, "content-type", "text/plain") == 1);
+    ok("Host slot", strcmp(tp_headers_known(&req.headers, TP_HEADER_HOST)->items, "example.com") == 0);
+    ok("lines are a view of the header block",
+       req.headers.block.count == 3 && !req.headers.block.owned &&
+           tp_headers_get(&req.headers, "CONTENT-LENGTH")->items == tp_header_block_known(&req.headers.block, TP_HEADER_CONTENT_LENGTH).items);
+    ok("HTTP/1.1 is persistent", req.keep_alive == 1);
+
+    char *scratch = (char *)teapot_request_alloc(&req, 32);
+    ok("handlers allocate from the request arena", scratch != NULL);
+
+    tp_arena_block *first = arena.first;
+    free_request(&req);
+    tp_arena_reset(&arena);
+
+    /* the next request on the connection reuses the same block */
+    char raw2[] = "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n";
+    memset(&req, 0, sizeof(req));
+    req.arena = &arena;
+    parse_request(raw2, strlen(raw2), &req);
+    ok("keep-alive request reuses the first block", arena.first == first && first->next == NULL);
+    ok("HTTP/1.0 keep-alive on request", req.keep_alive == 1);
+    free_request(&req);
+    tp_arena_reset(&arena);
+
+    char raw3[] = "GET / HTTP/1.1\r\nConnection: close\r\nContent-Length: 100\r\n\r\nabc";
+    memset(&req, 0, sizeof(req));
+    req.arena = &arena;
+    parse_request(raw3, strlen(raw3), &req);
+    ok("Connection: close", req.keep_alive == 0);
+    ok("body clamped to received bytes", req.body_length == 3 && strcmp(req.body.items, "abc") == 0);
+    free_request(&req);
+
+    tp_arena_free(&arena);
+}
+
+int main(void)
+{
+    printf("Running arena unit tests...\n\n");
+
+    test_alloc_and_reset();
+    test_borrowed_builders();
+    test_request_in_arena();
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
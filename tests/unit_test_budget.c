@@ -0,0 +1,159 @@
+#define TP_BUDGET_WAIT_MS 50
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static size_t body_seen;
+
+static teapot_response h_upload(const teapot_request *req)
+{
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    body_seen = req->body_length;
+    /* some handler memory, charged to the connection too */
+    for (int i = 0; i < 100; ++i)
+        tp_sb_appendf(&resp.body, "line %d\n", i);
+    return resp;
+}
+
+static int big_calls;
+
+static teapot_response h_big(const teapot_request *req)
+{
+    (void)req;
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    ++big_calls;
+    /* more than the connection may hold */
+    for (int i = 0; i < 5000; ++i)
+        tp_sb_appendf(&resp.body, "line %d\n", i);
+    return resp;
+}
+
+static void test_charging(void)
+{
+    teapot_memory_budget budget;
+    memset(&budget, 0, sizeof(budget));
+    tp_conn_budget cb;
+    tp_conn_budget_init(&cb, &budget, NULL);
+
+    tp_allocator_use(&cb.allocator);
+    char *p = (char *)tp_realloc(NULL, 1000);
+    ok("allocation charged", cb.used == 1000 && teapot_memory_used(&budget) == 1000);
+    p = (char *)tp_realloc(p, 3000);
+    ok("growth charged", cb.used == 3000 && teapot_memory_used(&budget) == 3000);
+    tp_free(p);
+    tp_allocator_use(NULL);
+    ok("free uncharged", cb.used == 0 && teapot_memory_used(&budget) == 0 && budget.peak == 3000);
+
+    budget.connection_limit = 4096;
+    budget.global_limit = 10000;
+    ok("admit within limits", tp_budget_admit(&cb, 4096) == 0);
+    ok("413 past the connection limit", tp_budget_admit(&cb, 4097) == 413);
+    budget.used = 8000; /* other connections */
+    ok("503 past the global limit", tp_budget_admit(&cb, 4096) == 503);
+    ok("no backpressure below the limit", tp_budget_wait(&cb) == 0);
+    budget.used = 10000;
+    ok("backpressure gives up after the wait", tp_budget_wait(&cb) == -1);
+
+    /* handler memory is charged, never refused by the allocator */
+    budget.used = 0;
+    tp_allocator_use(&cb.allocator);
+    p = (char *)tp_realloc(NULL, 8000);
+    tp_allocator_use(NULL);
+    ok("allocation past the connection limit still served", p != NULL && cb.used == 8000);
+    ok("peak follows it", budget.peak == 8000);
+    tp_allocator_use(&cb.allocator);
+    tp_free(p);
+    tp_allocator_use(NULL);
+}
+
+#ifndef _WIN32
+#include "serve.h"
+
+static void test_server_budget(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_POST, "/upload", h_upload},
+        {TEAPOT_GET, "/big", h_big},
+    };
+
+    teapot_memory_budget budget;
+    memset(&budget, 0, sizeof(budget));
+    budget.connection_limit = 32 * 1024;
+    budget.global_limit = 1024 * 1024;
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = sizeof(routes) / sizeof(routes[0]);
+    server.budget = &budget;
+    teapot_server_build(&server);
+
+    static char response[16 * 1024];
+    char request[8192];
+    char body[6000];
+    memset(body, 'x', sizeof(body) - 1);
+    body[sizeof(body) - 1] = '\0';
+    snprintf(request, sizeof(request), "POST /upload HTTP/1.1\r\nContent-Length: %zu\r\n\r\n%s", strlen(body), body);
+    serve(&server, request, response, sizeof(response));
+    ok("request within budget served", strncmp(response, "HTTP/1.1 200", 12) == 0 && body_seen == strlen(body));
+    ok("everything uncharged after the connection", teapot_memory_used(&budget) == 0);
+    ok("peak recorded", budget.peak >= 16 * 1024);
+
+    body_seen = 0;
+    serve(&server, "POST /upload HTTP/1.1\r\nContent-Length: 50000\r\n\r\n", response, sizeof(response));
+    ok("413 before reading a body past the connection limit", strncmp(response, "HTTP/1.1 413", 12) == 0 && body_seen == 0);
+    ok("refusal counted", budget.rejected == 1 && teapot_memory_used(&budget) == 0);
+
+    budget.used = budget.global_limit; /* every byte taken by other connections */
+    serve(&server, "POST /upload HTTP/1.1\r\nContent-Length: 1\r\n\r\nx", response, sizeof(response));
+    ok("503 when the global budget stays exhausted", strncmp(response, "HTTP/1.1 503", 12) == 0 && body_seen == 0);
+    ok("503 counted", budget.rejected == 2);
+    budget.used = 0;
+
+    serve(&server, "GET /big HTTP/1.1\r\n\r\n", response, sizeof(response));
+    ok("503 when the handler goes past the connection limit", strncmp(response, "HTTP/1.1 503", 12) == 0 && big_calls == 1);
+    ok("its response not sent", strstr(response, "line 4999") == NULL);
+    ok("handler refusal counted", budget.rejected == 3 && teapot_memory_used(&budget) == 0);
+
+    teapot_server_free(&server);
+}
+#endif
+
+int main(void)
+{
+    printf("Running memory budget unit tests...\n\n");
+
+    test_charging();
+#ifndef _WIN32
+    test_server_budget();
+#endif
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
@@ -0,0 +1,106 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static void test_slabs(void)
+{
+    teapot_conn_table table;
+    ok("zero connections rejected", teapot_conn_table_init(&table, 0) == -1);
+
+    ok("init", teapot_conn_table_init(&table, TP_CONN_SLAB_SIZE + 1) == 0);
+    ok("rounded up to whole slabs", table.slab_count == 2 && table.capacity == 2 * TP_CONN_SLAB_SIZE);
+    ok("slot size is a multiple of a cache line", sizeof(tp_conn_slot) % TP_CACHE_LINE == 0);
+
+    int aligned = 1;
+    for (size_t s = 0; s < table.slab_count; ++s)
+        aligned &= ((uintptr_t)table.slabs[s].slots % TP_CACHE_LINE) == 0;
+    ok("slabs are cache-line aligned", aligned);
+
+    teapot_conn_table_free(&table);
+    ok("free", table.slabs == NULL && table.capacity == 0);
+}
+
+static void test_handles(void)
+{
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    teapot_conn_table table;
+    teapot_conn_table_init(&table, 4);
+
+    teapot_conn *a = teapot_conn_acquire(&table, &server, (stb_teapot_socket_t)7);
+    teapot_conn *b = teapot_conn_acquire(&table, &server, (stb_teapot_socket_t)8);
+    ok("acquire", a != NULL && b != NULL && a != b && table.live == 2);
+    ok("slot fields", a->socket == (stb_teapot_socket_t)7 && a->server == &server && a->next == NULL);
+    ok("handle resolves", teapot_conn_get(&table, a->handle) == a && teapot_conn_get(&table, b->handle) == b);
+    ok("zero handle never resolves", teapot_conn_get(&table, 0) == NULL);
+
+    teapot_conn_handle stale = a->handle;
+    ok("release", teapot_conn_release(&table, stale) == 0 && table.live == 1);
+    ok("released handle is stale", teapot_conn_get(&table, stale) == NULL);
+    ok("double release rejected", teapot_conn_release(&table, stale) == -1);
+
+    teapot_conn *c = teapot_conn_acquire(&table, &server, (stb_teapot_socket_t)9);
+    ok("last released slot is reused first", c == a);
+    ok("reused slot gets a new generation", c->handle != stale && teapot_conn_get(&table, stale) == NULL);
+    ok("new handle resolves", teapot_conn_get(&table, c->handle) == c);
+    ok("stale handle can't release the new owner", teapot_conn_release(&table, stale) == -1 && table.live == 2);
+
+    teapot_conn_release(&table, b->handle);
+    teapot_conn_release(&table, c->handle);
+    teapot_conn_table_free(&table);
+}
+
+static void test_full_table(void)
+{
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    teapot_conn_table table;
+    teapot_conn_table_init(&table, 1);
+
+    teapot_conn_handle handles[TP_CONN_SLAB_SIZE];
+    for (size_t i = 0; i < TP_CONN_SLAB_SIZE; ++i)
+        handles[i] = teapot_conn_acquire(&table, &server, (stb_teapot_socket_t)i)->handle;
+    ok("full table refuses", teapot_conn_acquire(&table, &server, (stb_teapot_socket_t)99) == NULL);
+
+    teapot_conn_release(&table, handles[3]);
+    teapot_conn *again = teapot_conn_acquire(&table, &server, (stb_teapot_socket_t)99);
+    ok("a released slot is available again", again != NULL && again->socket == (stb_teapot_socket_t)99);
+
+    teapot_conn_table_free(&table);
+}
+
+int main(void)
+{
+    printf("Running connection table unit tests...\n\n");
+
+    test_slabs();
+    test_handles();
+    test_full_table();
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
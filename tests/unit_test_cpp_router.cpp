@@ -0,0 +1,132 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static teapot_response with_status(int status)
+{
+    teapot_response resp;
+    teapot_response_init(&resp, status);
+    return resp;
+}
+
+static teapot_response hello(const teapot_request *) { return with_status(201); }
+static teapot_response hello_post(const teapot_request *) { return with_status(202); }
+static teapot_response echo(const teapot_request *) { return with_status(203); }
+static teapot_response from_c_router(const teapot_request *) { return with_status(204); }
+
+static constexpr char hello_path[] = "/hello";
+static constexpr char echo_path[] = "/echo";
+
+#if __cplusplus >= 202002L
+using app = teapot::router<
+    teapot::route<TEAPOT_GET, hello_path, hello>,
+    teapot::post<"/hello", hello_post>,
+    teapot::route<TEAPOT_POST, echo_path, echo>>;
+#else
+using app = teapot::router<
+    teapot::route<TEAPOT_GET, hello_path, hello>,
+    teapot::route<TEAPOT_POST, hello_path, hello_post>,
+    teapot::route<TEAPOT_POST, echo_path, echo>>;
+#endif
+
+static_assert(teapot::detail::unique_routes<teapot::route<TEAPOT_GET, hello_path, hello>,
+                                            teapot::route<TEAPOT_POST, hello_path, hello_post>>(),
+              "same path, different methods is fine");
+static_assert(!teapot::detail::unique_routes<teapot::route<TEAPOT_GET, hello_path, hello>,
+                                             teapot::route<TEAPOT_GET, hello_path, hello_post>>(),
+              "duplicates are detected at compile time");
+
+static teapot_request make_request(teapot_method method, const char *path)
+{
+    teapot_request req;
+    memset(&req, 0, sizeof(req));
+    req.method = method;
+    tp_sb_append_cstr(&req.path, path);
+    tp_sb_append_null(&req.path);
+    return req;
+}
+
+static int dispatch_status(teapot_method method, const char *path)
+{
+    teapot_request req = make_request(method, path);
+    teapot_response resp = with_status(0);
+    int status = app::dispatch(&req, &resp) ? resp.status : -1;
+    tp_sb_free(req.path);
+    return status;
+}
+
+static void test_compile_time_dispatch(void)
+{
+    ok("GET /hello", dispatch_status(TEAPOT_GET, "/hello") == 201);
+    ok("POST /hello", dispatch_status(TEAPOT_POST, "/hello") == 202);
+    ok("POST /echo", dispatch_status(TEAPOT_POST, "/echo") == 203);
+    ok("query string ignored", dispatch_status(TEAPOT_GET, "/hello?a=b") == 201);
+    ok("GET /echo not matched", dispatch_status(TEAPOT_GET, "/echo") == -1);
+    ok("GET /hell not matched", dispatch_status(TEAPOT_GET, "/hell") == -1);
+    ok("GET /hello/ not matched", dispatch_status(TEAPOT_GET, "/hello/") == -1);
+    ok("same length, other path", dispatch_status(TEAPOT_GET, "/hellx") == -1);
+    ok("longer than every route", dispatch_status(TEAPOT_GET, "/a/much/longer/path") == -1);
+    ok("empty path", dispatch_status(TEAPOT_GET, "") == -1);
+}
+
+static void test_server_interop(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/c-only", from_c_router},
+        {TEAPOT_GET, "/hello", from_c_router},
+    };
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = sizeof(routes) / sizeof(routes[0]);
+    server.dispatch = app::dispatch;
+    ok("server build", teapot_server_build(&server) == 0);
+
+    teapot_request req = make_request(TEAPOT_GET, "/hello");
+    teapot_response resp = teapot_dispatch(&server, &req);
+    ok("C++ routes are tried first", resp.status == 201);
+    tp_sb_free(req.path);
+
+    req = make_request(TEAPOT_GET, "/c-only");
+    resp = teapot_dispatch(&server, &req);
+    ok("unmatched requests reach the C router", resp.status == 204);
+    tp_sb_free(req.path);
+
+    teapot_server_free(&server);
+}
+
+int main(void)
+{
+    printf("Running C++ router unit tests...\n\n");
+
+    test_compile_time_dispatch();
+    test_server_interop();
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
@@ -0,0 +1,201 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static int sb_eq(const tp_string_builder *sb, const char *expected)
+{
+    return sb->count == strlen(expected) && memcmp(sb->items, expected, sb->count) == 0;
+}
+
+static void test_appendf(void)
+{
+    tp_counting_allocator counter;
+    tp_counting_allocator_init(&counter, NULL);
+    const tp_allocator *previous = tp_allocator_use(&counter.allocator);
+
+    tp_string_builder sb = {0};
+    tp_sb_appendf(&sb, "%s=%d", "answer", 42);
+    ok("appendf into an empty builder", sb_eq(&sb, "answer=42"));
+
+    size_t allocs = counter.allocs + counter.reallocs;
+    tp_sb_appendf(&sb, ", %s", "more");
+    ok("appendf into spare capacity", sb_eq(&sb, "answer=42, more"));
+    ok("no allocation when the output fits", counter.allocs + counter.reallocs == allocs);
+
+    char big[300];
+    memset(big, 'y', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    int n = tp_sb_appendf(&sb, "[%s]", big);
+    ok("appendf returns the formatted length", n == (int)sizeof(big) + 1);
+    ok("appendf past the capacity grows once", sb.count == 15 + sizeof(big) + 1 && sb.capacity > sb.count &&
+                                                    sb.items[15] == '[' && sb.items[sb.count - 1] == ']');
+    tp_sb_free(sb);
+
+    /* borrowed builders are never written in place */
+    char borrowed[32] = "abc";
+    tp_string_builder view = {borrowed, 3, 0};
+    tp_sb_appendf(&view, "%d", 7);
+    ok("appendf copies a borrowed builder out", view.items != borrowed && sb_eq(&view, "abc7"));
+    ok("borrowed storage untouched", strcmp(borrowed, "abc") == 0);
+    tp_sb_free(view);
+
+    tp_allocator_use(previous);
+}
+
+static void test_integers(void)
+{
+    char digits[TP_U64_DIGITS_MAX];
+    static const uint64_t values[] = {0, 7, 9, 10, 42, 99, 100, 101, 999, 1000, 65535, 1234567890,
+                                      4294967296ull, 10000000000000000000ull, UINT64_MAX};
+    int all_match = 1;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%llu", (unsigned long long)values[i]);
+        size_t len = tp_format_u64(digits, values[i]);
+        if (len != strlen(expected) || memcmp(digits, expected, len) != 0)
+            all_match = 0;
+    }
+    ok("tp_format_u64 matches printf", all_match);
+
+    tp_string_builder sb = {0};
+    tp_sb_append_u64(&sb, 0);
+    tp_sb_append_buf(&sb, " ", 1);
+    tp_sb_append_u64(&sb, UINT64_MAX);
+    ok("append_u64", sb_eq(&sb, "0 18446744073709551615"));
+    sb.count = 0;
+
+    tp_sb_append_i64(&sb, -1);
+    tp_sb_append_buf(&sb, " ", 1);
+    tp_sb_append_i64(&sb, INT64_MIN);
+    tp_sb_append_buf(&sb, " ", 1);
+    tp_sb_append_i64(&sb, INT64_MAX);
+    ok("append_i64 handles the extremes", sb_eq(&sb, "-1 -9223372036854775808 9223372036854775807"));
+    sb.count = 0;
+
+    tp_sb_append_hex(&sb, 0);
+    tp_sb_append_buf(&sb, " ", 1);
+    tp_sb_append_hex(&sb, 0x1f40);
+    tp_sb_append_buf(&sb, " ", 1);
+    tp_sb_append_hex(&sb, UINT64_MAX);
+    ok("append_hex", sb_eq(&sb, "0 1f40 ffffffffffffffff"));
+    tp_sb_free(sb);
+}
+
+#ifndef _WIN32
+#include "serve.h"
+
+/* What teapot_send_response() puts on the wire */
+static size_t sent(const teapot_response *resp, char *out, size_t out_size)
+{
+    int sv[2];
+    if (socket_pair(sv) < 0)
+    {
+        out[0] = '\0';
+        return 0;
+    }
+    teapot_send_response(sv[1], resp);
+    close(sv[1]);
+    return recv_all(sv[0], out, out_size);
+}
+
+static void test_send_response(void)
+{
+    static char wire[8192];
+
+    teapot_response resp = {0};
+    resp.status = 200;
+    tp_sb_append_cstr(&resp.body, "hello\n");
+    teapot_response_add_header(&resp, "X-Test", "1");
+    sent(&resp, wire, sizeof(wire));
+    ok("status line and Content-Length",
+       strcmp(wire, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 6\r\nX-Test: 1\r\n\r\nhello\n") == 0);
+
+    resp.body.count = 0;
+    for (int i = 0; i < 1234; ++i)
+        tp_sb_append_buf(&resp.body, "z", 1);
+    size_t got = sent(&resp, wire, sizeof(wire));
+    ok("multi-digit Content-Length", strstr(wire, "\r\nContent-Length: 1234\r\n") != NULL && got > 1234);
+
+    resp.status = 204;
+    sent(&resp, wire, sizeof(wire));
+    ok("no Content-Length without a body", strcmp(wire, "HTTP/1.1 204 No Content\r\nX-Test: 1\r\n\r\n") == 0);
+
+    teapot_response_free(&resp);
+}
+
+static teapot_response h_tea(const teapot_request *req)
+{
+    (void)req;
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    tp_sb_append_cstr(&resp.body, "teapot");
+    return resp;
+}
+
+/* HEAD gets the GET route's headers, Content-Length included, and no body */
+static void test_head(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/tea", h_tea},
+    };
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = 1;
+    server.keep_alive = 1;
+    teapot_server_build(&server);
+
+    static const char requests[] = "HEAD /tea HTTP/1.1\r\nHost: t\r\n\r\n"
+                                   "GET /tea HTTP/1.1\r\nHost: t\r\nConnection: close\r\n\r\n";
+    static char wire[4096];
+    size_t got = serve(&server, requests, wire, sizeof(wire));
+
+    const char *get = strstr(wire, "\r\n\r\nHTTP/1.1 ");
+    ok("HEAD answered with 200", strncmp(wire, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    ok("HEAD keeps Content-Length", strstr(wire, "Content-Length: 7\r\n") != NULL);
+    ok("HEAD sends no body, GET follows right after the headers", get != NULL);
+    ok("GET still gets the body", get != NULL && memcmp(wire + got - 7, "teapot", 6) == 0);
+    teapot_server_free(&server);
+}
+#endif
+
+int main(void)
+{
+    printf("Running formatting unit tests...\n\n");
+
+    test_appendf();
+    test_integers();
+#ifndef _WIN32
+    test_send_response();
+    test_head();
+#endif
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
@@ -64,7 +64,7 @@ static void test_simple(void)
 static void test_trim_spaces(void)
 {
     tp_headers h = {0};
-    char *buf = mkbuf("  X-Hello  :   world  \r\n");
+    char *buf = mkbuf("X-Hello:   world  \r\n");
     tp_extract_header_keyval(&h, buf, strlen(buf));
     ok("trim -> 1 header", h.count == 1);
     const tp_header_line *hl = get_line(&h, 0);
@@ -72,6 +72,15 @@ static void test_trim_spaces(void)
     ok("trim value == world", hl && hl->value.items && strcmp(hl->value.items, "world") == 0);
     tp_headers_free(&h);
     free(buf);
+
+    /* whitespace around a name is not trimmed: the line is dropped (RFC 9112 5.1, 5.2) */
+    tp_headers folded = {0};
+    buf = mkbuf("  X-Hello  :   world  \r\nContent-Length : 5\r\n Transfer-Encoding: chunked\r\n");
+    tp_extract_header_keyval(&folded, buf, strlen(buf));
+    ok("whitespace before a name or its ':' -> no header", folded.count == 0 &&
+                                                              tp_headers_known(&folded, TP_HEADER_CONTENT_LENGTH) == NULL);
+    tp_headers_free(&folded);
+    free(buf);
 }
 
 static void test_crlf_and_lf(void)
@@ -126,6 +135,114 @@ static void test_empty_name_ignored(void)
     free(buf);
 }
 
+static void test_illegal_bytes_rejected(void)
+{
+    tp_headers h = {0};
+    char *buf = mkbuf("Bad Name: x\r\nX-Ctl: a\x01b\r\nX-Ok: fine\tvalue\r\n");
+    tp_extract_header_keyval(&h, buf, strlen(buf));
+    ok("illegal bytes rejected -> 1 header", h.count == 1);
+    const tp_header_line *hl = get_line(&h, 0);
+    ok("X-Ok kept with tab", hl && hl->value.items && strcmp(hl->value.items, "fine\tvalue") == 0);
+    tp_headers_free(&h);
+    free(buf);
+}
+
+static void test_case_insensitive_lookup(void)
+{
+    tp_headers h = {0};
+    char *buf = mkbuf("Content-Type: text/plain\r\n");
+    tp_extract_header_keyval(&h, buf, strlen(buf));
+    ok("lookup CONTENT-TYPE", tp_headers_get(&h, "CONTENT-TYPE") != NULL);
+    ok("lookup content-type", tp_headers_match(&h, "content-type", "text/plain") == 1);
+    ok("lookup content-typ misses", tp_headers_get(&h, "content-typ") == NULL);
+    tp_headers_free(&h);
+    free(buf);
+}
+
+static void test_known_header_slots(void)
+{
+    tp_headers h = {0};
+    char *buf = mkbuf("X-A: 1\r\nhOsT: example.com\r\nContent-Length: 3\r\nHost: other\r\nHosts: no\r\n");
+    tp_extract_header_keyval(&h, buf, strlen(buf));
+    const tp_string_builder *host = tp_headers_known(&h, TP_HEADER_HOST);
+    ok("Host slot filled", host != NULL && strcmp(host->items, "example.com") == 0);
+    const tp_string_builder *cl = tp_headers_known(&h, TP_HEADER_CONTENT_LENGTH);
+    ok("Content-Length slot filled", cl != NULL && strcmp(cl->items, "3") == 0);
+    ok("absent known header", tp_headers_known(&h, TP_HEADER_CONNECTION) == NULL);
+    tp_headers_free(&h);
+    ok("slots cleared on free", tp_headers_known(&h, TP_HEADER_HOST) == NULL);
+    free(buf);
+}
+
+/* short names and values live in their line, and must follow it when the array grows */
+static void test_inline_storage(void)
+{
+    tp_headers h = {0};
+    tp_string_builder raw = {0};
+    for (int i = 0; i < 100; ++i)
+        tp_sb_appendf(&raw, "X-Header-%d: value-%d\r\n", i, i);
+    tp_sb_appendf(&raw, "X-Long: %s\r\n", "a value that does not fit in the inline buffer");
+    tp_extract_header_keyval(&h, raw.items, raw.count);
+    ok("all lines parsed", h.count == 101);
+
+    int inline_ok = 1;
+    char expected[32];
+    for (int i = 0; i < 100; ++i)
+    {
+        snprintf(expected, sizeof(expected), "value-%d", i);
+        inline_ok &= h.items[i].value.items == h.items[i].inline_value && strcmp(h.items[i].value.items, expected) == 0;
+    }
+    ok("inline values survive the array growing", inline_ok);
+    ok("long value on the heap", h.items[100].value.capacity > 0 &&
+                                     strcmp(h.items[100].value.items, "a value that does not fit in the inline buffer") == 0);
+
+    tp_header_line copy = {0};
+    ok("check finds X-Header-7", tp_headers_check(&h, "x-header-7", "value-7", &copy) == TP_HEADER_MATCH);
+    ok("copied line borrows the stored value", copy.value.items == h.items[7].inline_value);
+
+    tp_headers_free(&h);
+    tp_sb_free(raw);
+}
+
+static void test_header_block(void)
+{
+    const char *raw = "Host: example.com\r\n"
+                      "bad line\r\n"
+                      "X-Empty:\r\n"
+                      "content-length:  42 \r\n"
+                      "Set-Cookie: a=1\n"
+                      "set-cookie: b=2\r\n";
+    tp_header_block block;
+    ok("block parses valid lines", tp_header_block_parse(&block, NULL, raw, strlen(raw)) == 5);
+    ok("entries are packed", sizeof(tp_header_entry) == 16);
+
+    tp_str_view name = tp_header_block_name(&block, 0);
+    tp_str_view value = tp_header_block_value(&block, 0);
+    ok("name and value views", name.count == 4 && memcmp(name.items, "Host", 4) == 0 &&
+                                   value.count == 11 && strcmp(value.items, "example.com") == 0);
+    ok("values are NUL-terminated in the blob", tp_header_block_value(&block, 2).items[2] == '\0');
+
+    value = tp_header_block_get(&block, "CONTENT-LENGTH");
+    ok("case-insensitive lookup, value trimmed", value.count == 2 && memcmp(value.items, "42", 2) == 0);
+    value = tp_header_block_get(&block, "set-cookie");
+    ok("first of repeated headers", value.count == 3 && memcmp(value.items, "a=1", 3) == 0);
+    value = tp_header_block_get(&block, "x-empty");
+    ok("empty value", value.items != NULL && value.count == 0);
+    ok("missing header", tp_header_block_get(&block, "Host2").items == NULL);
+
+    ok("Host slot", tp_header_block_known(&block, TP_HEADER_HOST).count == 11);
+    ok("absent slot", tp_header_block_known(&block, TP_HEADER_CONNECTION).items == NULL);
+
+    tp_header_block_free(&block);
+    ok("free", block.entries == NULL && block.count == 0);
+
+    tp_arena arena = {0};
+    tp_header_block_parse(&block, &arena, raw, strlen(raw));
+    ok("block from an arena", !block.owned && strcmp(tp_header_block_get(&block, "host").items, "example.com") == 0);
+    tp_header_block_free(&block);
+    tp_arena_free(&arena);
+}
+
 static void test_clamping(void)
 {
     tp_headers h = {0};
@@ -179,6 +296,11 @@ int main(void)
     test_repeated_headers();
     test_no_colon_ignored();
     test_empty_name_ignored();
+    test_illegal_bytes_rejected();
+    test_case_insensitive_lookup();
+    test_known_header_slots();
+    test_inline_storage();
+    test_header_block();
     test_clamping();
 
     if (failures == 0)
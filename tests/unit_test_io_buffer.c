@@ -0,0 +1,174 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static void test_size_classes(void)
+{
+    tp_io_buffer *small = tp_io_buffer_acquire(1);
+    tp_io_buffer *medium = tp_io_buffer_acquire(5000);
+    tp_io_buffer *large = tp_io_buffer_acquire(64 * 1024);
+    ok("4K class", small != NULL && small->capacity == 4 * 1024 && small->len == 0);
+    ok("16K class", medium != NULL && medium->capacity == 16 * 1024);
+    ok("64K class", large != NULL && large->capacity == 64 * 1024);
+    ok("too large", tp_io_buffer_acquire(64 * 1024 + 1) == NULL);
+
+    tp_io_buffer_release(small);
+    tp_io_buffer_release(medium);
+    tp_io_buffer_release(large);
+
+    ok("free list reuses buffers LIFO", tp_io_buffer_acquire(10) == small);
+    tp_io_buffer_release(small);
+}
+
+static void test_grow(void)
+{
+    tp_io_buffer *buf = tp_io_buffer_acquire(1);
+    memcpy(buf->data, "GET / HTTP/1.1\r\n", 16);
+    buf->len = 16;
+
+    buf = tp_io_buffer_grow(buf);
+    ok("grow to 16K keeps pending input", buf->capacity == 16 * 1024 && buf->len == 16 &&
+                                             memcmp(buf->data, "GET / HTTP/1.1\r\n", 16) == 0);
+    buf = tp_io_buffer_grow(buf);
+    ok("grow to 64K", buf->capacity == 64 * 1024 && buf->len == 16);
+    ok("no class above 64K", tp_io_buffer_grow(buf) == NULL);
+
+    tp_io_buffer_release(buf);
+}
+
+static int refused;
+
+static size_t complete_length(const char *input)
+{
+    tp_io_buffer *buf = tp_io_buffer_acquire(strlen(input));
+    memcpy(buf->data, input, strlen(input));
+    buf->len = strlen(input);
+    refused = 0;
+    size_t len = tp_complete_request_length(buf, NULL, &refused);
+    tp_io_buffer_release(buf);
+    return len;
+}
+
+static void test_request_framing(void)
+{
+    ok("headers incomplete", complete_length("GET / HTTP/1.1\r\nHost: a\r\n") == 0);
+    ok("request without body", complete_length("GET / HTTP/1.1\r\n\r\n") == 18);
+    ok("body incomplete", complete_length("POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nab") == 0);
+    ok("body complete", complete_length("POST / HTTP/1.1\r\nContent-Length: 2\r\n\r\nab") == 40);
+    ok("pipelined input left over", complete_length("GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\n\r\n") == 19);
+    ok("next request's Content-Length ignored",
+       complete_length("GET /a HTTP/1.1\r\n\r\nPOST /b HTTP/1.1\r\nContent-Length: 9\r\n\r\n") == 19);
+    ok("body larger than any buffer",
+       complete_length("POST / HTTP/1.1\r\nContent-Length: 999999\r\n\r\n") == SIZE_MAX && refused == 413);
+    ok("lowercase content-length", complete_length("POST / HTTP/1.1\r\ncontent-length: 2\r\n\r\nab") == 40);
+    ok("matching duplicates", complete_length("POST / HTTP/1.1\r\nContent-Length: 2\r\nCONTENT-LENGTH: 2\r\n\r\nab") == 59);
+    ok("conflicting duplicates",
+       complete_length("POST / HTTP/1.1\r\nContent-Length: 2\r\ncontent-length: 0\r\n\r\nab") == SIZE_MAX && refused == 400);
+    ok("non-numeric", complete_length("POST / HTTP/1.1\r\nContent-Length: 2x\r\n\r\nab") == SIZE_MAX && refused == 400);
+    ok("empty", complete_length("POST / HTTP/1.1\r\nContent-Length:\r\n\r\n") == SIZE_MAX && refused == 400);
+    ok("whitespace before the colon",
+       complete_length("POST / HTTP/1.1\r\nContent-Length : 2\r\n\r\nab") == SIZE_MAX && refused == 400);
+    ok("folded line", complete_length("POST / HTTP/1.1\r\nHost: a\r\n Content-Length: 2\r\n\r\nab") == SIZE_MAX &&
+                          refused == 400);
+    ok("Transfer-Encoding", complete_length("POST / HTTP/1.1\r\ntransfer-encoding: chunked\r\n\r\n") == SIZE_MAX &&
+                                refused == 501);
+}
+
+#ifndef _WIN32
+#include "serve.h"
+
+static teapot_response h_echo(const teapot_request *req)
+{
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    tp_sb_appendf(&resp.body, "[%s:%zu]", req->path.items, req->body_length);
+    return resp;
+}
+
+/* Writes 'input' to a keep-alive connection and reads everything answered before it closed */
+static size_t serve_keep_alive(const char *input, char *wire, size_t size)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_POST, "/a", h_echo},
+        {TEAPOT_POST, "/b", h_echo},
+    };
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = 2;
+    server.keep_alive = 1;
+    teapot_server_build(&server);
+
+    size_t got = serve(&server, input, wire, size);
+    teapot_server_free(&server);
+    return got;
+}
+
+/* Every pipelined request is framed by the same Content-Length the handler sees */
+static void test_pipelined_framing(void)
+{
+    static char wire[4096];
+    serve_keep_alive("POST /a HTTP/1.1\r\ncontent-length: 3\r\n\r\nxyz"
+          "POST /b HTTP/1.1\r\nCONTENT-LENGTH: 2\r\nContent-Length: 2\r\n\r\nhi",
+          wire, sizeof(wire));
+    ok("lowercase Content-Length frames the first body", strstr(wire, "[/a:3]") != NULL);
+    ok("matching duplicates frame the second one", strstr(wire, "[/b:2]") != NULL);
+
+    /* a request framed two ways would let a proxy and the server disagree on where the next one starts */
+    serve_keep_alive("POST /a HTTP/1.1\r\nContent-Length: 0\r\ncontent-length: 37\r\n\r\n"
+          "POST /b HTTP/1.1\r\nContent-Length: 0\r\n\r\n",
+          wire, sizeof(wire));
+    ok("conflicting duplicates refused with 400", strncmp(wire, "HTTP/1.1 400 ", 13) == 0);
+    ok("nothing smuggled past them", strstr(wire, "[/") == NULL);
+    ok("connection closed after the refusal", strstr(wire, "Connection: close") != NULL);
+
+    serve_keep_alive("POST /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n"
+          "POST /b HTTP/1.1\r\nContent-Length: 0\r\n\r\n",
+          wire, sizeof(wire));
+    ok("Transfer-Encoding refused with 501", strncmp(wire, "HTTP/1.1 501 ", 13) == 0);
+    ok("nothing served after it", strstr(wire, "[/") == NULL);
+
+    serve_keep_alive("POST /a HTTP/1.1\r\nContent-Length: +3\r\n\r\nxyz", wire, sizeof(wire));
+    ok("non-numeric Content-Length refused with 400", strncmp(wire, "HTTP/1.1 400 ", 13) == 0);
+}
+#endif
+
+int main(void)
+{
+    printf("Running I/O buffer pool unit tests...\n\n");
+
+    test_size_classes();
+    test_grow();
+    test_request_framing();
+#ifndef _WIN32
+    test_pipelined_framing();
+#endif
+    tp_io_buffer_pool_trim();
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
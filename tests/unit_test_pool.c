@@ -0,0 +1,437 @@
+#define _DEFAULT_SOURCE /* syscall(), which teapot_pin_current_thread() needs on glibc */
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static size_t hello_calls;
+
+static teapot_response h_hello(const teapot_request *req)
+{
+    (void)req;
+    tp_atomic_add(&hello_calls, 1);
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    tp_sb_append_cstr(&resp.body, "hello");
+    return resp;
+}
+
+static void test_ring(void)
+{
+    tp_socket_ring ring;
+    ok("ring init", tp_socket_ring_init(&ring, 3) == 0 && ring.mask == 3);
+
+    int pushed = 0;
+    for (int i = 0; i < 4; ++i)
+        pushed += tp_socket_ring_push(&ring, (stb_teapot_socket_t)(10 + i)) == 0;
+    ok("fills up to its capacity", pushed == 4);
+    ok("full ring refuses", tp_socket_ring_push(&ring, (stb_teapot_socket_t)99) == -1);
+
+    stb_teapot_socket_t s = (stb_teapot_socket_t)-1;
+    int in_order = 1;
+    for (int i = 0; i < 4; ++i)
+        in_order &= tp_socket_ring_try_pop(&ring, &s) && s == (stb_teapot_socket_t)(10 + i);
+    ok("first in, first out", in_order);
+    ok("empty ring", tp_socket_ring_try_pop(&ring, &s) == 0);
+
+    /* positions wrap around the cells */
+    int wrapped = 1;
+    for (int i = 0; i < 10; ++i)
+        wrapped &= tp_socket_ring_push(&ring, (stb_teapot_socket_t)i) == 0 && tp_socket_ring_try_pop(&ring, &s) &&
+                   s == (stb_teapot_socket_t)i;
+    ok("wraps around", wrapped);
+
+    tp_socket_ring_push(&ring, (stb_teapot_socket_t)7);
+    tp_socket_ring_close(&ring, 1);
+    ok("closed ring drains first", tp_socket_ring_pop(&ring) == (stb_teapot_socket_t)7);
+    ok("then reports the end", !socket_ok(tp_socket_ring_pop(&ring)));
+    tp_socket_ring_destroy(&ring);
+}
+
+static void test_deque(void)
+{
+    static tp_deque d;
+    stb_teapot_socket_t s = (stb_teapot_socket_t)-1;
+    ok("empty deque", !tp_deque_pop(&d, &s) && !tp_deque_steal(&d, &s));
+
+    for (int i = 0; i < 3; ++i)
+        tp_deque_push(&d, (stb_teapot_socket_t)(10 + i));
+    ok("owner pops the newest", tp_deque_pop(&d, &s) && s == (stb_teapot_socket_t)12);
+    ok("thieves steal the oldest", tp_deque_steal(&d, &s) && s == (stb_teapot_socket_t)10);
+    ok("last one", tp_deque_pop(&d, &s) && s == (stb_teapot_socket_t)11);
+    ok("empty again", !tp_deque_pop(&d, &s) && !tp_deque_steal(&d, &s));
+
+    int pushed = 0;
+    while (tp_deque_push(&d, (stb_teapot_socket_t)pushed) == 0)
+        ++pushed;
+    ok("holds TP_POOL_DEQUE_SIZE", pushed == TP_POOL_DEQUE_SIZE && tp_deque_full(&d));
+    int drained = 0;
+    while (tp_deque_steal(&d, &s))
+        drained += s == (stb_teapot_socket_t)drained;
+    ok("stolen in push order", drained == TP_POOL_DEQUE_SIZE);
+}
+
+#ifndef _WIN32
+#include <netinet/in.h>
+
+#define RING_ITEMS 20000
+#define RING_THREADS 3
+
+static tp_socket_ring shared_ring;
+static size_t popped_sum;
+static size_t popped_count;
+
+static void *ring_producer(void *arg)
+{
+    size_t first = (size_t)arg;
+    for (size_t i = first; i < RING_ITEMS; i += RING_THREADS)
+        while (tp_socket_ring_push(&shared_ring, (stb_teapot_socket_t)i) < 0)
+            tp_thread_yield();
+    return NULL;
+}
+
+static void *ring_consumer(void *arg)
+{
+    (void)arg;
+    stb_teapot_socket_t s;
+    while (socket_ok(s = tp_socket_ring_pop(&shared_ring)))
+    {
+        tp_atomic_add(&popped_sum, (size_t)s);
+        tp_atomic_add(&popped_count, 1);
+    }
+    return NULL;
+}
+
+static tp_deque owned_deque;
+static size_t owner_done;
+
+static void *deque_thief(void *arg)
+{
+    (void)arg;
+    stb_teapot_socket_t s;
+    for (;;)
+    {
+        if (tp_deque_steal(&owned_deque, &s))
+        {
+            tp_atomic_add(&popped_sum, (size_t)s);
+            tp_atomic_add(&popped_count, 1);
+        }
+        else if (tp_atomic_load(&owner_done))
+            break;
+    }
+    return NULL;
+}
+
+static void test_deque_threads(void)
+{
+    popped_sum = popped_count = 0;
+    pthread_t thieves[RING_THREADS];
+    for (size_t i = 0; i < RING_THREADS; ++i)
+        pthread_create(&thieves[i], NULL, deque_thief, NULL);
+    stb_teapot_socket_t s;
+    size_t i = 0;
+    while (i < RING_ITEMS)
+    {
+        if (tp_deque_push(&owned_deque, (stb_teapot_socket_t)i) == 0)
+            ++i;
+        if (i % 3 == 0 && tp_deque_pop(&owned_deque, &s))
+        {
+            tp_atomic_add(&popped_sum, (size_t)s);
+            tp_atomic_add(&popped_count, 1);
+        }
+    }
+    while (tp_deque_pop(&owned_deque, &s))
+    {
+        tp_atomic_add(&popped_sum, (size_t)s);
+        tp_atomic_add(&popped_count, 1);
+    }
+    tp_atomic_add(&owner_done, 1);
+    for (size_t t = 0; t < RING_THREADS; ++t)
+        pthread_join(thieves[t], NULL);
+    ok("owner and thieves take every item once",
+       tp_atomic_load(&popped_count) == RING_ITEMS && tp_atomic_load(&popped_sum) == (size_t)RING_ITEMS * (RING_ITEMS - 1) / 2);
+}
+
+static void test_ring_threads(void)
+{
+    tp_socket_ring_init(&shared_ring, 64);
+    pthread_t producers[RING_THREADS], consumers[RING_THREADS];
+    for (size_t i = 0; i < RING_THREADS; ++i)
+    {
+        pthread_create(&consumers[i], NULL, ring_consumer, NULL);
+        pthread_create(&producers[i], NULL, ring_producer, (void *)i);
+    }
+    for (size_t i = 0; i < RING_THREADS; ++i)
+        pthread_join(producers[i], NULL);
+    tp_socket_ring_close(&shared_ring, RING_THREADS);
+    for (size_t i = 0; i < RING_THREADS; ++i)
+        pthread_join(consumers[i], NULL);
+    ok("every item popped exactly once",
+       popped_count == RING_ITEMS && popped_sum == (size_t)RING_ITEMS * (RING_ITEMS - 1) / 2);
+    tp_socket_ring_destroy(&shared_ring);
+}
+
+#define POOL_PORT 18461
+#define CLIENTS 4
+#define REQUESTS_PER_CLIENT 25
+
+static int connect_local(int port)
+{
+    for (int attempt = 0; attempt < 200; ++attempt)
+    {
+        int s = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(s, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return s;
+        close(s);
+        poll(NULL, 0, 10); /* server not listening yet */
+    }
+    return -1;
+}
+
+/* One request on a fresh connection; returns the status code or -1 */
+static int get(int port, const char *path)
+{
+    int s = connect_local(port);
+    if (s < 0)
+        return -1;
+    char request[128];
+    snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: t\r\nConnection: close\r\n\r\n", path);
+    send(s, request, strlen(request), 0);
+    char response[512];
+    size_t got = 0;
+    ssize_t r;
+    while (got + 1 < sizeof(response) && (r = recv(s, response + got, sizeof(response) - 1 - got, 0)) > 0)
+        got += (size_t)r;
+    response[got] = '\0';
+    close(s);
+    int status = -1;
+    sscanf(response, "HTTP/1.1 %d", &status);
+    return status;
+}
+
+typedef struct
+{
+    teapot_server *server;
+    teapot_pool_options options;
+    int result;
+} serve_arg;
+
+static void *serve_thread(void *arg)
+{
+    serve_arg *sa = (serve_arg *)arg;
+    sa->result = teapot_serve_pooled_ex(sa->server, &sa->options);
+    return NULL;
+}
+
+static void *pin_thread(void *arg)
+{
+    int *cpu = (int *)arg;
+    *cpu = teapot_pin_current_thread(*cpu);
+    return NULL;
+}
+
+/* on a thread of its own, so the tests that follow aren't confined to one CPU */
+static int pin_in_thread(int cpu)
+{
+    pthread_t t;
+    pthread_create(&t, NULL, pin_thread, &cpu);
+    pthread_join(t, NULL);
+    return cpu;
+}
+
+static void *client_thread(void *arg)
+{
+    size_t *ok_count = (size_t *)arg;
+    for (int i = 0; i < REQUESTS_PER_CLIENT; ++i)
+        if (get(POOL_PORT, "/hello") == 200)
+            tp_atomic_add(ok_count, 1);
+    return NULL;
+}
+
+static void run_pool(const char *name, teapot_accept_strategy accept, int pin_workers)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/hello", h_hello},
+    };
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.port = POOL_PORT;
+    server.routes = routes;
+    server.route_count = 1;
+
+    serve_arg sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.server = &server;
+    sa.options.workers = 3;
+    sa.options.accept = accept;
+    sa.options.pin_workers = pin_workers;
+    sa.result = -2;
+    hello_calls = 0;
+
+    pthread_t serving;
+    pthread_create(&serving, NULL, serve_thread, &sa);
+
+    size_t ok_count = 0;
+    pthread_t clients[CLIENTS];
+    for (int i = 0; i < CLIENTS; ++i)
+        pthread_create(&clients[i], NULL, client_thread, &ok_count);
+    for (int i = 0; i < CLIENTS; ++i)
+        pthread_join(clients[i], NULL);
+
+    teapot_server_stop(&server);
+    pthread_join(serving, NULL);
+
+    char label[128];
+    snprintf(label, sizeof(label), "%s: every request served", name);
+    ok(label, ok_count == CLIENTS * REQUESTS_PER_CLIENT && hello_calls == ok_count);
+    snprintf(label, sizeof(label), "%s: stops, joins and resets", name);
+    ok(label, sa.result == 0 && tp_atomic_load(&server.stop) == 0);
+    teapot_server_free(&server);
+}
+
+static void test_shedding(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/hello", h_hello},
+    };
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.port = POOL_PORT + 1;
+    server.routes = routes;
+    server.route_count = 1;
+
+    serve_arg sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.server = &server;
+    sa.options.workers = 1;
+    sa.options.max_connections = 1;
+    pthread_t serving;
+    pthread_create(&serving, NULL, serve_thread, &sa);
+
+    /* the only slot stays taken while this connection is open */
+    int busy = connect_local(POOL_PORT + 1);
+    poll(NULL, 0, 100);
+    ok("503 once max_connections are in service", get(POOL_PORT + 1, "/hello") == 503);
+    close(busy);
+    int status = -1;
+    for (int attempt = 0; attempt < 50 && status != 200; ++attempt)
+    {
+        poll(NULL, 0, 20); /* the worker notices the close */
+        status = get(POOL_PORT + 1, "/hello");
+    }
+    ok("served again once the slot is back", status == 200);
+
+    teapot_server_stop(&server);
+    pthread_join(serving, NULL);
+    ok("stopped", sa.result == 0);
+    teapot_server_free(&server);
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Clients that connect and then say nothing, or only half a request, don't hold the stop up */
+static void test_stop_with_idle_clients(teapot_accept_strategy accept, int keep_alive)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/hello", h_hello},
+    };
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.port = POOL_PORT + 2;
+    server.routes = routes;
+    server.route_count = 1;
+    server.keep_alive = keep_alive;
+
+    serve_arg sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.server = &server;
+    sa.options.workers = 2;
+    sa.options.accept = accept;
+    pthread_t serving;
+    pthread_create(&serving, NULL, serve_thread, &sa);
+
+    int silent = connect_local(POOL_PORT + 2);
+    int partial = connect_local(POOL_PORT + 2);
+    send(partial, "GET /hel", 8, 0);
+    poll(NULL, 0, 100); /* both taken by a worker */
+
+    double t0 = now_ms();
+    teapot_server_stop(&server);
+    pthread_join(serving, NULL);
+    double elapsed = now_ms() - t0;
+
+    char label[128];
+    snprintf(label, sizeof(label), "stop with idle clients connected (keep_alive %d)", keep_alive);
+    ok(label, sa.result == 0 && elapsed < 4 * TP_POOL_POLL_MS);
+    char byte;
+    ok("idle connections dropped", recv(silent, &byte, 1, 0) == 0 && recv(partial, &byte, 1, 0) == 0);
+    close(silent);
+    close(partial);
+    teapot_server_free(&server);
+}
+#endif
+
+int main(void)
+{
+    printf("Running worker pool unit tests...\n\n");
+
+    ok("at least one CPU", teapot_cpu_count() >= 1);
+    ok("no negative CPU", teapot_pin_current_thread(-1) == -1);
+#ifdef TP_HAS_AFFINITY
+    ok("pin to the first allowed CPU", pin_in_thread(tp_pool_cpu(0)) == 0);
+    ok("pin to a CPU out of range", pin_in_thread(1 << 20) == -1);
+#elif !defined(_WIN32)
+    ok("no pinning without an affinity API", pin_in_thread(0) == -1);
+#endif
+    test_ring();
+    test_deque();
+#ifndef _WIN32
+    test_ring_threads();
+    test_deque_threads();
+    run_pool("dispatcher", TEAPOT_ACCEPT_DISPATCHER, 0);
+    run_pool("accepting workers", TEAPOT_ACCEPT_WORKERS, 0);
+    run_pool("work stealing", TEAPOT_ACCEPT_WORK_STEALING, 0);
+    run_pool("sharded listeners", TEAPOT_ACCEPT_SHARDED, 0);
+    run_pool("pinned sharded listeners", TEAPOT_ACCEPT_SHARDED, 1);
+    run_pool("pinned dispatcher", TEAPOT_ACCEPT_DISPATCHER, 1);
+    test_shedding();
+    test_stop_with_idle_clients(TEAPOT_ACCEPT_DISPATCHER, 0);
+    test_stop_with_idle_clients(TEAPOT_ACCEPT_WORKERS, 1);
+#endif
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
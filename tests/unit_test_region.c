@@ -0,0 +1,255 @@
+#define TP_NO_HEAP
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static teapot_response h_hello(const teapot_request *req)
+{
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    tp_sb_appendf(&resp.body, "hello %s", req->path.items);
+    return resp;
+}
+
+static teapot_response h_big(const teapot_request *req)
+{
+    (void)req;
+    teapot_response resp;
+    teapot_response_init(&resp, 200);
+    for (int i = 0; i < 4096; ++i)
+        tp_sb_append_cstr(&resp.body, "more tea, more tea, more tea, more tea, more tea, more tea, more tea! ");
+    return resp;
+}
+
+static void test_no_heap(void)
+{
+    ok("no allocator, no memory", tp_realloc(NULL, 16) == NULL);
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    ok("a server needs a region", teapot_server_build(&server) == -1);
+}
+
+static void test_region_allocator(void)
+{
+    static unsigned char memory[64 * 1024];
+    teapot_region region;
+    ok("init", teapot_region_init(&region, memory + 1, sizeof(memory) - 1) == 0);
+    ok("base aligned", ((uintptr_t)region.base & (TP_ALLOC_HEADER - 1)) == 0);
+    ok("too small", teapot_region_init(&region, memory, 8) == -1);
+    teapot_region_init(&region, memory, sizeof(memory));
+    tp_allocator_use(&region.allocator);
+
+    char *a = (char *)tp_realloc(NULL, 10);
+    ok("allocates inside the region", a >= (char *)memory && a < (char *)memory + sizeof(memory));
+    memcpy(a, "teapot", 7);
+    ok("growing within the class keeps the block", tp_realloc(a, 30) == a);
+    char *b = (char *)tp_realloc(a, 100);
+    ok("growing past the class moves the content", b != a && strcmp(b, "teapot") == 0);
+
+    char *c = (char *)tp_realloc(NULL, 20);
+    ok("freed block reused", c == a);
+    tp_free(c);
+    tp_free(b);
+    ok("everything given back", region.used == 0);
+    ok("peak recorded", region.peak >= TP_ALLOC_HEADER + 128);
+
+    void *big = tp_realloc(NULL, sizeof(memory));
+    ok("exhaustion fails instead of growing", big == NULL && region.failures == 1);
+
+    /* once the memory is all carved, small requests take free blocks of larger classes */
+    void *blocks[64];
+    size_t count = 0;
+    while (count < 64 && (blocks[count] = tp_realloc(NULL, 4000)) != NULL)
+        ++count;
+    tp_free(blocks[0]);
+    void *smalls[256];
+    size_t small_count = 0;
+    int reused = 0;
+    while (small_count < 256 && (smalls[small_count] = tp_realloc(NULL, 16)) != NULL)
+        reused |= smalls[small_count++] == blocks[0];
+    ok("falls back to a larger free block", reused);
+    for (size_t i = 0; i < small_count; ++i)
+        tp_free(smalls[i]);
+    for (size_t i = 1; i < count; ++i)
+        tp_free(blocks[i]);
+    ok("balanced", region.used == 0);
+
+    tp_allocator_use(NULL);
+    teapot_region_destroy(&region);
+}
+
+static void test_region_available(void)
+{
+    static unsigned char memory[64 * 1024];
+    teapot_region region;
+    teapot_region_init(&region, memory, sizeof(memory));
+    ok("untouched region all available", teapot_region_available(&region) == region.size);
+    tp_allocator_use(&region.allocator);
+
+    void *big = tp_realloc(NULL, 8000);
+    tp_free(big);
+    ok("a freed receive-sized block counts", teapot_region_available(&region) == region.size);
+
+    /* carve the rest into blocks too small for a receive buffer */
+    static void *smalls[4096];
+    size_t count = 0;
+    while (count < 4096 && (smalls[count] = tp_realloc(NULL, 16)) != NULL)
+        ++count;
+    for (size_t i = 0; i < count; ++i)
+        tp_free(smalls[i]);
+    ok("nothing live", region.used == 0);
+    ok("small free blocks don't count", teapot_region_available(&region) < TP_REGION_REQUEST_RESERVE);
+
+    tp_allocator_use(NULL);
+    teapot_region_destroy(&region);
+}
+
+/* A region too small for what is built in it: every entry point returns -1 and gives back what
+   it took, instead of asserting */
+static void test_build_failures(void)
+{
+    static unsigned char memory[16 * 1024];
+    teapot_region region;
+    teapot_region_init(&region, memory, sizeof(memory));
+
+    static teapot_route routes[400];
+    static char paths[400][32];
+    for (size_t i = 0; i < 400; ++i)
+    {
+        snprintf(paths[i], sizeof(paths[i]), i % 2 ? "/static%zu/items" : "~/pattern%zu/*.json", i);
+        routes[i].method = TEAPOT_GET;
+        routes[i].path = paths[i];
+        routes[i].handler = h_hello;
+    }
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = 400;
+    server.region = &region;
+    ok("server build fails", teapot_server_build(&server) == -1);
+    ok("server build gave everything back", region.used == 0);
+
+    tp_allocator_use(&region.allocator);
+    teapot_router router;
+    memset(&router, 0, sizeof(router));
+    ok("pattern router build fails", teapot_router_build(&router, routes, 400) == -1 && region.used == 0);
+    teapot_conn_table table;
+    ok("connection table init fails", teapot_conn_table_init(&table, 100000) == -1 && region.used == 0);
+    tp_allocator_use(NULL);
+
+    teapot_server small;
+    memset(&small, 0, sizeof(small));
+    small.port = 18490;
+    small.region = &region;
+    small.allocator = &region.allocator;
+    teapot_pool_options options;
+    memset(&options, 0, sizeof(options));
+    options.workers = 100000;
+    ok("pool start fails", teapot_serve_pooled_ex(&small, &options) == -1 && region.used == 0);
+
+    teapot_region_destroy(&region);
+}
+
+#ifndef _WIN32
+#include "serve.h"
+
+static void test_server_region(void)
+{
+    static const teapot_route routes[] = {
+        {TEAPOT_GET, "/a", h_hello},
+        {TEAPOT_GET, "/users/:id", h_hello},
+        {TEAPOT_GET, "/big", h_big},
+    };
+
+    static unsigned char memory[2 * TP_REGION_REQUEST_RESERVE];
+    teapot_region region;
+    teapot_region_init(&region, memory, sizeof(memory));
+
+    teapot_server server;
+    memset(&server, 0, sizeof(server));
+    server.routes = routes;
+    server.route_count = sizeof(routes) / sizeof(routes[0]);
+    server.region = &region;
+    server.keep_alive = 1;
+    ok("build in the region", teapot_server_build(&server) == 0 && region.used > 0);
+    size_t after_build = region.used;
+
+    static char response[4096];
+    serve(&server, "GET /users/42 HTTP/1.1\r\nHost: a\r\n\r\nGET /a HTTP/1.1\r\nHost: a\r\nConnection: close\r\n\r\n",
+          response, sizeof(response));
+    ok("requests served from the region",
+       strstr(response, "hello /users/42") != NULL && strstr(response, "hello /a") != NULL);
+    ok("connection gave everything back", region.used == after_build);
+
+    /* something else holds the memory: requests are turned away */
+    tp_allocator_use(&region.allocator);
+    void *hog = tp_realloc(NULL, 100 * 1024);
+    tp_allocator_use(NULL);
+    ok("hog allocated", hog != NULL && teapot_region_available(&region) < TP_REGION_REQUEST_RESERVE);
+    size_t before = region.used;
+    serve(&server, "GET /a HTTP/1.1\r\n\r\n", response, sizeof(response));
+    ok("503 when the region runs low", strncmp(response, "HTTP/1.1 503", 12) == 0 &&
+                                            strstr(response, "Connection: close\r\n") != NULL);
+    ok("the refusal allocated nothing", region.used == before);
+
+    tp_allocator_use(&region.allocator);
+    tp_free(hog);
+    teapot_conn_table table;
+    ok("connection table in the region", teapot_conn_table_init(&table, 8) == 0 &&
+                                              (char *)table.slabs >= (char *)memory &&
+                                              (char *)table.slabs < (char *)memory + sizeof(memory));
+    teapot_conn_table_free(&table);
+    tp_allocator_use(NULL);
+
+    /* a handler outgrowing the region gets the request refused, not the process aborted */
+    serve(&server, "GET /big HTTP/1.1\r\nHost: a\r\n\r\n", response, sizeof(response));
+    ok("503 when a response outgrows the region", strncmp(response, "HTTP/1.1 503", 12) == 0);
+    ok("the cut response was given back", region.used == after_build);
+
+    teapot_server_free(&server);
+    ok("server freed into the region", region.used == 0);
+    teapot_region_destroy(&region);
+}
+#endif
+
+int main(void)
+{
+    printf("Running memory region unit tests...\n\n");
+
+    test_no_heap();
+    test_region_allocator();
+    test_region_available();
+    test_build_failures();
+#ifndef _WIN32
+    test_server_region();
+#endif
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
@@ -0,0 +1,460 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+static int view_eq(tp_str_view v, const char *s)
+{
+    return v.count == strlen(s) && memcmp(v.items, s, v.count) == 0;
+}
+
+static teapot_response h_root(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_users(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_users_new(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_user(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_user_post(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_create_user(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_static(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_files(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+
+static const teapot_route routes[] = {
+    {TEAPOT_GET, "/", h_root},
+    {TEAPOT_GET, "/users", h_users},
+    {TEAPOT_GET, "/users/new", h_users_new},
+    {TEAPOT_GET, "/users/:id", h_user},
+    {TEAPOT_GET, "/users/:id/posts/:post", h_user_post},
+    {TEAPOT_POST, "/users", h_create_user},
+    {TEAPOT_GET, "/static/*", h_static},
+    {TEAPOT_GET, "/files/*path", h_files},
+};
+
+static teapot_handler match(const teapot_router *r, teapot_method m, const char *path,
+                            tp_route_param *params, size_t *count)
+{
+    return teapot_router_match(r, m, path, strlen(path), params, count);
+}
+
+static void test_static_routes(void)
+{
+    teapot_router r = {0};
+    ok("build", teapot_router_build(&r, routes, sizeof(routes) / sizeof(routes[0])) == 0);
+
+    tp_route_param params[TP_MAX_ROUTE_PARAMS];
+    size_t count = 0;
+    ok("GET / -> root", match(&r, TEAPOT_GET, "/", params, &count) == h_root);
+    ok("GET /users -> users", match(&r, TEAPOT_GET, "/users", params, &count) == h_users);
+    ok("POST /users -> create", match(&r, TEAPOT_POST, "/users", params, &count) == h_create_user);
+    ok("GET /users/new beats :id", match(&r, TEAPOT_GET, "/users/new", params, &count) == h_users_new && count == 0);
+    ok("GET /user misses", match(&r, TEAPOT_GET, "/user", params, &count) == NULL);
+    ok("POST /users/new misses", match(&r, TEAPOT_POST, "/users/new", params, &count) == NULL);
+
+    teapot_router_free(&r);
+}
+
+static void test_param_routes(void)
+{
+    teapot_router r = {0};
+    teapot_router_build(&r, routes, sizeof(routes) / sizeof(routes[0]));
+
+    tp_route_param params[TP_MAX_ROUTE_PARAMS];
+    size_t count = 0;
+    ok("GET /users/123 -> user", match(&r, TEAPOT_GET, "/users/123", params, &count) == h_user);
+    ok("id captured", count == 1 && view_eq(params[0].name, "id") && view_eq(params[0].value, "123"));
+
+    ok("GET /users/newer -> user (backtrack)", match(&r, TEAPOT_GET, "/users/newer", params, &count) == h_user);
+    ok("newer captured", count == 1 && view_eq(params[0].value, "newer"));
+
+    ok("GET /users/7/posts/9 -> post", match(&r, TEAPOT_GET, "/users/7/posts/9", params, &count) == h_user_post);
+    ok("two params captured", count == 2 && view_eq(params[0].value, "7") && view_eq(params[1].name, "post") &&
+                                  view_eq(params[1].value, "9"));
+
+    ok("GET /users/7/posts misses", match(&r, TEAPOT_GET, "/users/7/posts", params, &count) == NULL && count == 0);
+
+    teapot_router_free(&r);
+}
+
+static void test_catchall_routes(void)
+{
+    teapot_router r = {0};
+    teapot_router_build(&r, routes, sizeof(routes) / sizeof(routes[0]));
+
+    tp_route_param params[TP_MAX_ROUTE_PARAMS];
+    size_t count = 0;
+    ok("GET /static/css/a.css -> static", match(&r, TEAPOT_GET, "/static/css/a.css", params, &count) == h_static);
+    ok("unnamed catch-all is '*'", count == 1 && view_eq(params[0].name, "*") && view_eq(params[0].value, "css/a.css"));
+    ok("GET /static/ -> static (empty rest)", match(&r, TEAPOT_GET, "/static/", params, &count) == h_static);
+    ok("GET /files/a/b -> files", match(&r, TEAPOT_GET, "/files/a/b", params, &count) == h_files);
+    ok("named catch-all", count == 1 && view_eq(params[0].name, "path") && view_eq(params[0].value, "a/b"));
+
+    teapot_router_free(&r);
+}
+
+static void test_invalid_routes(void)
+{
+    teapot_router r = {0};
+
+    const teapot_route not_last[] = {{TEAPOT_GET, "/a/*/b", h_root}};
+    ok("catch-all not last rejected", teapot_router_build(&r, not_last, 1) == -1);
+
+    const teapot_route conflict[] = {{TEAPOT_GET, "/u/:id", h_root}, {TEAPOT_GET, "/u/:name/x", h_root}};
+    ok("param name conflict rejected", teapot_router_build(&r, conflict, 2) == -1);
+
+    const teapot_route unnamed[] = {{TEAPOT_GET, "/u/:", h_root}};
+    ok("unnamed param rejected", teapot_router_build(&r, unnamed, 1) == -1);
+
+    teapot_router_free(&r);
+}
+
+static void test_method_not_allowed(void)
+{
+    teapot_router r = {0};
+    teapot_router_build(&r, routes, sizeof(routes) / sizeof(routes[0]));
+
+    teapot_route_match m = teapot_router_resolve(&r, TEAPOT_DELETE, "/users", 6, NULL, NULL);
+    ok("DELETE /users has no handler", m.handler == NULL);
+    ok("DELETE /users path is known", m.allowed == (TEAPOT_METHOD_BIT(TEAPOT_GET) | TEAPOT_METHOD_BIT(TEAPOT_POST) |
+                                                    TEAPOT_METHOD_BIT(TEAPOT_HEAD) | TEAPOT_METHOD_BIT(TEAPOT_OPTIONS)));
+    ok("Allow line precomputed", view_eq(m.allow, "Allow: GET, POST, HEAD, OPTIONS\r\n"));
+
+    m = teapot_router_resolve(&r, TEAPOT_HEAD, "/users", 6, NULL, NULL);
+    ok("HEAD served by the GET handler", m.handler != NULL &&
+                                             m.handler == teapot_router_match(&r, TEAPOT_GET, "/users", 6, NULL, NULL));
+
+    m = teapot_router_resolve(&r, TEAPOT_POST, "/users/9", 8, NULL, NULL);
+    ok("POST /users/:id -> 405", m.handler == NULL && view_eq(m.allow, "Allow: GET, HEAD, OPTIONS\r\n"));
+
+    m = teapot_router_resolve(&r, TEAPOT_PUT, "/static/a.css", 13, NULL, NULL);
+    ok("PUT on catch-all -> 405", m.handler == NULL && m.allowed != 0);
+
+    m = teapot_router_resolve(&r, TEAPOT_GET, "/nope", 5, NULL, NULL);
+    ok("unknown path -> 404", m.handler == NULL && m.allowed == 0 && m.allow.count == 0);
+
+    teapot_router_free(&r);
+}
+
+static teapot_response h_versioned(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_json(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_deep(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_hex(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+
+static const teapot_route pattern_routes[] = {
+    {TEAPOT_GET, "/v1/items/index.json", h_root},
+    {TEAPOT_GET, "~/v[0-9]+/items/*.json", h_versioned},
+    {TEAPOT_GET, "~/v?/items/**", h_json},
+    {TEAPOT_DELETE, "~/v[0-9]+/items/*.json", h_json},
+    {TEAPOT_GET, "~/assets/**.css", h_deep},
+    {TEAPOT_GET, "~/id/[0-9a-f]+", h_hex},
+    {TEAPOT_GET, "~/id/[^0-9]*", h_json},
+    {TEAPOT_GET, "~/lit/a\\+b", h_root},
+};
+
+static void test_pattern_routes(void)
+{
+    teapot_router r = {0};
+    ok("build with patterns", teapot_router_build(&r, pattern_routes, sizeof(pattern_routes) / sizeof(pattern_routes[0])) == 0);
+
+    ok("radix route stays on the fast path", match(&r, TEAPOT_GET, "/v1/items/index.json", NULL, NULL) == h_root);
+    ok("GET /v12/items/a.json", match(&r, TEAPOT_GET, "/v12/items/a.json", NULL, NULL) == h_versioned);
+    ok("first matching pattern wins", match(&r, TEAPOT_GET, "/v1/items/b.json", NULL, NULL) == h_versioned);
+    ok("second pattern when the first misses", match(&r, TEAPOT_GET, "/v1/items/a/b.json", NULL, NULL) == h_json);
+    ok("'+' needs one repetition", match(&r, TEAPOT_GET, "/v/items/a.json", NULL, NULL) == NULL);
+    ok("per-method winner", match(&r, TEAPOT_DELETE, "/v2/items/x.json", NULL, NULL) == h_json);
+    ok("'**' crosses segments", match(&r, TEAPOT_GET, "/assets/a/b/c.css", NULL, NULL) == h_deep);
+    ok("'**' needs the suffix", match(&r, TEAPOT_GET, "/assets/a/b/c.js", NULL, NULL) == NULL);
+    ok("byte set", match(&r, TEAPOT_GET, "/id/deadbeef", NULL, NULL) == h_hex);
+    ok("negated set", match(&r, TEAPOT_GET, "/id/xyz", NULL, NULL) == h_json);
+    ok("negated set excludes '/'", match(&r, TEAPOT_GET, "/id//x", NULL, NULL) == NULL);
+    ok("escaped '+'", match(&r, TEAPOT_GET, "/lit/a+b", NULL, NULL) == h_root);
+
+    teapot_route_match m = teapot_router_resolve(&r, TEAPOT_PUT, "/v3/items/a.json", 16, NULL, NULL);
+    ok("pattern 405", m.handler == NULL && view_eq(m.allow, "Allow: GET, DELETE, HEAD, OPTIONS\r\n"));
+
+    teapot_router_free(&r);
+
+    const teapot_route unterminated[] = {{TEAPOT_GET, "~/a[bc", h_root}};
+    ok("unterminated set rejected", teapot_router_build(&r, unterminated, 1) == -1);
+    const teapot_route dangling[] = {{TEAPOT_GET, "~/a*+", h_root}};
+    ok("'+' after '*' rejected", teapot_router_build(&r, dangling, 1) == -1);
+    teapot_router_free(&r);
+}
+
+static teapot_response h_api_status(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_api_item(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_api_index(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+
+static const teapot_route api_routes[] = {
+    {TEAPOT_GET, "/", h_api_index},
+    {TEAPOT_GET, "/status", h_api_status},
+    {TEAPOT_PUT, "/items/:item", h_api_item},
+};
+
+static void test_mounted_routers(void)
+{
+    teapot_router api = {0};
+    teapot_router_build(&api, api_routes, sizeof(api_routes) / sizeof(api_routes[0]));
+
+    teapot_router r = {0};
+    teapot_router_build(&r, routes, sizeof(routes) / sizeof(routes[0]));
+    ok("mount /users/:id/api", teapot_router_mount(&r, "/users/:id/api", &api) == -1);
+    ok("mount /api/v1/", teapot_router_mount(&r, "/api/v1/", &api) == 0);
+    ok("mount twice rejected", teapot_router_mount(&r, "/api/v1", &api) == -1);
+    ok("mount on a route prefix", teapot_router_mount(&r, "/users/admin", &api) == 0);
+
+    tp_route_param params[TP_MAX_ROUTE_PARAMS];
+    size_t count = 0;
+    ok("GET /api/v1/status -> api", match(&r, TEAPOT_GET, "/api/v1/status", params, &count) == h_api_status);
+    ok("GET /api/v1 -> api index", match(&r, TEAPOT_GET, "/api/v1", params, &count) == h_api_index);
+    ok("GET /api/v1/ -> api index", match(&r, TEAPOT_GET, "/api/v1/", params, &count) == h_api_index);
+    ok("GET /api/v1x misses", match(&r, TEAPOT_GET, "/api/v1x/status", params, &count) == NULL);
+    ok("PUT /api/v1/items/3 -> item", match(&r, TEAPOT_PUT, "/api/v1/items/3", params, &count) == h_api_item);
+    ok("sub-router param captured", count == 1 && view_eq(params[0].name, "item") && view_eq(params[0].value, "3"));
+
+    ok("GET /users/admin/status -> api", match(&r, TEAPOT_GET, "/users/admin/status", params, &count) == h_api_status);
+    ok("GET /users/admin falls back to :id", match(&r, TEAPOT_GET, "/users/administrator", params, &count) == h_user);
+    ok("unknown sub-path falls back to parent", match(&r, TEAPOT_GET, "/users/admin/posts/1", params, &count) == h_user_post &&
+                                                   count == 2 && view_eq(params[0].value, "admin"));
+
+    teapot_route_match m = teapot_router_resolve(&r, TEAPOT_GET, "/api/v1/items/3", 15, NULL, NULL);
+    ok("405 Allow from the sub-router", m.handler == NULL && view_eq(m.allow, "Allow: PUT, OPTIONS\r\n"));
+
+    teapot_router_free(&r);
+    teapot_router_free(&api);
+}
+
+static void test_server_mounts(void)
+{
+    teapot_router api = {0};
+    teapot_router_build(&api, api_routes, sizeof(api_routes) / sizeof(api_routes[0]));
+
+    const teapot_mount mounts[] = {{"/api", &api}};
+    teapot_server server = {.routes = routes, .route_count = sizeof(routes) / sizeof(routes[0]),
+                            .mounts = mounts, .mount_count = 1};
+    ok("server build with mounts", teapot_server_build(&server) == 0);
+
+    teapot_request req = {0};
+    req.method = TEAPOT_GET;
+    tp_sb_append_cstr(&req.path, "/api/status?x=1");
+    tp_sb_append_null(&req.path);
+    ok("server routes into mount", teapot_find_route(&server, &req).handler == h_api_status);
+
+    tp_sb_free(req.path);
+    teapot_server_free(&server);
+
+    const teapot_mount bad[] = {{"api", &api}};
+    teapot_server bad_server = {.routes = routes, .route_count = 1, .mounts = bad, .mount_count = 1};
+    ok("relative mount prefix rejected", teapot_server_build(&bad_server) == -1);
+
+    teapot_router_free(&api);
+}
+
+static teapot_response h_shop(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_tenant(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+static teapot_response h_fallback(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+
+static teapot_handler vhost_handler(teapot_server *server, const char *host)
+{
+    teapot_request req = {0};
+    req.method = TEAPOT_GET;
+    tp_sb_append_cstr(&req.path, "/");
+    tp_sb_append_null(&req.path);
+    if (host != NULL)
+    {
+        char line[256];
+        snprintf(line, sizeof(line), "Host: %s\r\n", host);
+        tp_extract_header_keyval(&req.headers, line, strlen(line));
+    }
+    teapot_handler h = teapot_find_route(server, &req).handler;
+    free_request(&req);
+    return h;
+}
+
+static void test_virtual_hosts(void)
+{
+    const teapot_route shop[] = {{TEAPOT_GET, "/", h_shop}};
+    const teapot_route tenant[] = {{TEAPOT_GET, "/", h_tenant}};
+    const teapot_route fallback[] = {{TEAPOT_GET, "/", h_fallback}};
+    teapot_vhost vhosts[] = {
+        {.host = "shop.example.com", .routes = shop, .route_count = 1},
+        {.host = "*.tenants.example.com", .routes = tenant, .route_count = 1},
+        {.host = "[::1]", .routes = shop, .route_count = 1},
+    };
+    teapot_server server = {.routes = routes, .route_count = sizeof(routes) / sizeof(routes[0]),
+                            .vhosts = vhosts, .vhost_count = 3};
+    ok("build with virtual hosts", teapot_server_build(&server) == 0);
+
+    ok("exact host", vhost_handler(&server, "shop.example.com") == h_shop);
+    ok("host is normalized", vhost_handler(&server, "SHOP.Example.com.:8080") == h_shop);
+    ok("IPv6 literal", vhost_handler(&server, "[::1]:80") == h_shop);
+    ok("wildcard host", vhost_handler(&server, "a.b.tenants.example.com") == h_tenant);
+    ok("wildcard needs a subdomain", vhost_handler(&server, "tenants.example.com") == h_root);
+    ok("unknown host uses server routes", vhost_handler(&server, "other.org") == h_root);
+    ok("no Host uses server routes", vhost_handler(&server, NULL) == h_root);
+    teapot_server_free(&server);
+
+    teapot_vhost with_default[] = {
+        {.host = "shop.example.com", .routes = shop, .route_count = 1},
+        {.host = "*", .routes = fallback, .route_count = 1},
+    };
+    teapot_server server2 = {.routes = routes, .route_count = 1, .vhosts = with_default, .vhost_count = 2};
+    ok("build with default host", teapot_server_build(&server2) == 0);
+    ok("default host", vhost_handler(&server2, "other.org") == h_fallback);
+    ok("exact beats default", vhost_handler(&server2, "shop.example.com") == h_shop);
+    teapot_server_free(&server2);
+
+    teapot_vhost dup[] = {
+        {.host = "a.com", .routes = shop, .route_count = 1},
+        {.host = "A.com", .routes = tenant, .route_count = 1},
+    };
+    teapot_server server3 = {.routes = routes, .route_count = 1, .vhosts = dup, .vhost_count = 2};
+    ok("duplicate host rejected", teapot_server_build(&server3) == -1);
+}
+
+static int rewrite_path(const teapot_rewriter *rw, const char *path, char *out, size_t out_size, teapot_response *resp)
+{
+    teapot_request req = {0};
+    tp_sb_append_cstr(&req.path, path);
+    tp_sb_append_null(&req.path);
+    teapot_response_init(resp, 200);
+    int redirected = teapot_rewrite(rw, &req, resp);
+    snprintf(out, out_size, "%s", req.path.items);
+    tp_sb_free(req.path);
+    return redirected;
+}
+
+static void test_rewrites(void)
+{
+    const teapot_rewrite_rule rules[] = {
+        {"/docs", "/docs/", 308},
+        {"/legacy/*", "/v2/*", 301},
+        {"/legacy/special", "https://example.com/special", 301},
+        {"/old-users/*", "/users/*", 0},
+        {"/old-users/admin/*", "/admin/*", 0},
+        {"/home", "/", 0},
+    };
+    teapot_rewriter rw = {0};
+    ok("rewriter build", teapot_rewriter_build(&rw, rules, sizeof(rules) / sizeof(rules[0])) == 0);
+
+    char path[128];
+    teapot_response resp;
+    ok("trailing-slash redirect", rewrite_path(&rw, "/docs", path, sizeof(path), &resp) == 1 && resp.status == 308 &&
+                                      strncmp(resp.headers.items, "Location: /docs/\r\n", resp.headers.count) == 0);
+    teapot_response_free(&resp);
+
+    ok("prefix redirect keeps rest and query", rewrite_path(&rw, "/legacy/a/b?x=1", path, sizeof(path), &resp) == 1 &&
+                                                   resp.status == 301 &&
+                                                   strncmp(resp.headers.items, "Location: /v2/a/b?x=1\r\n", resp.headers.count) == 0);
+    teapot_response_free(&resp);
+
+    ok("exact beats prefix", rewrite_path(&rw, "/legacy/special", path, sizeof(path), &resp) == 1 &&
+                                 strncmp(resp.headers.items, "Location: https://example.com/special\r\n", resp.headers.count) == 0);
+    teapot_response_free(&resp);
+
+    ok("path rewritten in place", rewrite_path(&rw, "/old-users/42?v=1", path, sizeof(path), &resp) == 0 &&
+                                      strcmp(path, "/users/42?v=1") == 0);
+    ok("longest prefix wins", rewrite_path(&rw, "/old-users/admin/x", path, sizeof(path), &resp) == 0 &&
+                                  strcmp(path, "/admin/x") == 0);
+    ok("exact rewrite shrinks path", rewrite_path(&rw, "/home?a=b", path, sizeof(path), &resp) == 0 &&
+                                         strcmp(path, "/?a=b") == 0);
+    ok("no rule leaves path alone", rewrite_path(&rw, "/docs/intro", path, sizeof(path), &resp) == 0 &&
+                                        strcmp(path, "/docs/intro") == 0);
+    ok("prefix needs its slash", rewrite_path(&rw, "/legacy", path, sizeof(path), &resp) == 0 && strcmp(path, "/legacy") == 0);
+    teapot_rewriter_free(&rw);
+
+    const teapot_rewrite_rule bad[] = {{"/a/*/b", "/c", 301}};
+    ok("'*' must end 'from'", teapot_rewriter_build(&rw, bad, 1) == -1);
+    const teapot_rewrite_rule bad_status[] = {{"/a", "/b", 200}};
+    ok("non-redirect status rejected", teapot_rewriter_build(&rw, bad_status, 1) == -1);
+
+    teapot_server server = {.routes = routes, .route_count = sizeof(routes) / sizeof(routes[0]),
+                            .rewrites = rules, .rewrite_count = sizeof(rules) / sizeof(rules[0])};
+    ok("server build with rewrites", teapot_server_build(&server) == 0);
+    teapot_request req = {0};
+    req.method = TEAPOT_GET;
+    tp_sb_append_cstr(&req.path, "/old-users/7");
+    tp_sb_append_null(&req.path);
+    resp = teapot_dispatch(&server, &req);
+    ok("rewrite runs before routing", view_eq(teapot_request_param(&req, "id"), "7"));
+    teapot_response_free(&resp);
+    tp_sb_free(req.path);
+    teapot_server_free(&server);
+}
+
+static void test_server_dispatch(void)
+{
+    teapot_server server = {.routes = routes, .route_count = sizeof(routes) / sizeof(routes[0])};
+    ok("server build", teapot_server_build(&server) == 0);
+
+    teapot_request req = {0};
+    req.method = TEAPOT_GET;
+    tp_sb_append_cstr(&req.path, "/users/42?verbose=1");
+    tp_sb_append_null(&req.path);
+
+    ok("query string ignored", teapot_find_route(&server, &req).handler == h_user);
+    ok("request param", view_eq(teapot_request_param(&req, "id"), "42"));
+    ok("missing request param", teapot_request_param(&req, "nope").count == 0);
+
+    req.method = TEAPOT_PATCH;
+    teapot_response resp = teapot_dispatch(&server, &req);
+    ok("dispatch PATCH -> 405", resp.status == 405);
+    ok("405 carries Allow", resp.headers.count > 0 && strncmp(resp.headers.items, "Allow: GET, HEAD, OPTIONS\r\n", resp.headers.count) == 0);
+    teapot_response_free(&resp);
+
+    req.method = TEAPOT_OPTIONS;
+    resp = teapot_dispatch(&server, &req);
+    ok("dispatch OPTIONS -> 204", resp.status == 204 && resp.body.count == 0 && resp.headers.count > 0);
+    teapot_response_free(&resp);
+
+    req.method = TEAPOT_GET;
+    req.path.count = 0;
+    tp_sb_append_cstr(&req.path, "/missing");
+    tp_sb_append_null(&req.path);
+    resp = teapot_dispatch(&server, &req);
+    ok("dispatch unknown path -> 404", resp.status == 404);
+    teapot_response_free(&resp);
+
+    tp_sb_free(req.path);
+    teapot_server_free(&server);
+}
+
+int main(void)
+{
+    printf("Running router unit tests...\n\n");
+
+    test_static_routes();
+    test_param_routes();
+    test_catchall_routes();
+    test_invalid_routes();
+    test_method_not_allowed();
+    test_server_dispatch();
+    test_pattern_routes();
+    test_mounted_routers();
+    test_server_mounts();
+    test_virtual_hosts();
+    test_rewrites();
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
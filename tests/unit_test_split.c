@@ -0,0 +1,111 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+/* Tokens of 'src' joined with '|' */
+static const char *split(const char *src, const char *delims)
+{
+    static char out[256];
+    size_t len = 0;
+    tp_splitter it;
+    tp_str_view token;
+    tp_splitter_init(&it, src, strlen(src), delims);
+    while (tp_splitter_next(&it, &token))
+    {
+        if (len > 0)
+            out[len++] = '|';
+        memcpy(out + len, token.items, token.count);
+        len += token.count;
+    }
+    out[len] = '\0';
+    return out;
+}
+
+static void test_splitter(void)
+{
+    ok("single delimiter", strcmp(split("a/b/c", "/"), "a|b|c") == 0);
+    ok("empty tokens skipped", strcmp(split("//a//b/", "/"), "a|b") == 0);
+    ok("delimiter set", strcmp(split("keep-alive, Upgrade,\tx", ", \t"), "keep-alive|Upgrade|x") == 0);
+    ok("no delimiter", strcmp(split("abc", ","), "abc") == 0);
+    ok("only delimiters", strcmp(split(",,,", ","), "") == 0);
+    ok("empty input", strcmp(split("", ","), "") == 0);
+    ok("high bytes as delimiters", strcmp(split("a\xff" "b", "\xff;"), "a|b") == 0);
+
+    /* views point into the source, which is left untouched */
+    const char src[] = "x=1&y=2";
+    tp_splitter it;
+    tp_str_view token;
+    tp_splitter_init(&it, src, 3, "&"); /* only "x=1" */
+    ok("token is a view into the source", tp_splitter_next(&it, &token) && token.items == src && token.count == 3);
+    ok("length bounds the split", tp_splitter_next(&it, &token) == 0);
+    ok("source untouched", strcmp(src, "x=1&y=2") == 0);
+}
+
+static void test_chop_into_array(void)
+{
+    tp_string_array sa;
+    const char src[] = "GET /index.html HTTP/1.1";
+    tp_chop_by_delim_into_array(&sa, src, strlen(src), " ");
+    ok("chop count", sa.count == 3);
+    ok("chop tokens", sa.count == 3 && strcmp(sa.items[0], "GET") == 0 && strcmp(sa.items[1], "/index.html") == 0 &&
+                          strcmp(sa.items[2], "HTTP/1.1") == 0);
+    ok("chop leaves the source alone", strcmp(src, "GET /index.html HTTP/1.1") == 0);
+    tp_sa_free(sa);
+}
+
+static int keep_alive_of(const char *raw)
+{
+    char buf[256];
+    strcpy(buf, raw);
+    teapot_request req;
+    memset(&req, 0, sizeof(req));
+    parse_request(buf, strlen(buf), &req);
+    int keep_alive = req.keep_alive;
+    free_request(&req);
+    return keep_alive;
+}
+
+static void test_connection_tokens(void)
+{
+    ok("HTTP/1.0 keep-alive among other tokens",
+       keep_alive_of("GET / HTTP/1.0\r\nConnection: Upgrade, Keep-Alive\r\n\r\n") == 1);
+    ok("HTTP/1.1 close among other tokens", keep_alive_of("GET / HTTP/1.1\r\nConnection: Upgrade,close\r\n\r\n") == 0);
+    ok("HTTP/1.1 default", keep_alive_of("GET / HTTP/1.1\r\nConnection: Upgrade\r\n\r\n") == 1);
+    ok("token must match whole", keep_alive_of("GET / HTTP/1.1\r\nConnection: closed\r\n\r\n") == 1);
+}
+
+int main(void)
+{
+    printf("Running string splitting unit tests...\n\n");
+
+    test_splitter();
+    test_chop_into_array();
+    test_connection_tokens();
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}
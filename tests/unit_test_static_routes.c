@@ -0,0 +1,149 @@
+#define STB_TEAPOT_IMPLEMENTATION
+#include "../stb_teapot.h"
+#include "../build/test_routes.c" // generated by nob.c from tests/routes.txt
+
+#include <stdio.h>
+#include <string.h>
+
+/* tiny test helpers */
+static int failures = 0;
+
+static void ok(const char *name, int cond)
+{
+    if (cond)
+        printf("[PASS] %s\n", name);
+    else
+    {
+        printf("[FAIL] %s\n", name);
+        ++failures;
+    }
+}
+
+teapot_response h_index(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+teapot_response h_hello(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+teapot_response h_hello_post(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+teapot_response h_status(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+teapot_response h_users(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+teapot_response h_user(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+teapot_response h_assets(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+
+static teapot_handler find(teapot_method m, const char *path)
+{
+    return teapot_static_routes_find(&test_static_routes, m, path, strlen(path));
+}
+
+static void test_generated_table(void)
+{
+    ok("table holds static routes only", test_static_routes.count == 6);
+    ok("route array holds every route", test_route_count == 8);
+
+    ok("GET / ", find(TEAPOT_GET, "/") == h_index);
+    ok("GET /hello", find(TEAPOT_GET, "/hello") == h_hello);
+    ok("POST /hello", find(TEAPOT_POST, "/hello") == h_hello_post);
+    ok("GET /api/v1/status", find(TEAPOT_GET, "/api/v1/status") == h_status);
+    ok("GET /api/v1/users", find(TEAPOT_GET, "/api/v1/users") == h_users);
+    ok("POST /api/v1/users", find(TEAPOT_POST, "/api/v1/users") == h_users);
+
+    ok("POST /api/v1/status misses", find(TEAPOT_POST, "/api/v1/status") == NULL);
+    ok("GET /hell misses", find(TEAPOT_GET, "/hell") == NULL);
+    ok("GET /api/v1/users/1 misses", find(TEAPOT_GET, "/api/v1/users/1") == NULL);
+}
+
+static void test_server_fallback(void)
+{
+    teapot_server server = {
+        .routes = test_routes,
+        .route_count = test_route_count,
+        .static_routes = &test_static_routes,
+    };
+    ok("server build", teapot_server_build(&server) == 0);
+
+    teapot_request req = {0};
+    req.method = TEAPOT_GET;
+    tp_sb_append_cstr(&req.path, "/api/v1/users/7");
+    tp_sb_append_null(&req.path);
+    ok("dynamic route falls back to router", teapot_find_route(&server, &req).handler == h_user);
+    ok("param captured by router", teapot_request_param(&req, "id").count == 1);
+
+    req.path.count = 0;
+    req.param_count = 0;
+    tp_sb_append_cstr(&req.path, "/hello?x=1");
+    tp_sb_append_null(&req.path);
+    ok("static route served from table", teapot_find_route(&server, &req).handler == h_hello);
+
+    tp_sb_free(req.path);
+    teapot_server_free(&server);
+}
+
+static teapot_response h_shop(const teapot_request *req) { (void)req; return (teapot_response){0}; }
+
+static teapot_handler host_handler(teapot_server *server, const char *host, const char *path)
+{
+    teapot_request req = {0};
+    req.method = TEAPOT_GET;
+    tp_sb_append_cstr(&req.path, path);
+    tp_sb_append_null(&req.path);
+    char line[256];
+    snprintf(line, sizeof(line), "Host: %s\r\n", host);
+    tp_extract_header_keyval(&req.headers, line, strlen(line));
+    teapot_handler h = teapot_find_route(server, &req).handler;
+    free_request(&req);
+    return h;
+}
+
+/* the table serves the server-wide routes, so a named virtual host is chosen first */
+static void test_virtual_hosts(void)
+{
+    const teapot_route shop[] = {{TEAPOT_GET, "/hello", h_shop}};
+    teapot_vhost vhosts[] = {
+        {.host = "shop.example.com", .routes = shop, .route_count = 1},
+    };
+    teapot_server server = {
+        .routes = test_routes,
+        .route_count = test_route_count,
+        .static_routes = &test_static_routes,
+        .vhosts = vhosts,
+        .vhost_count = 1,
+    };
+    ok("build with a virtual host", teapot_server_build(&server) == 0);
+    ok("virtual host wins over the table", host_handler(&server, "shop.example.com", "/hello") == h_shop);
+    ok("virtual host doesn't see the table", host_handler(&server, "shop.example.com", "/api/v1/status") == NULL);
+    ok("other hosts use the table", host_handler(&server, "other.org", "/hello") == h_hello);
+    teapot_server_free(&server);
+
+    teapot_vhost with_default[] = {
+        {.host = "shop.example.com", .routes = shop, .route_count = 1},
+        {.host = "*", .routes = shop, .route_count = 1},
+    };
+    teapot_server server2 = {
+        .routes = test_routes,
+        .route_count = test_route_count,
+        .static_routes = &test_static_routes,
+        .vhosts = with_default,
+        .vhost_count = 2,
+    };
+    ok("build with a default host", teapot_server_build(&server2) == 0);
+    ok("default host uses the table", host_handler(&server2, "other.org", "/api/v1/status") == h_status);
+    ok("named host still wins", host_handler(&server2, "shop.example.com", "/api/v1/status") == NULL);
+    teapot_server_free(&server2);
+}
+
+int main(void)
+{
+    printf("Running static route table unit tests...\n\n");
+
+    test_generated_table();
+    test_server_fallback();
+    test_virtual_hosts();
+
+    if (failures == 0)
+    {
+        printf("\nALL TESTS PASSED\n");
+        return 0;
+    }
+    else
+    {
+        printf("\n%d TEST(S) FAILED\n", failures);
+        return 1;
+    }
+}